@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+
+
+/**
+ * \class ArrayView
+ * \brief Non-owning read-only view of a contiguous array
+ * 
+ * The view does not manage the lifetime of the underlying memory. The user must make sure that the
+ * memory outlives the view, e.g. by keeping the object that owns it.
+ */
+template<typename T>
+class ArrayView
+{
+public:
+    /// Constructs an empty view
+    ArrayView();
+    
+    /// Constructs a view of an array with the given size
+    ArrayView(T const *data, std::size_t size);
+    
+public:
+    /// Returns pointer to the first element
+    T const *GetData() const;
+    
+    /// Returns number of elements in the array
+    std::size_t GetSize() const;
+    
+    /// Checks if the view is empty
+    bool IsEmpty() const;
+    
+    /// Returns a view of a part of the array starting from the given position
+    ArrayView<T> Slice(std::size_t start, std::size_t size) const;
+    
+    /// Returns element with the given index. No range check is performed
+    T const &operator[](std::size_t index) const;
+    
+    /// Iterator to the beginning of the array (for range-based loops)
+    T const *begin() const;
+    
+    /// Iterator to the end of the array (for range-based loops)
+    T const *end() const;
+    
+private:
+    /// Pointer to the first element
+    T const *data;
+    
+    /// Number of elements
+    std::size_t size;
+};
+
+
+template<typename T>
+ArrayView<T>::ArrayView():
+    data(nullptr), size(0)
+{}
+
+
+template<typename T>
+ArrayView<T>::ArrayView(T const *data_, std::size_t size_):
+    data(data_), size(size_)
+{}
+
+
+template<typename T>
+T const *ArrayView<T>::GetData() const
+{
+    return data;
+}
+
+
+template<typename T>
+std::size_t ArrayView<T>::GetSize() const
+{
+    return size;
+}
+
+
+template<typename T>
+bool ArrayView<T>::IsEmpty() const
+{
+    return (size == 0);
+}
+
+
+template<typename T>
+ArrayView<T> ArrayView<T>::Slice(std::size_t start, std::size_t size_) const
+{
+    return ArrayView<T>(data + start, size_);
+}
+
+
+template<typename T>
+T const &ArrayView<T>::operator[](std::size_t index) const
+{
+    return data[index];
+}
+
+
+template<typename T>
+T const *ArrayView<T>::begin() const
+{
+    return data;
+}
+
+
+template<typename T>
+T const *ArrayView<T>::end() const
+{
+    return data + size;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <PlotReader.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class MappedFile;
+
+
+/**
+ * \class ArrowReader
+ * \brief Reads inputs for data/MC plots from files in Arrow IPC (Feather V2) format
+ * 
+ * The file is memory-mapped, and columns of type float64 are viewed in place without copying.
+ * Columns of other numeric types are converted. Only uncompressed files with a single record batch
+ * and columns without null values are supported.
+ * 
+ * Each row of the table corresponds to a bin, with the first and the last rows describing the
+ * under- and overflow bins. Columns for a plot are named "<dirName>/<name>" or simply "<name>" if
+ * the directory name is empty. The following names have a special meaning:
+ *  - "low_edge": lower edges of the bins (mandatory); the value in the row for the overflow bin is
+ *    the upper edge of the last bin, and the value for the underflow bin is ignored,
+ *  - "data": data histogram (mandatory),
+ *  - "syst_up", "syst_down": systematic variations of the total MC expectation.
+ * All other numeric columns are interpreted as MC processes, in the order given in the schema. The
+ * title of the plot is read from the key "<dirName>/title" (or "title") of the schema metadata.
+ * Legend titles and fill colours of processes are read from keys "title" and "color" of the
+ * metadata of the corresponding fields.
+ */
+class ArrowReader: public PlotReader
+{
+public:
+    /// Constructor from the name of the Arrow IPC file
+    ArrowReader(std::string const &fileName);
+    
+public:
+    /// Reads the content of a plot stored in the given directory
+    virtual PlotContent Read(std::string const &dirName = "") const override;
+    
+    /// Returns names of all columns, in the order given in the schema
+    std::vector<std::string> GetColumnNames() const;
+    
+private:
+    /// Description of a column in the record batch
+    struct Column
+    {
+        /// Name of the column
+        std::string name;
+        
+        /// Type code: 'f' for floating-point, 'i' for signed and 'u' for unsigned integers
+        char kind;
+        
+        /// Size of an element, in bytes
+        unsigned itemSize;
+        
+        /// Pointer to the first value
+        char const *data;
+        
+        /// Custom metadata of the field
+        std::map<std::string, std::string> metadata;
+    };
+    
+private:
+    /// Parses the footer, the schema, and the record batch
+    void ReadStructure();
+    
+    /**
+     * \brief Returns a view of a column
+     * 
+     * The column is viewed in place if it is of type float64 and properly aligned and copied into
+     * a buffer owned by the content otherwise.
+     */
+    ArrayView<double> ReadColumn(Column const &column, PlotContent &content) const;
+    
+private:
+    /// Memory-mapped file
+    std::shared_ptr<MappedFile> file;
+    
+    /// Numeric columns, in the order given in the schema
+    std::vector<Column> columns;
+    
+    /// Number of rows in the record batch
+    std::size_t numRows;
+    
+    /// Custom metadata of the schema
+    std::map<std::string, std::string> metadata;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <ArrayView.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+/**
+ * \class BinMask
+ * \brief Set of bins of a histogram that must not be shown, e.g. because of blinding
+ * 
+ * Bins are numbered as in ROOT, i.e. bin 0 is the underflow and bin numBins + 1 is the overflow.
+ * The mask is stored as a bitmask, and numeric code is expected to consult it while looping over
+ * bins instead of modifying histograms.
+ */
+class BinMask
+{
+public:
+    /// Constructor for a histogram with the given number of bins. No bins are masked
+    BinMask(unsigned numBins = 0);
+    
+public:
+    /// Returns the number of bins, not counting under- and overflow bins
+    unsigned GetNumBins() const;
+    
+    /// Checks if at least one bin is masked
+    bool IsActive() const;
+    
+    /// Checks if the given bin is masked. Bins outside of the histogram are not masked
+    bool IsMasked(unsigned bin) const;
+    
+    /// Masks the given bin
+    void Mask(unsigned bin);
+    
+    /// Masks all bins for which the predicate evaluates to true
+    void MaskIf(std::function<bool(unsigned bin)> const &predicate);
+    
+    /**
+     * \brief Masks all bins that overlap with the range [min, max)
+     * 
+     * The bin edges must contain GetNumBins() + 1 values. Under- and overflow bins are masked if
+     * the range extends beyond the edges.
+     */
+    void MaskRange(ArrayView<double> const &edges, double min, double max);
+    
+    /**
+     * \brief Sums the given values over bins that are not masked
+     * 
+     * The array must include under- and overflow bins. If an array of weights is given (e.g. bin
+     * widths), each value is multiplied by the corresponding weight. The sum is compensated (see
+     * Summation).
+     */
+    double SumUnmasked(ArrayView<double> const &values,
+     ArrayView<double> const &weights = ArrayView<double>()) const;
+    
+private:
+    /// Number of bins, not counting under- and overflow bins
+    unsigned numBins;
+    
+    /// Bits that indicate masked bins
+    std::vector<std::uint64_t> bits;
+    
+    /// Number of masked bins
+    unsigned numMasked;
+};
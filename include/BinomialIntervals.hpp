@@ -0,0 +1,72 @@
+#pragma once
+
+#include <ArrayView.hpp>
+
+#include <utility>
+#include <vector>
+
+
+/**
+ * \class BinomialIntervals
+ * \brief Computes efficiencies and their confidence intervals for arrays of bins
+ * 
+ * Two methods are supported: the Clopper-Pearson interval, which is given by quantiles of beta
+ * distributions, and the Wilson score interval, which has a closed form. Quantiles of the beta
+ * distribution are found by a safeguarded Newton method applied to the regularized incomplete beta
+ * function. Since efficiency plots tend to contain the same small counts over and over again,
+ * Clopper-Pearson intervals for integer counts are cached in a process-wide table, which is
+ * accessed once per batch of bins.
+ * 
+ * Non-integer counts (e.g. weighted events) are accepted; for them the beta quantiles are computed
+ * with non-integer parameters and not cached.
+ */
+class BinomialIntervals
+{
+public:
+    /// Supported methods to construct the interval
+    enum class Method
+    {
+        ClopperPearson,
+        Wilson
+    };
+    
+public:
+    /**
+     * \brief Constructor
+     * 
+     * The default confidence level corresponds to one standard deviation.
+     */
+    BinomialIntervals(Method method = Method::ClopperPearson,
+     double confLevel = 0.682689492137086);
+    
+public:
+    /**
+     * \brief Computes efficiencies and confidence intervals for all bins
+     * 
+     * The output vectors are resized to match the input arrays. For bins with no events in the
+     * denominator, the efficiency is set to zero and the interval to [0, 1].
+     */
+    void Compute(ArrayView<double> const &passed, ArrayView<double> const &total,
+     std::vector<double> &efficiency, std::vector<double> &lower, std::vector<double> &upper)
+     const;
+    
+    /// Returns confidence level
+    double GetConfLevel() const;
+    
+    /// Returns method used to construct the interval
+    Method GetMethod() const;
+    
+private:
+    /// Computes Clopper-Pearson interval for the given numbers of passed and total events
+    std::pair<double, double> ClopperPearson(double passed, double total) const;
+    
+private:
+    /// Method to construct the interval
+    Method method;
+    
+    /// Confidence level
+    double confLevel;
+    
+    /// Quantile of the standard normal distribution that corresponds to the confidence level
+    double z;
+};
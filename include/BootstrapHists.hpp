@@ -0,0 +1,132 @@
+#pragma once
+
+#include <ArrayView.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * \class BootstrapHists
+ * \brief Poisson-bootstrap replicas of a histogram filled in a single pass over events
+ * 
+ * Each event enters replica r with an integer weight drawn from the Poisson distribution with
+ * unit mean, which is the standard large-sample approximation of resampling with replacement.
+ * All replicas are filled simultaneously into a buffer of bins x replicas, with replicas of a bin
+ * stored contiguously. The Poisson weights are produced by the counter-based generator Philox
+ * from the identifier of the event and the seed. Therefore an event receives the same weights in
+ * all histograms filled with the same seed, regardless of the order of filling and of the thread
+ * that processes it, and replicas of different histograms preserve correlations between them
+ * (see GetCrossCovariance).
+ * 
+ * For an already binned histogram of counts, FromHistogram generates replicas with independent
+ * Poisson fluctuations of the bin contents, which is equivalent to the event-level bootstrap for
+ * a single histogram.
+ * 
+ * All arrays include under- and overflow bins, i.e. they have GetNumBins() + 2 elements per
+ * replica. Matrices are stored in row-major order.
+ */
+class BootstrapHists
+{
+public:
+    /// Constructor from bin edges, the number of replicas, and the seed for random numbers
+    BootstrapHists(std::vector<double> const &edges, unsigned numReplicas,
+     std::uint64_t seed = 0);
+    
+public:
+    /**
+     * \brief Fills an event with the given value of the variable
+     * 
+     * The identifier must be unique for each event within the dataset.
+     */
+    void Fill(double x, std::uint64_t eventId, double weight = 1.);
+    
+    /// Fills an event into the given bin, with 0 denoting the underflow bin
+    void FillBin(unsigned bin, std::uint64_t eventId, double weight = 1.);
+    
+    /**
+     * \brief Fills an event into the given bin using precomputed Poisson weights
+     * 
+     * The weights must have been obtained with GetPoissonWeights for the seed and the number of
+     * replicas of this object. This allows generating the weights once per event when the event
+     * is filled into many histograms.
+     */
+    void FillBin(unsigned bin, std::vector<std::uint32_t> const &poissonWeights,
+     double weight = 1.);
+    
+    /**
+     * \brief Generates replicas for a histogram of counts
+     * 
+     * The contents must include under- and overflow bins. Each replica is obtained by replacing
+     * the content of every bin with a number drawn from the Poisson distribution with the mean
+     * equal to this content.
+     */
+    static BootstrapHists FromHistogram(std::vector<double> const &edges,
+     ArrayView<double> const &contents, unsigned numReplicas, std::uint64_t seed = 0);
+    
+    /// Returns the content of the given bin in the given replica
+    double GetContent(unsigned bin, unsigned replica) const;
+    
+    /**
+     * \brief Returns the covariance matrix of bin contents estimated from the replicas
+     * 
+     * The matrix has (GetNumBins() + 2)^2 elements.
+     */
+    std::vector<double> GetCovariance() const;
+    
+    /**
+     * \brief Returns the covariance matrix between bin contents of two histograms
+     * 
+     * Element (i, j) is the covariance between bin i of the first histogram and bin j of the
+     * second one. The histograms must have been filled from the same events with the same seed
+     * and number of replicas.
+     */
+    static std::vector<double> GetCrossCovariance(BootstrapHists const &first,
+     BootstrapHists const &second);
+    
+    /// Returns bin edges
+    std::vector<double> const &GetEdges() const;
+    
+    /// Returns standard deviations of bin contents over the replicas
+    std::vector<double> GetErrors() const;
+    
+    /// Returns the number of bins, not counting under- and overflow bins
+    unsigned GetNumBins() const;
+    
+    /// Returns the number of replicas
+    unsigned GetNumReplicas() const;
+    
+    /**
+     * \brief Computes Poisson weights of the given event for all replicas
+     * 
+     * The weights are written into the given vector, which is resized to the number of replicas.
+     */
+    static void GetPoissonWeights(std::uint64_t eventId, std::uint64_t seed,
+     unsigned numReplicas, std::vector<std::uint32_t> &weights);
+    
+    /// Returns the seed for random numbers
+    std::uint64_t GetSeed() const;
+    
+private:
+    /// Returns bin contents centred at their means over the replicas
+    std::vector<double> GetCentred() const;
+    
+private:
+    /// Bin edges
+    std::vector<double> edges;
+    
+    /// Number of bins, not counting under- and overflow bins
+    unsigned numBins;
+    
+    /// Number of replicas
+    unsigned numReplicas;
+    
+    /// Seed for random numbers
+    std::uint64_t seed;
+    
+    /// Contents of all replicas, indexed as [bin][replica]
+    std::vector<double> contents;
+    
+    /// Buffer for Poisson weights of the current event
+    std::vector<std::uint32_t> poissonWeights;
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <RootFileReader.hpp>
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+
+/**
+ * \class CampaignDiff
+ * \brief Bin-level comparison of plots produced in two campaigns, for regression checks
+ * 
+ * Both productions are ROOT files with the same directory layout as expected by DataMCPlot. The
+ * comparison is done in three stages. First, each directory is pre-screened using digests of raw
+ * stored objects (see RootFileReader::GetDigests), and directories in which all objects are
+ * byte-identical are not decompressed at all. Then the remaining candidates are read and compared
+ * bin by bin in parallel threads. A bin differs if the absolute difference exceeds both the
+ * absolute tolerance and the relative tolerance multiplied by the larger of the two magnitudes.
+ * Finally, the entries are ranked so that the most severe changes come first.
+ * 
+ * All histograms present in a directory (data, MC processes, and systematic variations) are
+ * compared, including under- and overflow bins. Sums of squared weights are compared when both
+ * histograms in a pair provide them. Histograms are matched by name. Differences in the binning or
+ * in the set of histograms are reported as structural.
+ */
+class CampaignDiff
+{
+public:
+    /// Outcome of the comparison of a single directory
+    enum class Status
+    {
+        Identical,  ///< All stored objects are byte-identical
+        Compatible,  ///< Stored objects differ, but all bins agree within tolerances
+        Changed,  ///< Some bins differ beyond tolerances
+        Structural,  ///< Binning or the set of histograms differs
+        OnlyInReference,  ///< Directory is missing in the target file
+        OnlyInTarget,  ///< Directory is missing in the reference file
+        Failed  ///< Directory could not be read
+    };
+    
+    /// Result of the comparison of a single directory
+    struct Entry
+    {
+        /// Constructor
+        Entry();
+        
+        /// Path to the directory
+        std::string dirName;
+        
+        /// Outcome of the comparison
+        Status status;
+        
+        /**
+         * \brief Largest absolute difference divided by the tolerance for that bin
+         * 
+         * Values above 1 indicate a change. This is the ranking variable. It is set to infinity
+         * for structural changes and missing directories.
+         */
+        double score;
+        
+        /// Largest absolute difference among all bins
+        double maxAbsDiff;
+        
+        /// Largest relative difference among all bins, computed with respect to the reference
+        double maxRelDiff;
+        
+        /// Number of bins, in all histograms together, that differ beyond tolerances
+        unsigned numChangedBins;
+        
+        /// Name of the histogram that contains the bin with the highest score
+        std::string worstHist;
+        
+        /// Index of the bin with the highest score, with 0 denoting the underflow bin
+        unsigned worstBin;
+        
+        /// Human-readable details, e.g. the description of a structural change or an error
+        std::string message;
+    };
+    
+public:
+    /**
+     * \brief Constructor from the names of the reference and target files
+     * 
+     * Default tolerances require exact agreement up to the rounding of single-precision numbers.
+     */
+    CampaignDiff(std::string const &refFileName, std::string const &targetFileName);
+    
+public:
+    /// Returns entries ranked by severity, as computed by the last call to Run
+    std::vector<Entry> const &GetEntries() const;
+    
+    /// Returns the number of entries that indicate a change of any kind
+    unsigned GetNumChanged() const;
+    
+    /// Returns the name of the reference file
+    std::string const &GetRefFileName() const;
+    
+    /// Returns the name of the target file
+    std::string const &GetTargetFileName() const;
+    
+    /**
+     * \brief Compares the given directories in the two files
+     * 
+     * If the list is empty, all directories found in the top level of either file are compared.
+     * The last argument specifies the number of threads used for the bin-level comparison; if it
+     * is zero, it is chosen based on the hardware concurrency.
+     */
+    void Run(std::vector<std::string> const &dirNames = {}, unsigned numThreads = 0);
+    
+    /**
+     * \brief Sets tolerances for bin-level comparisons
+     * 
+     * A bin is considered changed if |a - b| > max(absTol, relTol * max(|a|, |b|)).
+     */
+    void SetTolerances(double absTol, double relTol);
+    
+    /**
+     * \brief Writes a report ranked by severity
+     * 
+     * If the second argument is false, identical and compatible directories are skipped. The
+     * report is a table with tab-separated columns, which can be consumed by spreadsheets.
+     */
+    void WriteReport(std::ostream &out, bool includeUnchanged = false) const;
+    
+    /// Returns a textual label for the given status
+    static char const *StatusLabel(Status status);
+    
+private:
+    /**
+     * \brief Compares the given directory bin by bin
+     * 
+     * Fills the entry with the outcome. Exceptions are caught and reported as failures.
+     */
+    void CompareDirectory(Entry &entry) const;
+    
+    /// Compares a pair of histograms with identical names
+    void CompareHists(PlotContent::Hist const &ref, PlotContent::Hist const &target,
+     Entry &entry) const;
+    
+    /// Lists directories in the top level of the given file
+    static std::vector<std::string> ListDirectories(RootFileReader const &reader);
+    
+private:
+    /// Names of the files
+    std::string refFileName, targetFileName;
+    
+    /// Readers for the reference and target files
+    RootFileReader refReader, targetReader;
+    
+    /// Absolute and relative tolerances
+    double absTol, relTol;
+    
+    /// Results of the last comparison
+    std::vector<Entry> entries;
+};
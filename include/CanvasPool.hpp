@@ -0,0 +1,46 @@
+#pragma once
+
+#include <TCanvas.h>
+#include <TPad.h>
+
+#include <memory>
+
+
+/**
+ * \class CanvasPool
+ * \brief Process-wide pool of canvases with main pads, reused in batch mode
+ * 
+ * Creation of a canvas is expensive and registers it in global lists of ROOT. When figures are
+ * produced in batch mode, a canvas is returned to the pool together with its main pad once the
+ * figure has been deleted, and given out again to the next figure of the same size. Only the
+ * links to drawn objects are removed from the canvas; the objects themselves belong to the figure.
+ * Outside of batch mode canvases are displayed and are never reused.
+ * 
+ * The pool is not thread-safe, in the same way as ROOT graphics.
+ */
+class CanvasPool
+{
+public:
+    /**
+     * \brief Provides a canvas of the given size and a pad within it
+     * 
+     * The given pointers are reset, and then a pooled canvas is moved into them if available or a
+     * new one is created. The canvas is given the name "canvas", and the pad is created with the
+     * name "mainPad". The caller is expected to set the geometry and the margins of the pad and
+     * draw it in the canvas.
+     */
+    static void Acquire(unsigned width, unsigned height, std::unique_ptr<TCanvas> &canvas,
+     std::unique_ptr<TPad> &mainPad);
+    
+    /**
+     * \brief Returns a canvas and its main pad to the pool
+     * 
+     * All objects drawn in the canvas must have been deleted or be deleted by the caller
+     * afterwards; they are only unlinked here. Outside of batch mode or if the pool is full the
+     * canvas and the pad are deleted.
+     */
+    static void Release(std::unique_ptr<TCanvas> &canvas, std::unique_ptr<TPad> &mainPad);
+    
+    /// Sets the maximal number of canvases kept in the pool (8 by default)
+    static void SetCapacity(unsigned capacity);
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <PlotContent.hpp>
+
+#include <string>
+#include <vector>
+
+
+/**
+ * \class CutScan
+ * \brief Computes significance and ROC curves for one-sided cuts on the plotted variable
+ * 
+ * Cuts are placed at all bin edges. For each cut, the signal and background yields with the
+ * variable above and below the cut are obtained from cumulative sums computed in a forward and a
+ * backward pass over the bins, so that all curves are found in O(bins). Summing from the two ends
+ * separately avoids the loss of precision that would arise from subtracting a prefix sum from the
+ * total. Under- and overflow bins are included in the yields.
+ * 
+ * For each cut and direction the class provides the yields, the simple significance s / sqrt(b),
+ * the Asimov significance sqrt(2 ((s + b) ln(1 + s / b) - s)), and the signal and background
+ * efficiencies, which form the ROC curve. Significances are set to zero if the background yield is
+ * not positive.
+ */
+class CutScan
+{
+public:
+    /// Direction of the cut
+    enum class Direction
+    {
+        Above,  ///< Select x > cut
+        Below   ///< Select x < cut
+    };
+    
+public:
+    /**
+     * \brief Constructor from arrays of bin contents
+     * 
+     * Arrays with signal and background include under- and overflow bins, i.e. they contain one
+     * element more than the array of bin edges.
+     */
+    CutScan(ArrayView<double> const &edges, ArrayView<double> const &signal,
+     ArrayView<double> const &background);
+    
+    /**
+     * \brief Constructor from a description of a plot
+     * 
+     * The MC process with the given name is the signal, and the sum of all other MC processes is
+     * the background. Throws an exception if there is no such process.
+     */
+    CutScan(PlotContent const &content, std::string const &signalName);
+    
+public:
+    /// Returns the Asimov significance for each cut
+    std::vector<double> const &GetAsimovSignificance(Direction direction) const;
+    
+    /// Returns background yields that pass each cut
+    std::vector<double> const &GetBackground(Direction direction) const;
+    
+    /**
+     * \brief Returns background efficiencies of all cuts
+     * 
+     * Together with GetSignalEfficiency, this gives the ROC curve.
+     */
+    std::vector<double> const &GetBackgroundEfficiency(Direction direction) const;
+    
+    /// Returns positions of all cuts, which coincide with the bin edges
+    std::vector<double> const &GetCuts() const;
+    
+    /// Returns signal yields that pass each cut
+    std::vector<double> const &GetSignal(Direction direction) const;
+    
+    /// Returns signal efficiencies of all cuts
+    std::vector<double> const &GetSignalEfficiency(Direction direction) const;
+    
+    /// Returns s / sqrt(b) for each cut
+    std::vector<double> const &GetSimpleSignificance(Direction direction) const;
+    
+private:
+    /// Computes all curves
+    void Compute(ArrayView<double> const &edges, ArrayView<double> const &signal,
+     ArrayView<double> const &background);
+    
+private:
+    /// Positions of the cuts
+    std::vector<double> cuts;
+    
+    /// Yields that pass the cuts, indexed by direction
+    std::vector<double> signal[2], background[2];
+    
+    /// Efficiencies of the cuts, indexed by direction
+    std::vector<double> signalEff[2], backgroundEff[2];
+    
+    /// Significances, indexed by direction
+    std::vector<double> simpleSignif[2], asimovSignif[2];
+};
@@ -1,13 +1,23 @@
 #pragma once
 
+#include <BinMask.hpp>
+#include <BootstrapHists.hpp>
+#include <CutScan.hpp>
+#include <PlotReader.hpp>
+#include <TemplateMorph.hpp>
+
 #include <TH1.h>
 #include <TGraphAsymmErrors.h>
 #include <TCanvas.h>
 
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 #include <list>
+#include <map>
 #include <utility>
+#include <vector>
 
 
 /**
@@ -25,6 +35,23 @@ public:
      */
     DataMCPlot(std::string const &srcFileName, std::string const &dirName = "");
     
+    /**
+     * \brief Constructor from a ROOT-free description of the input
+     * 
+     * This allows to plot histograms read from files in formats other than ROOT, e.g. with
+     * NpzReader or ArrowReader. Histograms are filled from the arrays referenced by the content;
+     * the content is not needed after the construction.
+     */
+    DataMCPlot(PlotContent const &content);
+    
+    /**
+     * \brief Constructor from a reader of a non-ROOT input
+     * 
+     * Reads the content of the given directory with the reader. Readers for various formats can be
+     * created with PlotReader::Open.
+     */
+    DataMCPlot(PlotReader const &reader, std::string const &dirName = "");
+    
     /// Copy constructor is deleted
     DataMCPlot(DataMCPlot const &) = delete;
     
@@ -35,6 +62,31 @@ public:
     ~DataMCPlot();
     
 public:
+    /**
+     * \brief Blinds bins for which the given predicate evaluates to true
+     * 
+     * Bins are numbered as in ROOT. Data in blinded bins are not drawn, and blinded bins are
+     * excluded from the normalization, the residuals, and the computation of the range of the y
+     * axis. Blinding must be set up before NormalizeMCToData is called and before the figure is
+     * drawn. All methods that blind bins can be called several times, and their effect is combined.
+     */
+    void BlindBins(std::function<bool(unsigned bin)> const &predicate);
+    
+    /**
+     * \brief Blinds bins in which the given MC process is significant
+     * 
+     * A bin is blinded if s / sqrt(b) exceeds the threshold, where s is the content of the given
+     * process (which can be an overlay) and b is the total expectation from other processes in the
+     * stack. Throws an exception if there is no such process.
+     */
+    void BlindBySignificance(std::string const &signalName, double threshold);
+    
+    /// Blinds bins that overlap with the range [min, max)
+    void BlindRange(double min, double max);
+    
+    /// Returns the mask of blinded bins
+    BinMask const &GetBlinding() const;
+    
     /// Returns the title of the plot
     std::string const &GetTitle() const;
     
@@ -46,6 +98,18 @@ public:
      */
     std::shared_ptr<TH1> GetHist(std::string const &name) const;
     
+    /**
+     * \brief Declares MC processes that are drawn as lines rather than included in the stack
+     * 
+     * All MC histograms whose names match the given shell-style pattern (e.g. "signal_*") are
+     * removed from the stack and excluded from the total expectation and the normalization. If the
+     * second argument is true, they are drawn added on top of the total expectation; otherwise they
+     * are drawn on their own. The method must be called before NormalizeMCToData and before the
+     * figure is drawn. Throws an exception if no process matches the pattern or if all processes
+     * do.
+     */
+    void DeclareOverlay(std::string const &pattern, bool stackOnTotal = false);
+    
     /**
      * \brief Rescales all MC histograms so that the total expectation equals normalization of data
      * 
@@ -56,6 +120,85 @@ public:
      */
     void NormalizeMCToData(bool isDensity);
     
+    /**
+     * \brief Builds the band with systematical uncertainties from pseudo-experiments
+     * 
+     * Each element of the vector describes a nuisance parameter that scales normalizations of MC
+     * processes in the stack by log-normal factors. It maps names of the affected processes to the
+     * corresponding values of kappa (see ToyBand). The band covers the central 68% of the total
+     * expectations in the pseudo-experiments, and its central value is the nominal total. The band
+     * replaces the one read from the input, and it can be drawn with RequestSystematics. The method
+     * should be called after NormalizeMCToData. Throws an exception if a process is not found.
+     */
+    void BuildToyBand(std::vector<std::map<std::string, double>> const &nuisances,
+     unsigned numToys = 10000, uint64_t seed = 0);
+    
+    /**
+     * \brief Evaluates statistical uncertainties of data with Poisson-bootstrap replicas
+     * 
+     * The replicas are generated from the binned data histogram (see
+     * BootstrapHists::FromHistogram). Errors of the data histogram, which are also used for the
+     * residuals, are replaced with standard deviations over the replicas. The method must be
+     * called before the figure is drawn.
+     */
+    void SetDataBootstrap(unsigned numReplicas, std::uint64_t seed = 0);
+    
+    /**
+     * \brief Uses the given bootstrap replicas of the data histogram
+     * 
+     * This version accepts replicas filled at the event level, e.g. by SelectionDag. Throws an
+     * exception if the number of bins or any of the bin edges does not match the data histogram, up
+     * to rounding errors.
+     */
+    void SetDataBootstrap(BootstrapHists const &replicas);
+    
+    /**
+     * \brief Returns the covariance matrix of data/MC residuals due to fluctuations of data
+     * 
+     * The matrix is computed from the bootstrap replicas and includes under- and overflow bins.
+     * Elements for bins with no MC expectation are set to zero. Throws an exception if
+     * SetDataBootstrap has not been called.
+     */
+    std::vector<double> GetResidualCovariance() const;
+    
+    /**
+     * \brief Adds templates of a process for a source of systematic uncertainty
+     * 
+     * The templates correspond to values +1 and -1 of the nuisance parameter and must include
+     * under- and overflow bins. They are interpolated with the given scheme (see TemplateMorph)
+     * when ApplyNuisances is called. Nominal templates are taken from the current contents of all
+     * MC histograms, including overlays, when the first templates are added. Therefore templates
+     * must be added before NormalizeMCToData. Throws an exception if the process is not found, the
+     * binning does not match, or NormalizeMCToData has already been called.
+     */
+    void AddTemplates(std::string const &process, std::string const &source,
+     ArrayView<double> const &up, ArrayView<double> const &down,
+     TemplateMorph::Interpolation interpolation = TemplateMorph::Interpolation::Additive);
+    
+    /**
+     * \brief Sets MC histograms to templates morphed for the given values of nuisance parameters
+     * 
+     * Nuisance parameters are identified by names of sources of uncertainty, and those that are
+     * not given are set to zero. Every call starts from the nominal templates, so the method can be
+     * called repeatedly, e.g. in a scan. If NormalizeMCToData has been called, processes in the
+     * stack are rescaled with the same factor as found there. The total expectation and the
+     * central values of the band with systematical uncertainties are updated. The method must be
+     * called before the figure is drawn. Throws an exception if a source is unknown.
+     */
+    void ApplyNuisances(std::map<std::string, double> const &params);
+    
+    /**
+     * \brief Reads templates for systematic variations from a ROOT file
+     * 
+     * Templates are histograms named "<process>_<source>Up" and "<process>_<source>Down", which
+     * follow the convention of common fit tools. If several processes match the name, the longest
+     * name is chosen. Templates are added with the given interpolation scheme as in AddTemplates.
+     * Throws an exception if the file cannot be read or if one of the templates in a pair is
+     * missing.
+     */
+    void ReadTemplates(std::string const &srcFileName, std::string const &dirName = "",
+     TemplateMorph::Interpolation interpolation = TemplateMorph::Interpolation::Additive);
+    
     /**
      * \brief Enables or disables plotting of the residuals
      * 
@@ -72,9 +215,52 @@ public:
      */
     void RequestSystematics(bool drawSystematics = true, std::string const &legendLabel = "");
     
+    /**
+     * \brief Enables or disables drawing of significance curves for cuts on the plotted variable
+     * 
+     * The curves are drawn in an additional pad between the main pad and the residuals. The MC
+     * process with the given name is treated as the signal, and all other processes form the
+     * background. Solid and dashed lines correspond to selections x > cut and x < cut
+     * respectively. If the last argument is true, the Asimov significance is drawn; otherwise s /
+     * sqrt(b) is used. The method must be called before the figure is drawn.
+     */
+    void RequestCutScan(bool drawCutScan, std::string const &signalName = "",
+     bool useAsimov = true);
+    
+    /**
+     * \brief Switches between linear and logarithmic scales for the y axis of the main pad
+     * 
+     * In both cases the range of the axis is chosen automatically to include the stack, overlays,
+     * data with their uncertainties, and the band with systematical uncertainties if it is drawn.
+     * In the linear scale the range starts at zero, and in the logarithmic scale the lower end of
+     * the range is set by the smallest positive value among them. The method must be called before
+     * the figure is drawn.
+     */
+    void SetLogY(bool logY = true);
+    
+    /**
+     * \brief Computes significance and ROC curves for cuts on the plotted variable
+     * 
+     * The MC process with the given name is treated as the signal, and all other processes in the
+     * stack form the background. The signal can be an overlaid process. If the MC histograms
+     * have been rescaled with NormalizeMCToData, the rescaled yields are used. Throws an exception
+     * if there is no such process.
+     */
+    CutScan ScanCuts(std::string const &signalName) const;
+    
     /// Draw the figure
     TCanvas &Draw();
     
+    /**
+     * \brief Draws the figure in the given pad instead of a dedicated canvas
+     * 
+     * Pads of the figure are created within the given one, with the same relative layout as in
+     * the canvas created by Draw. If the last argument is false, the legend is created but not
+     * drawn, and titles of the axes are omitted, so that they can be shared by several figures
+     * (see PlotGrid). Labels cannot be added to a figure drawn in this way.
+     */
+    void DrawInPad(TVirtualPad &host, bool standalone = true);
+    
     /**
      * \brief Draws CMS label in the upper left part of the figure
      * 
@@ -118,6 +304,44 @@ private:
     /// Reads histograms from a ROOT file
     void ReadFile(std::string const &srcFileName, std::string const &dirName);
     
+    /// Creates histograms from a ROOT-free description of the input
+    void ReadContent(PlotContent const &content);
+    
+    /// Creates histogram with total MC expectation from histograms in the stack
+    void BuildTotal();
+    
+    /// Returns the total height of pads below the main one, in units of the canvas
+    double GetBottomSpacing() const;
+    
+    /**
+     * \brief Makes sure the mask of blinded bins matches the binning
+     * 
+     * An empty mask is recreated for the current binning. Throws an exception if bins have
+     * already been masked for a different binning.
+     */
+    void PrepareBlinding();
+    
+    /// Sets central values of the band with systematical uncertainties to the total expectation
+    void RecentreSystematics();
+    
+    /**
+     * \brief Finds the range of values to be shown in the main pad
+     * 
+     * Computes the maximal value and the smallest positive value in a single pass over the bins
+     * of all drawn objects. The lower end of a linear axis is always zero and thus is not
+     * computed. Blinded data are skipped.
+     */
+    void FindYRange(double &yMax, double &yMinPositive) const;
+    
+    /**
+     * \brief Creates histogram with total MC expectation and the band with systematical
+     * uncertainties
+     * 
+     * Histograms with systematical variations are optional; the band is created only if both of
+     * them are provided.
+     */
+    void BuildTotalAndSystematics(TH1 const *systUp, TH1 const *systDown);
+    
     /**
      * \brief Creates an object of type T passing arguments Args to its constructor and saves a
      * pointer to it to the ownedObjects container
@@ -141,7 +365,15 @@ private:
     /// MC histograms
     std::list<std::shared_ptr<TH1>> mcHists;
     
-    /// A sum of all MC histograms
+    /**
+     * \brief MC histograms drawn as lines outside of the stack
+     * 
+     * The second element of each pair indicates if the histogram is drawn on top of the total
+     * expectation.
+     */
+    std::list<std::pair<std::shared_ptr<TH1>, bool>> overlays;
+    
+    /// A sum of all MC histograms included in the stack
     std::shared_ptr<TH1> mcTotalHist;
     
     /**
@@ -152,6 +384,24 @@ private:
      */
     std::unique_ptr<TGraphAsymmErrors> systError;
     
+    /// Bins in which data are hidden
+    BinMask blinding;
+    
+    /// Bootstrap replicas of the data histogram, or null if they have not been requested
+    std::unique_ptr<BootstrapHists> dataBootstrap;
+    
+    /// Morphing of MC templates, or null if no templates have been added
+    std::unique_ptr<TemplateMorph> morph;
+    
+    /// MC histograms, including overlays, in the order of processes in the morphing
+    std::vector<std::shared_ptr<TH1>> morphHists;
+    
+    /// Factor applied to MC histograms in the stack by NormalizeMCToData, or 1 if not applied
+    double normFactor;
+    
+    /// Indicates if NormalizeMCToData has been called
+    bool isNormalized;
+    
     /// Indicates if the data/MC residuals should be plotted
     bool plotResiduals;
     
@@ -172,6 +422,18 @@ private:
      */
     std::string systLegendLabel;
     
+    /// Indicates if significance curves for cuts should be drawn
+    bool drawCutScan;
+    
+    /// Name of the MC process used as the signal in the cut scan
+    std::string cutScanSignal;
+    
+    /// Indicates if the Asimov significance rather than s / sqrt(b) should be drawn
+    bool cutScanAsimov;
+    
+    /// Indicates if the y axis of the main pad is logarithmic
+    bool logY;
+    
     /// Canvas to host the figure
     std::unique_ptr<TCanvas> canvas;
     
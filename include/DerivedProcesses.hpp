@@ -0,0 +1,209 @@
+#pragma once
+
+#include <PlotContent.hpp>
+#include <PlotReader.hpp>
+
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+/**
+ * \class DerivedProcesses
+ * \brief Defines MC processes by arithmetic expressions over histograms of a plot
+ * 
+ * Typical examples are a data-driven estimate of a background, e.g.
+ *   qcd = ({CR/$base/data} - sumexcept({CR/$base/qcd})) * 0.3,
+ * and a rescaled process, e.g. ttbar = ttbar * 1.05. Expressions support numbers, the binary
+ * operators +, -, *, /, unary minus, parentheses, and the following operands:
+ *  - name: histogram with the given name (data or an MC process) in the current plot, or an
+ *    earlier definition with this name,
+ *  - {dir/name}: histogram in another directory, read with the PlotReader given to the
+ *    constructor; within the directory, "$dir" is replaced with the directory of the current plot
+ *    and "$base" with the last component of it; the form {name} can be used for names that
+ *    contain special characters,
+ *  - sum(ref), sumexcept(ref): sum of all MC processes whose names match, or do not match, the
+ *    shell-style pattern given by the reference ref in one of the two forms above,
+ *  - min(a, b), max(a, b): bin-wise minimum and maximum of two expressions.
+ * Division by zero gives zero, as in TH1::Divide. Patterns only match processes given in the
+ * input, not derived processes added to the plot.
+ * 
+ * All expressions are parsed once, in Define, into a single directed acyclic graph in which
+ * identical sub-expressions are merged and constant sub-expressions are folded. The graph is
+ * reused for every plot. Apply evaluates it for blocks of bins, running all operations on a block
+ * before moving to the next one. Thus no intermediate histograms are created, and all partial
+ * results stay in the cache. Uncertainties are propagated to linear order, with derivatives
+ * computed by a reverse pass over the graph. Histograms that enter an expression several times
+ * are therefore treated as fully correlated with themselves, and different histograms as
+ * independent. Contents of other directories are cached, so that a directory referenced by many
+ * plots is read only once.
+ */
+class DerivedProcesses
+{
+public:
+    /// Constructor for expressions that only refer to histograms of the current plot
+    DerivedProcesses();
+    
+    /**
+     * \brief Constructor with a reader for other directories
+     * 
+     * The reader must outlive this object.
+     */
+    DerivedProcesses(PlotReader const &reader);
+    
+public:
+    /**
+     * \brief Computes derived processes for the given plot
+     * 
+     * Processes are evaluated in the order of definition. A derived process replaces an existing
+     * MC process with the same name, keeping its position in the stack; otherwise it is appended
+     * to the list of processes. The directory name is used to resolve references to other
+     * directories. Throws an exception if a referenced histogram is not found or its binning does
+     * not match.
+     */
+    void Apply(PlotContent &content, std::string const &dirName = "");
+    
+    /// Clears the cache of contents of other directories
+    void ClearCache();
+    
+    /**
+     * \brief Defines a derived process
+     * 
+     * The title is used in the legend; if it is empty, the title of the replaced process or the
+     * name is used. A negative colour means that the colour of the replaced process or the
+     * default one is used. Throws an exception if the expression cannot be parsed or the name has
+     * already been defined.
+     */
+    void Define(std::string const &name, std::string const &expression,
+     std::string const &title = "", int colour = -1);
+    
+    /// Returns the number of distinct nodes in the graph of expressions, for diagnostics
+    unsigned GetNumNodes() const;
+    
+private:
+    /// Operations in the graph
+    enum class Op
+    {
+        Constant,
+        Leaf,
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Negate,
+        Min,
+        Max
+    };
+    
+    /// Kinds of operands that refer to histograms
+    enum class LeafKind
+    {
+        Hist,
+        Sum,
+        SumExcept
+    };
+    
+    /// Node of the graph
+    struct Node
+    {
+        /// Operation
+        Op op;
+        
+        /// Indices of operands, or -1 if not used
+        int first, second;
+        
+        /// Value of a constant
+        double value;
+        
+        /// Index of the operand that refers to histograms, for leaf nodes
+        unsigned leaf;
+    };
+    
+    /// Operand that refers to one or more histograms
+    struct Leaf
+    {
+        /// Kind of the operand
+        LeafKind kind;
+        
+        /// Directory, possibly with placeholders, or an empty string for the current plot
+        std::string dirName;
+        
+        /// Name of the histogram or pattern for names of processes
+        std::string name;
+    };
+    
+    /// A derived process
+    struct Definition
+    {
+        /// Name of the process
+        std::string name;
+        
+        /// Title for the legend
+        std::string title;
+        
+        /// ROOT index of the fill colour, or a negative value if not specified
+        int colour;
+        
+        /// Index of the node that computes the process
+        unsigned node;
+    };
+    
+private:
+    /**
+     * \brief Adds a node to the graph or returns an identical existing one
+     * 
+     * Operations with constant operands are folded.
+     */
+    unsigned AddNode(Op op, int first = -1, int second = -1, double value = 0., unsigned leaf = 0);
+    
+    /// Adds a leaf node for the given reference to histograms
+    unsigned AddLeaf(LeafKind kind, std::string const &reference);
+    
+    /// Returns the content of the given directory, reading it if needed
+    PlotContent const &GetExternal(std::string const &dirName);
+    
+    /// Parses a sum or difference of terms
+    unsigned ParseExpression(std::string const &text, std::size_t &pos);
+    
+    /// Parses a product or ratio of factors
+    unsigned ParseTerm(std::string const &text, std::size_t &pos);
+    
+    /// Parses a factor with optional unary signs
+    unsigned ParseUnary(std::string const &text, std::size_t &pos);
+    
+    /// Parses a number, an operand, a function call, or an expression in parentheses
+    unsigned ParsePrimary(std::string const &text, std::size_t &pos);
+    
+    /// Parses a reference to histograms in one of the forms name or {dir/name}
+    std::string ParseReference(std::string const &text, std::size_t &pos);
+    
+    /// Creates an exception describing a parsing error at the given position
+    static std::runtime_error ParseError(std::string const &text, std::size_t pos,
+     std::string const &reason);
+    
+private:
+    /// Number of bins processed together in Apply
+    static unsigned const blockSize;
+    
+    /// Reader for other directories, or null if none is given
+    PlotReader const *reader;
+    
+    /// Nodes of the graph. Operands always precede nodes that use them
+    std::vector<Node> nodes;
+    
+    /// Indices of nodes by their operations, operands, constant values, and leaves
+    std::map<std::tuple<int, int, int, std::uint64_t, unsigned>, unsigned> nodeIndices;
+    
+    /// Operands that refer to histograms
+    std::vector<Leaf> leaves;
+    
+    /// Definitions in the order in which they were given
+    std::vector<Definition> definitions;
+    
+    /// Cached contents of other directories
+    std::map<std::string, PlotContent> externals;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <PlotContent.hpp>
+
+#include <TCanvas.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class CampaignDiff;
+class TH1D;
+class TLegend;
+
+
+/**
+ * \class DiffPlot
+ * \brief Overlays the same plot from two productions to visualise a regression
+ * 
+ * The main pad shows the total MC expectation and data from the reference production as a filled
+ * histogram and open markers, and the same quantities from the target production as a line and
+ * filled markers. The lower pad shows the ratios target/reference. The layout and style follow
+ * DataMCPlot. Both plots must have the same binning.
+ */
+class DiffPlot
+{
+public:
+    /// Constructor from descriptions of the plot in the reference and target productions
+    DiffPlot(PlotContent const &ref, PlotContent const &target);
+    
+    /// Copy constructor is deleted
+    DiffPlot(DiffPlot const &) = delete;
+    
+    /// Assignment operator is deleted
+    DiffPlot &operator=(DiffPlot const &) = delete;
+    
+    /// Destructor
+    ~DiffPlot();
+    
+public:
+    /// Draws the figure and returns the canvas
+    TCanvas &Draw();
+    
+    /**
+     * \brief Prints the canvas to a file
+     * 
+     * The figure is drawn if this has not been done yet.
+     */
+    void Print(std::string const &fileName);
+    
+    /**
+     * \brief Draws overlays for all directories that have changed according to the given diff
+     * 
+     * Only directories with status CampaignDiff::Status::Changed are plotted since other changes
+     * cannot be overlaid. Figures are saved in the given directory, which must exist, under names
+     * obtained from paths to the directories in the files with slashes replaced by underscores.
+     * At most the given number of the highest-ranked directories are plotted, with zero meaning no
+     * limit. Returns the number of produced figures.
+     */
+    static unsigned PrintChanged(CampaignDiff const &diff, std::string const &outDirectory,
+     std::string const &extension = "pdf", unsigned maxPlots = 0);
+    
+    /// Sets labels of the two productions. The defaults are "Reference" and "Target"
+    void SetLabels(std::string const &refLabel, std::string const &targetLabel);
+    
+private:
+    /// Total MC expectation and data in one production, not including under- and overflows
+    struct Totals
+    {
+        /// Total MC expectation
+        std::vector<double> mc;
+        
+        /// Data
+        std::vector<double> data;
+    };
+    
+private:
+    /// Sums all MC processes in the given plot
+    static Totals BuildTotals(PlotContent const &content);
+    
+    /// Creates an owned histogram with the given contents and the binning of the plot
+    TH1D *BuildHist(std::string const &name, std::vector<double> const &contents);
+    
+    /**
+     * \brief Creates an object of type T passing arguments Args to its constructor and saves a
+     * pointer to it to the ownedObjects container
+     */
+    template<typename T, typename... Args>
+    T *NewOwnedObject(Args... args);
+    
+private:
+    /**
+     * \brief Title of the plot
+     * 
+     * Follows the usual ROOT format, with axis titles included after semicolons.
+     */
+    std::string title;
+    
+    /// Bin edges
+    std::vector<double> edges;
+    
+    /// Totals in the reference and target productions
+    Totals refTotals, targetTotals;
+    
+    /// Labels of the two productions
+    std::string refLabel, targetLabel;
+    
+    /// Canvas to host the figure
+    std::unique_ptr<TCanvas> canvas;
+    
+    /// Pad that hosts the overlaid histograms
+    std::unique_ptr<TPad> mainPad;
+    
+    /// Legend
+    std::unique_ptr<TLegend> legend;
+    
+    /// List of owned ROOT objects to be deleted by the destructor
+    std::list<TObject *> ownedObjects;
+};
+
+
+template<typename T, typename... Args>
+T *DiffPlot::NewOwnedObject(Args... args)
+{
+    T *obj = new T(args...);
+    ownedObjects.emplace_back(obj);
+    return obj;
+}
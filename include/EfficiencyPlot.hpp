@@ -0,0 +1,193 @@
+#pragma once
+
+#include <BinomialIntervals.hpp>
+
+#include <TCanvas.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+class TGraphAsymmErrors;
+class TH1;
+class TLegend;
+
+
+/**
+ * \class EfficiencyPlot
+ * \brief Creates a plot with a comparison of efficiencies measured in data and MC
+ * 
+ * Inputs are read from a directory in a ROOT file that follows the same conventions as the one
+ * read by DataMCPlot: the title of the plot is stored as a TObjString named "title", and the
+ * numbers of passed and total events are given by histograms "data_passed", "data_total",
+ * "mc_passed", and "mc_total". Confidence intervals for all bins are computed in one batch with
+ * BinomialIntervals rather than with TEfficiency.
+ * 
+ * The figure has the same layout and style as the one produced by DataMCPlot. The lower pad shows
+ * the ratio between efficiencies in data and MC.
+ */
+class EfficiencyPlot
+{
+public:
+    /**
+     * \brief Constructor
+     * 
+     * The arguments are the name of the ROOT file with histograms to be plotted and the name of the
+     * directory in the file that contains the histograms.
+     */
+    EfficiencyPlot(std::string const &srcFileName, std::string const &dirName = "");
+    
+    /// Copy constructor is deleted
+    EfficiencyPlot(EfficiencyPlot const &) = delete;
+    
+    /// Assignment operator is deleted
+    EfficiencyPlot &operator=(EfficiencyPlot const &) = delete;
+    
+    /// Destructor
+    ~EfficiencyPlot();
+    
+public:
+    /**
+     * \brief Draws CMS label in the upper left part of the figure
+     * 
+     * The figure must have been drawn before calling this method. The additional text provided as
+     * the argument is written after the CMS label using a different font.
+     */
+    void AddCMSLabel(std::string const &additionalText = "");
+    
+    /**
+     * \brief Draws a label with energy in the upper right part of the figure
+     * 
+     * The figure must have been drawn before calling this method.
+     */
+    void AddEnergyLabel(std::string const &text);
+    
+    /// Draws the figure
+    TCanvas &Draw();
+    
+    /**
+     * \brief Returns pointer to the legend
+     * 
+     * The pointer is null before the figure is drawn.
+     */
+    std::unique_ptr<TLegend> const &GetLegend();
+    
+    /**
+     * \brief Returns pointer to the main pad, in which efficiencies are drawn
+     * 
+     * The pointer is null before the figure is drawn.
+     */
+    std::unique_ptr<TPad> const &GetMainPad();
+    
+    /// Returns the title of the plot
+    std::string const &GetTitle() const;
+    
+    /**
+     * \brief Prints the canvas to a file
+     * 
+     * As in DataMCPlot, output to a ROOT file also saves the legend.
+     */
+    void Print(std::string const &fileName);
+    
+    /**
+     * \brief Enables or disables plotting of the data/MC ratio
+     * 
+     * The method must be called before the figure is drawn. The last two arguments define the
+     * range for the ratio.
+     */
+    void RequestResiduals(bool plotResiduals, double min = 0.8, double max = 1.2);
+    
+    /**
+     * \brief Sets the method to construct confidence intervals and the confidence level
+     * 
+     * By default, Clopper-Pearson intervals with the confidence level of one standard deviation
+     * are used. The method must be called before the figure is drawn.
+     */
+    void SetIntervals(BinomialIntervals::Method method, double confLevel = 0.682689492137086);
+    
+    /// Sets labels for data and MC in the legend. The defaults are "Data" and "Simulation"
+    void SetLegendLabels(std::string const &dataLabel, std::string const &mcLabel);
+    
+private:
+    /// Numbers of passed and total events in all bins, not including under- and overflows
+    struct Counts
+    {
+        /// Numbers of passed events
+        std::vector<double> passed;
+        
+        /// Numbers of total events
+        std::vector<double> total;
+    };
+    
+private:
+    /**
+     * \brief Computes efficiencies and their confidence intervals and stores them in a graph
+     * 
+     * If the second argument is true, horizontal error bars span the whole bins.
+     */
+    TGraphAsymmErrors *BuildGraph(Counts const &counts, bool fullBinWidth);
+    
+    /**
+     * \brief Creates an object of type T passing arguments Args to its constructor and saves a
+     * pointer to it to the ownedObjects container
+     */
+    template<typename T, typename... Args>
+    T *NewOwnedObject(Args... args);
+    
+    /// Reads histograms from a ROOT file
+    void ReadFile(std::string const &srcFileName, std::string const &dirName);
+    
+private:
+    /**
+     * \brief Title of the plot
+     * 
+     * Follows the usual ROOT format, with axis titles included after semicolons
+     */
+    std::string title;
+    
+    /// Bin edges
+    std::vector<double> edges;
+    
+    /// Numbers of events in data and MC
+    Counts dataCounts, mcCounts;
+    
+    /// Object to compute confidence intervals
+    BinomialIntervals intervals;
+    
+    /// Indicates if the data/MC ratio should be plotted
+    bool plotResiduals;
+    
+    /**
+     * \brief Range for the ratio
+     * 
+     * First value is the minimum, second one is the maximum.
+     */
+    std::pair<double, double> residualsRange;
+    
+    /// Labels for data and MC in the legend
+    std::string dataLabel, mcLabel;
+    
+    /// Canvas to host the figure
+    std::unique_ptr<TCanvas> canvas;
+    
+    /// Pad that hosts the main graph
+    std::unique_ptr<TPad> mainPad;
+    
+    /// Legend
+    std::unique_ptr<TLegend> legend;
+    
+    /// List of owned ROOT objects to be deleted by the destructor
+    std::list<TObject *> ownedObjects;
+};
+
+
+template<typename T, typename... Args>
+T *EfficiencyPlot::NewOwnedObject(Args... args)
+{
+    T *obj = new T(args...);
+    ownedObjects.emplace_back(obj);
+    return obj;
+}
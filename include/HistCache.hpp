@@ -0,0 +1,135 @@
+#pragma once
+
+#include <PlotReader.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class MappedFile;
+
+
+/**
+ * \class HistCache
+ * \brief Binary cache of inputs for data/MC plots that is read through memory mapping
+ * 
+ * The cache is created once from an arbitrary source (e.g. a ROOT file read with RootFileReader)
+ * and stores the content of many directories in a compact uncompressed format. All arrays are
+ * stored as native doubles aligned to 64 bytes, so that reading a directory only requires a
+ * binary search in the index, and arrays are used in place in the mapped memory. Since the file
+ * is mapped in shared mode, concurrent jobs reading the same cache share the page cache.
+ * 
+ * The file consists of a header, a sorted index of directories, descriptors of histograms, arrays
+ * of bin edges and contents, and a table of strings. The format is only guaranteed to be readable
+ * on a machine with the same byte order as the one that created it.
+ */
+class HistCache: public PlotReader
+{
+public:
+    /// Opens an existing cache file
+    HistCache(std::string const &fileName);
+    
+public:
+    /**
+     * \brief Creates a cache file from the given directories of a source
+     * 
+     * The file is first written under a temporary name and then renamed, so that concurrent
+     * readers never see a partially written cache.
+     */
+    static void Create(std::string const &cacheFileName, PlotReader const &source,
+     std::vector<std::string> const &dirNames);
+    
+    /// Writes a cache file with the given contents, indexed by names of directories
+    static void Write(std::string const &cacheFileName,
+     std::map<std::string, PlotContent> const &contents);
+    
+    /// Reads the content of a plot stored in the given directory
+    virtual PlotContent Read(std::string const &dirName = "") const override;
+    
+    /// Returns names of all directories in the cache, in alphabetical order
+    std::vector<std::string> GetDirNames() const;
+    
+private:
+    /// Header of the cache file
+    struct Header
+    {
+        /// Magic string that identifies the format
+        char magic[8];
+        
+        /// Value used to detect a mismatch in byte order
+        std::uint32_t byteOrderMark;
+        
+        /// Number of directories
+        std::uint32_t numDirs;
+        
+        /// Offset of the index of directories
+        std::uint64_t indexOffset;
+        
+        /// Total size of the file
+        std::uint64_t fileSize;
+    };
+    
+    /// Entry in the index of directories
+    struct DirEntry
+    {
+        /// Offset and length of the name of the directory
+        std::uint64_t nameOffset, nameLength;
+        
+        /// Offset and length of the title of the plot
+        std::uint64_t titleOffset, titleLength;
+        
+        /// Offset of the array of bin edges
+        std::uint64_t edgesOffset;
+        
+        /// Offset of the array of histogram descriptors
+        std::uint64_t histsOffset;
+        
+        /// Number of bins
+        std::uint32_t numBins;
+        
+        /// Number of histograms
+        std::uint32_t numHists;
+    };
+    
+    /// Descriptor of a histogram
+    struct HistEntry
+    {
+        /// Offset and length of the name of the histogram
+        std::uint64_t nameOffset, nameLength;
+        
+        /// Offset and length of the title of the histogram
+        std::uint64_t titleOffset, titleLength;
+        
+        /// Offset of the array of bin contents
+        std::uint64_t contentsOffset;
+        
+        /// Offset of the array with sums of squared weights, or zero if it is absent
+        std::uint64_t sumw2Offset;
+        
+        /// Role of the histogram: 0 for data, 1 for MC, 2 and 3 for up and down variations
+        std::uint32_t role;
+        
+        /// Fill colour
+        std::int32_t colour;
+    };
+    
+private:
+    /// Returns a string stored at the given position
+    std::string GetString(std::uint64_t offset, std::uint64_t length) const;
+    
+    /// Returns a view of an array of doubles stored at the given position
+    ArrayView<double> GetArray(std::uint64_t offset, std::uint64_t size) const;
+    
+private:
+    /// Memory-mapped cache file
+    std::shared_ptr<MappedFile> file;
+    
+    /// Pointer to the index of directories in the mapped memory
+    DirEntry const *index;
+    
+    /// Number of directories
+    std::uint32_t numDirs;
+};
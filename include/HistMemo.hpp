@@ -0,0 +1,129 @@
+#pragma once
+
+#include <PlotContent.hpp>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+/**
+ * \class HistMemo
+ * \brief Persistent memoization of filled histograms on disk
+ * 
+ * Producing inputs for a plot from ntuples requires running an event loop, which is wasteful when
+ * only the cosmetics of the plot change between iterations. This class stores the outcome of each
+ * production in a directory on disk, keyed by a canonical description of everything that
+ * determines it: identity of the input files, selection, plotted variable, binning, event weight,
+ * and an optional version tag of the production code. Repeated requests read the cached arrays
+ * through memory mapping (see HistCache) and do not run the event loop.
+ * 
+ * The identity of an input file consists of its canonical path, size, and modification time, so
+ * that the cache is invalidated automatically when an input file is rewritten. Expressions are
+ * canonicalised by dropping whitespace except between two characters that can form an
+ * identifier or a number, so that e.g. "pt>30&&abs(eta)<2.4" and "pt > 30 && abs(eta) < 2.4" share
+ * the cache entry. The order of input files does not matter.
+ * 
+ * Each entry is stored in a separate file, whose name is derived from a 64-bit hash of the
+ * description. The full description is stored in the file as well and is checked on reading, so
+ * that hash collisions and corrupted files result in a recomputation rather than a wrong result.
+ * Entries are written atomically, and the same cache directory can be used by concurrent jobs.
+ * Entries made obsolete by changes in input files are not removed automatically.
+ */
+class HistMemo
+{
+public:
+    /// Description of a production of histograms
+    struct Request
+    {
+        /// Input files, whose union defines the dataset
+        std::vector<std::string> inputFiles;
+        
+        /// Selection expression
+        std::string selection;
+        
+        /// Expression for the plotted variable
+        std::string variable;
+        
+        /// Expression for the event weight
+        std::string weight;
+        
+        /// Bin edges
+        std::vector<double> edges;
+        
+        /**
+         * \brief Free-form tag that identifies the version of the production code
+         * 
+         * Changing the tag invalidates the cache when the production code changes in a way that is
+         * not reflected in the other fields, e.g. when new processes are added.
+         */
+        std::string version;
+    };
+    
+    /// Function that produces histograms for a request by running the event loop
+    typedef std::function<PlotContent()> Producer;
+    
+public:
+    /**
+     * \brief Constructor from the path to the cache directory
+     * 
+     * The directory is created if it does not exist.
+     */
+    HistMemo(std::string const &cacheDir);
+    
+    /// Copy constructor is deleted
+    HistMemo(HistMemo const &) = delete;
+    
+    /// Assignment operator is deleted
+    HistMemo &operator=(HistMemo const &) = delete;
+    
+public:
+    /**
+     * \brief Checks if the cache contains a valid entry for the given request
+     * 
+     * Throws an exception if an input file is not accessible.
+     */
+    bool Contains(Request const &request) const;
+    
+    /**
+     * \brief Returns canonical description of the given request
+     * 
+     * The description is used as the key of the cache. Throws an exception if an input file is not
+     * accessible.
+     */
+    static std::string Describe(Request const &request);
+    
+    /**
+     * \brief Returns histograms for the given request
+     * 
+     * If the cache contains a valid entry, it is returned, and the producer is not called.
+     * Otherwise the histograms are produced with the given function and stored in the cache. The
+     * method can be called concurrently from multiple threads.
+     */
+    PlotContent Get(Request const &request, Producer const &producer);
+    
+    /// Returns the number of requests served from the cache
+    unsigned GetNumHits() const;
+    
+    /// Returns the number of requests for which the producer was called
+    unsigned GetNumMisses() const;
+    
+private:
+    /// Returns name of the file for the entry with the given description
+    std::string GetEntryFileName(std::string const &description) const;
+    
+    /**
+     * \brief Tries to read the entry with the given description
+     * 
+     * Returns false if there is no such entry or the file is not valid.
+     */
+    bool TryRead(std::string const &description, PlotContent &content) const;
+    
+private:
+    /// Path to the cache directory
+    std::string cacheDir;
+    
+    /// Counters of hits and misses
+    std::atomic<unsigned> numHits, numMisses;
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <DataMCPlot.hpp>
+#include <SharedHistFeed.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/**
+ * \class LiveDataMCPlot
+ * \brief Data/MC plot for online monitoring that follows a shared-memory histogram feed
+ * 
+ * Histograms are taken directly from the buffer published by a SharedHistFeedWriter, without
+ * intermediate copies or files. The plot is only redrawn when the producer has published new
+ * contents and a minimal time interval has passed since the previous redraw, so that a monitoring
+ * loop can call Update as often as it likes.
+ * 
+ * Since DataMCPlot must be configured before it is drawn, a new plot is created at each redraw.
+ * Settings such as residuals or labels are applied with user-provided functions.
+ */
+class LiveDataMCPlot
+{
+public:
+    /**
+     * \brief Constructor
+     * 
+     * Attaches to the shared-memory segment with the given name. The second argument is the
+     * minimal interval between two redraws, in seconds.
+     */
+    LiveDataMCPlot(std::string const &segmentName, double minInterval = 1.);
+    
+public:
+    /// Returns the plot drawn at the last redraw, or a null pointer if it has not been drawn yet
+    DataMCPlot *GetPlot();
+    
+    /**
+     * \brief Sets a function to be applied to each new plot before it is drawn
+     * 
+     * Can be used to call DataMCPlot::RequestResiduals, DataMCPlot::NormalizeMCToData, etc.
+     */
+    void SetConfigurator(std::function<void(DataMCPlot &)> const &configurator);
+    
+    /**
+     * \brief Sets a function to be applied to each new plot after it has been drawn
+     * 
+     * Can be used to add labels with DataMCPlot::AddCMSLabel and DataMCPlot::AddEnergyLabel.
+     */
+    void SetDecorator(std::function<void(DataMCPlot &)> const &decorator);
+    
+    /**
+     * \brief Redraws the plot if needed and prints it to the given files
+     * 
+     * The plot is redrawn if the feed has been updated since the last redraw and the minimal
+     * interval has passed. Returns true if the plot has been redrawn.
+     */
+    bool Update(std::vector<std::string> const &outFileNames = {});
+    
+private:
+    /// Histogram feed
+    SharedHistFeedReader feed;
+    
+    /// Minimal interval between two redraws
+    std::chrono::steady_clock::duration minInterval;
+    
+    /// Time of the last redraw
+    std::chrono::steady_clock::time_point lastRedraw;
+    
+    /// Generation of the feed shown in the current plot
+    std::uint64_t lastGeneration;
+    
+    /// Current plot
+    std::unique_ptr<DataMCPlot> plot;
+    
+    /// Function applied to each plot before drawing
+    std::function<void(DataMCPlot &)> configurator;
+    
+    /// Function applied to each plot after drawing
+    std::function<void(DataMCPlot &)> decorator;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+
+/**
+ * \class MappedFile
+ * \brief Maps a file into memory in read-only mode
+ * 
+ * The mapping is shared, so that the page cache is reused by all processes that map the same file.
+ * The content of the file is accessible until the object is destroyed.
+ */
+class MappedFile
+{
+public:
+    /**
+     * \brief Constructor
+     * 
+     * Opens the file with the given name and maps it into memory. Throws an exception if the file
+     * cannot be opened or mapped.
+     */
+    MappedFile(std::string const &fileName);
+    
+    /// Copy constructor is deleted
+    MappedFile(MappedFile const &) = delete;
+    
+    /// Assignment operator is deleted
+    MappedFile &operator=(MappedFile const &) = delete;
+    
+    /// Destructor
+    ~MappedFile();
+    
+public:
+    /// Returns pointer to the beginning of the mapped content
+    char const *GetData() const;
+    
+    /// Returns name of the mapped file
+    std::string const &GetFileName() const;
+    
+    /// Returns size of the mapped content, in bytes
+    std::size_t GetSize() const;
+    
+private:
+    /// Name of the mapped file
+    std::string fileName;
+    
+    /// Pointer to the mapped memory
+    char const *data;
+    
+    /// Size of the mapped memory
+    std::size_t size;
+};
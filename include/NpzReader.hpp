@@ -0,0 +1,99 @@
+#pragma once
+
+#include <PlotReader.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class MappedFile;
+
+
+/**
+ * \class NpzReader
+ * \brief Reads inputs for data/MC plots from NumPy .npz archives
+ * 
+ * The archive is memory-mapped, and arrays of type float64 are viewed in place without copying.
+ * Arrays of other numeric types are converted. Only uncompressed archives, as produced by
+ * numpy.savez, are supported.
+ * 
+ * Histograms for a plot are stored in the archive under keys "<dirName>/<name>" or simply "<name>"
+ * if the directory name is empty. The following names have a special meaning:
+ *  - "edges": bin edges (mandatory),
+ *  - "data": data histogram (mandatory),
+ *  - "syst_up", "syst_down": systematic variations of the total MC expectation,
+ *  - "title": title of the plot, stored as a zero-dimensional string array.
+ * All other one-dimensional arrays are interpreted as MC processes, in the order in which they are
+ * stored in the archive. Histograms may include under- and overflow bins (in which case they have
+ * two elements more than the number of bins) or not (the same length as the number of bins).
+ */
+class NpzReader: public PlotReader
+{
+public:
+    /// Constructor from the name of the .npz file
+    NpzReader(std::string const &fileName);
+    
+public:
+    /// Reads the content of a plot stored in the given directory
+    virtual PlotContent Read(std::string const &dirName = "") const override;
+    
+    /// Returns names of all arrays in the archive, in the order of storage
+    std::vector<std::string> GetArrayNames() const;
+    
+private:
+    /// Position of an uncompressed archive member within the file
+    struct Member
+    {
+        /// Name of the member with the ".npy" suffix removed
+        std::string name;
+        
+        /// Offset of the member's data with respect to the beginning of the file
+        std::size_t offset;
+        
+        /// Size of the member, in bytes
+        std::size_t size;
+    };
+    
+    /// Description of an array stored in .npy format
+    struct NpyArray
+    {
+        /// Type code, e.g. 'f' for floating-point numbers or 'U' for unicode strings
+        char kind;
+        
+        /// Size of an element, in bytes
+        unsigned itemSize;
+        
+        /// Shape of the array. Empty for zero-dimensional arrays
+        std::vector<std::size_t> shape;
+        
+        /// Pointer to the first element
+        char const *data;
+    };
+    
+private:
+    /// Reads the central directory of the zip archive
+    void ReadCentralDirectory();
+    
+    /// Parses the header of an array in .npy format
+    NpyArray ParseArray(Member const &member) const;
+    
+    /**
+     * \brief Returns a view of an array with bin contents
+     * 
+     * The array is viewed in place if it is of type float64 and properly aligned and copied into a
+     * buffer owned by the content otherwise. Under- and overflow bins are added if missing.
+     */
+    ArrayView<double> ReadContents(Member const &member, unsigned numBins,
+     PlotContent &content) const;
+    
+    /// Reads a zero-dimensional string array
+    std::string ReadString(Member const &member) const;
+    
+private:
+    /// Memory-mapped archive
+    std::shared_ptr<MappedFile> file;
+    
+    /// Uncompressed members of the archive, in the order of storage
+    std::vector<Member> members;
+};
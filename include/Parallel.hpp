@@ -0,0 +1,26 @@
+#pragma once
+
+#include <functional>
+
+
+/**
+ * \class Parallel
+ * \brief Minimal worker pool shared by classes that process independent tasks in threads
+ */
+class Parallel
+{
+public:
+    /// Task to be executed for a given index
+    typedef std::function<void(unsigned index)> Task;
+    
+public:
+    /**
+     * \brief Executes the given task for indices [0, numTasks) in parallel threads
+     * 
+     * Tasks are distributed dynamically. If the number of threads is zero, it is chosen based on
+     * the hardware concurrency. The calling thread is used as one of the workers. The first
+     * exception thrown by a task stops the distribution of new tasks and is rethrown once all
+     * threads have finished.
+     */
+    static void Run(unsigned numTasks, unsigned numThreads, Task const &task);
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+
+
+/**
+ * \class Philox
+ * \brief Counter-based random number generator Philox4x32-10
+ * 
+ * The generator maps a 128-bit counter and a 64-bit key to 128 random bits [J. K. Salmon et al.,
+ * SC'11]. Since there is no state, random numbers for any element of a computation (e.g. a
+ * pseudo-experiment or an event) are obtained directly from its index, independently of the order
+ * in which the elements are processed.
+ */
+class Philox
+{
+public:
+    /**
+     * \brief Values of the last counter word that separate streams drawn for different purposes
+     * 
+     * Users of the generator build the counter from the index of an element, e.g. of a
+     * pseudo-experiment or of an event. The last word is set to one of these constants so that
+     * different users do not draw the same numbers for elements with the same index and seed.
+     */
+    enum Domain: std::uint32_t
+    {
+        BootstrapEvent = 0xE7E47,  ///< Event-level bootstrap weights
+        BootstrapBin = 0xB0075,  ///< Bin-level bootstrap fluctuations
+        ToyNuisance = 0x7095  ///< Nuisance parameters in pseudo-experiments
+    };
+    
+public:
+    /// Transforms the counter in place into four random 32-bit numbers, using the seed as the key
+    static void Transform(std::uint32_t ctr[4], std::uint64_t seed);
+    
+    /// Converts a random 32-bit integer into a number uniformly distributed in (0, 1)
+    static double ToUniform(std::uint32_t x);
+    
+private:
+    /// Computes the product of two 32-bit numbers and returns its high and low halves
+    static void MulHiLo(std::uint32_t a, std::uint32_t b, std::uint32_t &hi, std::uint32_t &lo);
+};
+
+
+inline void Philox::Transform(std::uint32_t ctr[4], std::uint64_t seed)
+{
+    std::uint32_t key[2] = {std::uint32_t(seed), std::uint32_t(seed >> 32)};
+    
+    for (int round = 0; round < 10; ++round)
+    {
+        if (round > 0)
+        {
+            key[0] += 0x9E3779B9;
+            key[1] += 0xBB67AE85;
+        }
+        
+        std::uint32_t hi0, lo0, hi1, lo1;
+        MulHiLo(0xD2511F53, ctr[0], hi0, lo0);
+        MulHiLo(0xCD9E8D57, ctr[2], hi1, lo1);
+        
+        std::uint32_t const c1 = ctr[1], c3 = ctr[3];
+        ctr[0] = hi1 ^ c1 ^ key[0];
+        ctr[1] = lo1;
+        ctr[2] = hi0 ^ c3 ^ key[1];
+        ctr[3] = lo0;
+    }
+}
+
+
+inline double Philox::ToUniform(std::uint32_t x)
+{
+    return (x + 0.5) * (1. / 4294967296.);
+}
+
+
+inline void Philox::MulHiLo(std::uint32_t a, std::uint32_t b, std::uint32_t &hi,
+ std::uint32_t &lo)
+{
+    std::uint64_t const product = std::uint64_t(a) * b;
+    hi = std::uint32_t(product >> 32);
+    lo = std::uint32_t(product);
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <BinMask.hpp>
+#include <PlotContent.hpp>
+
+#include <vector>
+
+
+/**
+ * \class PlotBatch
+ * \brief Computes numeric quantities for many plots with identical binning in single passes
+ * 
+ * When plots are small, the overhead of processing each of them separately dominates. This class
+ * packs contents of all MC processes of all plots into a single plots x processes x bins tensor
+ * and data into a plots x bins matrix, and computes total expectations, normalization factors,
+ * residuals, relative systematic bands, and chi2 goodness-of-fit statistics for all plots at once,
+ * with inner loops running over contiguous bins. Results for individual plots are then accessed
+ * through views, and GetContent provides a description of a plot with normalized MC histograms
+ * that can be handed to DataMCPlot.
+ * 
+ * All plots must share the binning and list the same MC processes in the same order. All arrays
+ * include under- and overflow bins. Bins of individual plots can be blinded as in DataMCPlot.
+ */
+class PlotBatch
+{
+public:
+    /**
+     * \brief Constructor
+     * 
+     * Copies contents of the given plots. Throws an exception if the plots are not compatible.
+     */
+    PlotBatch(std::vector<PlotContent> const &plots);
+    
+public:
+    /**
+     * \brief Computes all quantities
+     * 
+     * If the first argument is true, MC processes in each plot are rescaled so that the total
+     * expectation has the same normalization as data, as done by DataMCPlot::NormalizeMCToData.
+     * The second argument tells whether histograms represent event densities, in which case
+     * integrals are weighted with bin widths. Under- and overflow bins are assigned the widths of
+     * the adjacent bins. Blinded bins are excluded from the normalization. Inputs are not modified,
+     * and the method can be called again with different arguments.
+     */
+    void Compute(bool normalize, bool isDensity = false);
+    
+    /**
+     * \brief Returns the chi2 between data and the total expectation for the given plot
+     * 
+     * Only bins with a positive expectation are included, and uncertainties of data and MC are
+     * added in quadrature. Under- and overflow bins and blinded bins are not included.
+     */
+    double GetChi2(unsigned plot) const;
+    
+    /**
+     * \brief Returns the description of the given plot with rescaled MC histograms
+     * 
+     * The views refer to memory owned by this object, which must outlive the returned object.
+     */
+    PlotContent GetContent(unsigned plot) const;
+    
+    /// Returns the number of degrees of freedom for the chi2
+    unsigned GetNdf(unsigned plot) const;
+    
+    /// Returns the normalization factor applied to MC processes of the given plot
+    double GetNormFactor(unsigned plot) const;
+    
+    /// Returns the number of bins, not counting under- and overflow bins
+    unsigned GetNumBins() const;
+    
+    /// Returns the number of plots
+    unsigned GetNumPlots() const;
+    
+    /**
+     * \brief Returns relative systematic variations of the total expectation
+     * 
+     * Both variations are non-negative. They are zero if a plot has no systematic uncertainties
+     * or the total expectation in a bin is not positive.
+     */
+    ArrayView<double> GetRelBandDown(unsigned plot) const;
+    
+    /// See GetRelBandDown
+    ArrayView<double> GetRelBandUp(unsigned plot) const;
+    
+    /**
+     * \brief Returns relative residuals (data - MC) / MC
+     * 
+     * Residuals are set to zero in bins where the total expectation is not positive and in
+     * blinded bins.
+     */
+    ArrayView<double> GetResiduals(unsigned plot) const;
+    
+    /// Returns uncertainties of the residuals due to data
+    ArrayView<double> GetResidualErrors(unsigned plot) const;
+    
+    /// Returns the total MC expectation for the given plot
+    ArrayView<double> GetTotal(unsigned plot) const;
+    
+    /**
+     * \brief Blinds bins of the given plot
+     * 
+     * Data in bins hidden by the mask are excluded from the normalization, the residuals, and the
+     * chi2, as done by DataMCPlot (e.g. the mask can be taken from DataMCPlot::GetBlinding). Must
+     * be called before Compute. Throws an exception if the mask does not match the binning.
+     */
+    void SetBlinding(unsigned plot, BinMask const &mask);
+    
+private:
+    /// Returns a view of a row of a matrix with a row length of numBins + 2
+    ArrayView<double> GetRow(std::vector<double> const &matrix, unsigned row) const;
+    
+private:
+    /// Numbers of plots, processes, and bins (not including under- and overflow)
+    unsigned numPlots, numProcesses, numBins;
+    
+    /// Descriptions of the input plots, with views referring to the original memory
+    std::vector<PlotContent> plots;
+    
+    /// Widths of bins, including under- and overflow bins
+    std::vector<double> widths;
+    
+    /// Blinded bins of each plot
+    std::vector<BinMask> masks;
+    
+    /// Input MC contents and sums of squared weights, indexed as [plot][process][bin]
+    std::vector<double> mcContents, mcSumw2;
+    
+    /// Data contents and variances, indexed as [plot][bin]
+    std::vector<double> dataContents, dataVar;
+    
+    /// Input absolute systematic variations of the total expectation, indexed as [plot][bin]
+    std::vector<double> systUp, systDown;
+    
+    /// Normalized MC contents and sums of squared weights, indexed as [plot][process][bin]
+    std::vector<double> scaledContents, scaledSumw2;
+    
+    /// Normalized systematic variations of the total expectation, indexed as [plot][bin]
+    std::vector<double> scaledSystUp, scaledSystDown;
+    
+    /// Results of the computation, indexed as [plot][bin]
+    std::vector<double> totals, totalSumw2, residuals, residualErrors, relBandUp, relBandDown;
+    
+    /// Results of the computation, indexed by plot
+    std::vector<double> normFactors, chi2;
+    
+    /// Numbers of degrees of freedom
+    std::vector<unsigned> ndf;
+};
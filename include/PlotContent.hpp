@@ -0,0 +1,113 @@
+#pragma once
+
+#include <ArrayView.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/**
+ * \class PlotContent
+ * \brief ROOT-free description of the input for a data/MC plot
+ * 
+ * Contains the same information as a directory in a ROOT file read by DataMCPlot: title of the
+ * plot, binning, data and MC histograms, and optional histograms with systematic uncertainties.
+ * Bin contents are stored as non-owning views, which can refer to memory mapped from a file or to
+ * buffers adopted by this object. Objects that own the memory (e.g. a MappedFile) are kept alive
+ * by shared pointers, so that copies of a PlotContent remain valid.
+ * 
+ * All arrays with bin contents include under- and overflow bins, i.e. they follow the layout of
+ * arrays in ROOT histograms and contain GetNumBins() + 2 elements.
+ */
+class PlotContent
+{
+public:
+    /// Bin contents of a single histogram
+    struct Hist
+    {
+        /// Constructor
+        Hist();
+        
+        /// Name of the histogram, e.g. name of a process
+        std::string name;
+        
+        /// Title of the histogram, which is used in the legend
+        std::string title;
+        
+        /// Bin contents, including under- and overflow bins
+        ArrayView<double> contents;
+        
+        /**
+         * \brief Sums of squared weights
+         * 
+         * Can be empty, in which case the uncertainty in each bin is the square root of its
+         * content.
+         */
+        ArrayView<double> sumw2;
+        
+        /// ROOT index of the fill colour, or a negative value if not specified
+        int colour;
+    };
+    
+public:
+    /// Returns number of bins, not counting under- and overflow bins
+    unsigned GetNumBins() const;
+    
+    /// Checks if histograms with systematic uncertainties are provided
+    bool HasSystematics() const;
+    
+    /**
+     * \brief Finds a histogram with the given name among data and MC processes
+     * 
+     * Returns a null pointer if there is no such histogram.
+     */
+    Hist const *FindHist(std::string const &name) const;
+    
+    /**
+     * \brief Takes ownership of the given buffer and returns a view of it
+     * 
+     * The buffer is kept alive as long as this object or any of its copies exists.
+     */
+    ArrayView<double> Adopt(std::vector<double> &&buffer);
+    
+    /// Makes sure that the given object stays alive as long as this object or its copies exist
+    void KeepAlive(std::shared_ptr<void const> const &owner);
+    
+    /**
+     * \brief Checks consistency of sizes of all arrays
+     * 
+     * Throws an exception if inconsistencies are found or the data histogram is missing. The
+     * argument is only used to compose the error message.
+     */
+    void Validate(std::string const &source) const;
+    
+public:
+    /**
+     * \brief Title of the plot
+     * 
+     * Follows the usual ROOT format, with axis titles included after semicolons.
+     */
+    std::string title;
+    
+    /// Bin edges, GetNumBins() + 1 values
+    ArrayView<double> edges;
+    
+    /// Data histogram
+    Hist data;
+    
+    /// MC histograms, in the order in which they should appear in the legend
+    std::vector<Hist> processes;
+    
+    /**
+     * \brief Absolute up and down systematic variations of the total MC expectation
+     * 
+     * The views are empty if systematic uncertainties are not available. In case of a two-sided
+     * variation, contents of the two histograms have opposite signs.
+     */
+    Hist systUp, systDown;
+    
+private:
+    /// Objects that own the memory referred to by the views
+    std::vector<std::shared_ptr<void const>> owners;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <DataMCPlot.hpp>
+
+#include <TCanvas.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/**
+ * \class PlotGrid
+ * \brief Draws several data-MC figures as panels of a grid in a single canvas
+ * 
+ * Each panel is drawn by DataMCPlot::DrawInPad and keeps its own stack and lower pads. Titles of
+ * the axes and the legend are shared: the axis titles are taken from the first figure and placed
+ * along the bottom and left edges of the grid, and the legend of the first figure is moved into a
+ * column to the right of the grid. It is therefore assumed that all figures show the same variable
+ * and the same processes. The plain title of each figure (the part before the axis titles) is
+ * written in the upper left corner of its panel.
+ * 
+ * All panels are painted and printed together, as a single canvas.
+ */
+class PlotGrid
+{
+public:
+    /**
+     * \brief Constructor
+     * 
+     * The arguments are the numbers of columns and rows in the grid and the size of a single
+     * panel in pixels.
+     */
+    PlotGrid(unsigned numColumns, unsigned numRows, unsigned panelWidth = 600,
+     unsigned panelHeight = 500);
+    
+    /// Copy constructor is deleted
+    PlotGrid(PlotGrid const &) = delete;
+    
+    /// Assignment operator is deleted
+    PlotGrid &operator=(PlotGrid const &) = delete;
+    
+    /// Destructor
+    ~PlotGrid();
+    
+public:
+    /**
+     * \brief Adds a figure to the next free panel
+     * 
+     * Panels are filled row by row. The figure must be configured (e.g. normalized) before the
+     * grid is drawn and must not be drawn on its own. Throws an exception if all panels are taken.
+     */
+    void AddPlot(std::unique_ptr<DataMCPlot> &&plot);
+    
+    /**
+     * \brief Draws CMS label above the upper left corner of the grid
+     * 
+     * The grid must have been drawn before calling this method.
+     */
+    void AddCMSLabel(std::string const &additionalText = "");
+    
+    /**
+     * \brief Draws a label above the upper right corner of the grid
+     * 
+     * The grid must have been drawn before calling this method.
+     */
+    void AddEnergyLabel(std::string const &text);
+    
+    /// Draws all panels and shared decorations
+    TCanvas &Draw();
+    
+    /// Returns figures included in the grid
+    std::vector<std::unique_ptr<DataMCPlot>> const &GetPlots() const;
+    
+    /**
+     * \brief Prints the canvas to a file
+     * 
+     * ROOT files receive the canvas and the shared legend, as done in DataMCPlot::Print.
+     */
+    void Print(std::string const &fileName);
+    
+private:
+    /**
+     * \brief Creates a new ROOT object of type T using the given arguments for the constructor
+     * and adds a pointer to it to the ownedObjects container
+     */
+    template<typename T, typename... Args>
+    T *NewOwnedObject(Args... args);
+    
+private:
+    /// Numbers of columns and rows
+    unsigned numColumns, numRows;
+    
+    /// Size of a single panel in pixels
+    unsigned panelWidth, panelHeight;
+    
+    /// Figures shown in the panels
+    std::vector<std::unique_ptr<DataMCPlot>> plots;
+    
+    /// Canvas to host the grid
+    std::unique_ptr<TCanvas> canvas;
+    
+    /// Pad that hosts all panels
+    std::unique_ptr<TPad> gridPad;
+    
+    /// List of owned ROOT objects to be deleted by the destructor, see DataMCPlot
+    std::list<TObject *> ownedObjects;
+};
+
+
+template<typename T, typename... Args>
+T *PlotGrid::NewOwnedObject(Args... args)
+{
+    T *obj = new T(args...);
+    ownedObjects.emplace_back(obj);
+    return obj;
+}
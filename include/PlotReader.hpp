@@ -0,0 +1,39 @@
+#pragma once
+
+#include <PlotContent.hpp>
+
+#include <memory>
+#include <string>
+
+
+/**
+ * \class PlotReader
+ * \brief Abstract base class for readers of inputs for data/MC plots that do not rely on ROOT I/O
+ * 
+ * A reader is associated with a single file, which can contain inputs for several plots. Inputs for
+ * a plot are identified with a name of a directory, in analogy with ROOT files.
+ */
+class PlotReader
+{
+public:
+    /// Virtual destructor
+    virtual ~PlotReader() = default;
+    
+public:
+    /**
+     * \brief Creates a reader suitable for the given file
+     * 
+     * The format is deduced from the extension of the file name: ".npz" for NumPy archives,
+     * ".arrow", ".feather", or ".ipc" for Arrow IPC files, ".json" for UHI JSON serialisation, and
+     * ".root" for ROOT files, which are read with the lightweight RootFileReader. Throws an
+     * exception if the extension is not recognised.
+     */
+    static std::unique_ptr<PlotReader> Open(std::string const &fileName);
+    
+    /**
+     * \brief Reads the content of a plot stored in the given directory
+     * 
+     * Throws an exception if the directory does not contain a valid input for a plot.
+     */
+    virtual PlotContent Read(std::string const &dirName = "") const = 0;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+class TAxis;
+class TH1;
+class TLatex;
+class TPad;
+
+
+/**
+ * \class PlotStyle
+ * \brief Style and layout shared by all figures produced by the package
+ * 
+ * Figures consist of a main pad and optional lower pads (e.g. with residuals) that share the x
+ * axis with it. This class collects the decoration settings so that figures of different types
+ * (DataMCPlot, EfficiencyPlot) look alike.
+ */
+class PlotStyle
+{
+public:
+    /// Margin for axis labels, in units of the canvas
+    static double const margin;
+    
+    /// Width of the main pad, not including the margin
+    static double const mainPadWidth;
+    
+    /// Height of a lower pad, not including margins
+    static double const lowerPadHeight;
+    
+public:
+    /**
+     * \brief Sets decoration of a text label drawn in NDC coordinates
+     * 
+     * The second argument is the alignment in ROOT conventions.
+     */
+    static void ConfigureLabel(TLatex &label, short align);
+    
+    /**
+     * \brief Sets margins and decoration of a pad drawn below the main pad
+     * 
+     * The pad has no top margin. If the last argument is true, the pad hosts labels of the x axis
+     * and is given a bottom margin for them.
+     */
+    static void ConfigureLowerPad(TPad &pad, bool hostsXLabels);
+    
+    /**
+     * \brief Adjusts axes of a histogram drawn in a lower pad
+     * 
+     * Labels and titles are given the same size as on the given x axis of the main pad (the actual
+     * text size for the default font is linked up with the pad's smallest dimension). Tick lengths
+     * on the x axis are rescaled by the ratio between heights of frames in the main and lower pads,
+     * which is given as the last argument.
+     */
+    static void MatchLowerAxes(TH1 &hist, TAxis const &mainXAxis, TPad const &mainPad,
+     TPad const &lowerPad, double frameHeightRatio);
+    
+    /// Sets global ROOT style options
+    static void SetGlobal();
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <PlotReader.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+class MappedFile;
+
+
+/**
+ * \class RootFileReader
+ * \brief Lightweight reader of histograms from ROOT files that does not depend on ROOT libraries
+ * 
+ * The reader understands the subset of the ROOT file format needed to read inputs for data/MC
+ * plots: the file header, directories, and keys. Objects compressed with ZLIB and LZ4 are
+ * supported; ZSTD is supported if the library is built with HEP_PLOT_UTILS_ZSTD defined. Only
+ * histograms of classes TH1D, TH1F, TH1I, TH1S, and TH1C (their titles, binning, fill colours, bin
+ * contents, and sums of squared weights) and strings of class TObjString are deserialised.
+ * 
+ * The layout of a directory is the same as expected by DataMCPlot: the data histogram is named
+ * "data", systematic variations "syst_up" and "syst_down", and the title of the plot is stored as
+ * a TObjString named "title". All other one-dimensional histograms are MC processes.
+ */
+class RootFileReader: public PlotReader
+{
+public:
+    /**
+     * \brief Summary of a stored object that allows detecting changes without decompressing it
+     * 
+     * Two objects with identical digests are, with overwhelming probability, identical. The
+     * converse does not hold: the same content can be stored differently, e.g. with a different
+     * compression setting.
+     */
+    struct ObjectDigest
+    {
+        /// Name of the object
+        std::string name;
+        
+        /// Name of the class of the object
+        std::string className;
+        
+        /// Size of the object as stored in the file, i.e. after compression
+        std::uint32_t storedSize;
+        
+        /// Size of the uncompressed object
+        std::uint32_t objLength;
+        
+        /**
+         * \brief Checksum of the stored bytes of the object
+         * 
+         * Set to zero for directories, whose records refer to positions in the file and therefore
+         * are not comparable between files.
+         */
+        std::uint64_t checksum;
+    };
+    
+    /// Summary of a directory that contains a plot
+    struct PlotInfo
+    {
+        /// Full path to the directory
+        std::string dirName;
+        
+        /// Number of MC processes
+        unsigned numProcesses;
+        
+        /// Number of bins, not counting under- and overflow bins
+        unsigned numBins;
+        
+        /// Indicates if both systematic variations are present
+        bool hasSystematics;
+    };
+    
+public:
+    /// Constructor from the name of the ROOT file
+    RootFileReader(std::string const &fileName);
+    
+public:
+    /// Reads the content of a plot stored in the given directory
+    virtual PlotContent Read(std::string const &dirName = "") const override;
+    
+    /**
+     * \brief Returns names of all objects in the given directory
+     * 
+     * Only the highest cycle is included for each name.
+     */
+    std::vector<std::string> GetKeyNames(std::string const &dirName = "") const;
+    
+    /**
+     * \brief Checks if the file contains a directory with the given path
+     * 
+     * Throws an exception if the file is corrupted.
+     */
+    bool HasDirectory(std::string const &dirName) const;
+    
+    /**
+     * \brief Returns digests of all objects in the given directory
+     * 
+     * Digests are computed from raw stored bytes, and no object is decompressed. Only the highest
+     * cycle is included for each name, and the order of objects is the same as in GetKeyNames.
+     */
+    std::vector<ObjectDigest> GetDigests(std::string const &dirName = "") const;
+    
+    /**
+     * \brief Finds all directories that contain plots, i.e. a data histogram
+     * 
+     * The directory tree is traversed recursively starting from the given directory, which is
+     * included in the search. Branches rooted at its immediate subdirectories are processed in
+     * parallel threads, whose number is chosen based on the hardware concurrency if the last
+     * argument is zero. Plots are returned in the order of a depth-first traversal, with
+     * directories visited in the order of their keys. Only the data histogram is decompressed in
+     * each plot.
+     */
+    std::vector<PlotInfo> FindPlots(std::string const &dirName = "", unsigned numThreads = 0)
+     const;
+    
+    /**
+     * \brief Reads plots from the given directories in parallel threads
+     * 
+     * The order of the result matches the order of the directories. If the last argument is zero,
+     * the number of threads is chosen based on the hardware concurrency. Together with FindPlots,
+     * this allows filling a PlotBatch with all plots of a given binning.
+     */
+    std::vector<PlotContent> ReadAll(std::vector<std::string> const &dirNames,
+     unsigned numThreads = 0) const;
+    
+    /// Checks if the object with the given class name is a directory
+    static bool IsDirectory(std::string const &className);
+    
+private:
+    /// Header of a TKey
+    struct Key
+    {
+        /// Total size of the key including the compressed object
+        std::uint32_t numBytes;
+        
+        /// Size of the uncompressed object
+        std::uint32_t objLength;
+        
+        /// Size of the key header
+        std::uint16_t keyLength;
+        
+        /// Cycle number
+        std::int16_t cycle;
+        
+        /// Position of the key in the file
+        std::uint64_t seekKey;
+        
+        /// Name of the class of the stored object
+        std::string className;
+        
+        /// Name of the object
+        std::string name;
+        
+        /// Title of the object
+        std::string title;
+    };
+    
+    /// A one-dimensional histogram deserialised from the file
+    struct Hist
+    {
+        /// Title of the histogram
+        std::string title;
+        
+        /// Bin edges
+        std::vector<double> edges;
+        
+        /// Bin contents including under- and overflow bins
+        std::vector<double> contents;
+        
+        /// Sums of squared weights, possibly empty
+        std::vector<double> sumw2;
+        
+        /// Fill colour
+        int fillColour;
+    };
+    
+private:
+    /**
+     * \brief Reads keys of a directory whose record is located at the given position
+     * 
+     * Only the highest cycle of each object is retained.
+     */
+    std::vector<Key> ReadDirectory(std::uint64_t recordPos) const;
+    
+    /// Finds the directory with the given path and returns its keys
+    std::vector<Key> FindDirectory(std::string const &dirName) const;
+    
+    /**
+     * \brief Looks up the directory with the given path
+     * 
+     * If the directory exists, fills its keys and returns true. Otherwise returns false.
+     */
+    bool LookUpDirectory(std::string const &dirName, std::vector<Key> &keys) const;
+    
+    /**
+     * \brief Recursively collects plots in the directory with the given path and keys
+     * 
+     * The directory itself is examined first, then its subdirectories unless the last argument is
+     * false.
+     */
+    void CollectPlots(std::string const &dirName, std::vector<Key> const &keys,
+     std::vector<PlotInfo> &plots, bool recursive = true) const;
+    
+    /// Checks if the object with the given class name is a supported one-dimensional histogram
+    static bool IsHist(std::string const &className);
+    
+    /// Reads and decompresses the object associated with the given key
+    std::vector<char> ReadObject(Key const &key) const;
+    
+    /// Deserialises a one-dimensional histogram
+    Hist ReadHist(Key const &key) const;
+    
+    /// Deserialises a TObjString
+    std::string ReadObjString(Key const &key) const;
+    
+private:
+    /// Memory-mapped file
+    std::shared_ptr<MappedFile> file;
+    
+    /// Position of the record of the top-level directory
+    std::uint64_t topDirPos;
+};
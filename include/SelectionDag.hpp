@@ -0,0 +1,261 @@
+#pragma once
+
+#include <ArrayView.hpp>
+#include <BootstrapHists.hpp>
+#include <PlotContent.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+/**
+ * \class EventBatch
+ * \brief Columnar view of a batch of events
+ * 
+ * Each column is a non-owning view of an array with one value per event, e.g. a branch of an
+ * ntuple read in a block. The user must keep the memory alive while the batch is processed.
+ */
+class EventBatch
+{
+public:
+    /// Constructor for a batch with the given number of events
+    EventBatch(std::size_t numEvents);
+    
+public:
+    /**
+     * \brief Adds a column with the given name
+     * 
+     * Throws an exception if the size of the array does not match the number of events.
+     */
+    void AddColumn(std::string const &name, ArrayView<double> const &values);
+    
+    /// Returns the column with the given name. Throws an exception if there is no such column
+    ArrayView<double> const &GetColumn(std::string const &name) const;
+    
+    /// Returns the number of events in the batch
+    std::size_t GetNumEvents() const;
+    
+private:
+    /// Number of events
+    std::size_t numEvents;
+    
+    /// Columns indexed by their names
+    std::map<std::string, ArrayView<double>> columns;
+};
+
+
+/**
+ * \class SelectionDag
+ * \brief Fills many data/MC plots from the same events with shared evaluation of selections
+ * 
+ * Each plot is defined by a chain of named cuts, a variable, an optional weight, and a binning.
+ * Chains are merged into a prefix tree of selection nodes: two plots whose chains start with the
+ * same cuts in the same order share the nodes for that prefix. For every batch of events, each
+ * node is evaluated once, only on the events that pass its parent, and the list of surviving
+ * events is cached for the duration of the batch. Thus the cost per event grows with the number of
+ * distinct selection steps rather than the number of plots, and cuts placed first in the chains
+ * are evaluated on the most events.
+ * 
+ * Derived columns, which are evaluated once per event for all events in the batch, can be defined
+ * to share common sub-expressions among cuts, variables, and weights.
+ * 
+ * Batches are filled for named samples. The sample named "data" is used as the data histogram,
+ * while all other samples are MC processes, which appear in the order in which they were first
+ * filled. Filled plots are returned as PlotContent and can be given directly to DataMCPlot or
+ * PlotBatch.
+ * 
+ * Optionally, Poisson-bootstrap replicas of the data histograms are filled in the same pass (see
+ * EnableBootstrap). Poisson weights of an event are generated once and reused for all plots that
+ * select it.
+ */
+class SelectionDag
+{
+public:
+    /// Predicate on the value of a single column
+    typedef std::function<bool(double)> ValueCut;
+    
+    /// General predicate that can access all columns of an event in a batch
+    typedef std::function<bool(EventBatch const &, std::size_t)> EventCut;
+    
+    /// Expression for a derived column
+    typedef std::function<double(EventBatch const &, std::size_t)> Expression;
+    
+public:
+    /// Default constructor
+    SelectionDag();
+    
+public:
+    /**
+     * \brief Registers a plot
+     * 
+     * The cuts are applied in the given order and must have been defined already. The variable
+     * and weight refer to columns of the batches or derived columns. If the weight is empty, all
+     * events are given unit weights. The title of the plot follows the ROOT format.
+     */
+    void AddPlot(std::string const &name, std::vector<std::string> const &cuts,
+     std::string const &variable, std::vector<double> const &edges, std::string const &title = "",
+     std::string const &weight = "");
+    
+    /// Defines a cut on the value of the given column (which may be a derived one)
+    void DefineCut(std::string const &name, std::string const &column, ValueCut const &cut);
+    
+    /// Defines a general cut
+    void DefineCut(std::string const &name, EventCut const &cut);
+    
+    /**
+     * \brief Defines a derived column
+     * 
+     * The expression can refer to columns of the batch and to derived columns defined earlier.
+     */
+    void DefineColumn(std::string const &name, Expression const &expression);
+    
+    /**
+     * \brief Requests bootstrap replicas of data histograms for all plots
+     * 
+     * The column with the given name must provide an identifier of each data event, unique within
+     * the dataset and exactly representable as double. Replicas are filled together with the data
+     * histograms and can be accessed with GetBootstrap. Must be called before any data are
+     * filled.
+     */
+    void EnableBootstrap(unsigned numReplicas, std::string const &eventIdColumn,
+     std::uint64_t seed = 0);
+    
+    /**
+     * \brief Processes a batch of events for the given sample
+     * 
+     * All plots are filled.
+     */
+    void Fill(EventBatch const &batch, std::string const &sample);
+    
+    /**
+     * \brief Returns the content of the plot with the given name
+     * 
+     * If no data have been filled, the data histogram contains zeros. The returned object owns its
+     * memory.
+     */
+    PlotContent GetContent(std::string const &plotName) const;
+    
+    /**
+     * \brief Returns bootstrap replicas of the data histogram of the given plot
+     * 
+     * Throws an exception if bootstrap has not been enabled.
+     */
+    BootstrapHists const &GetBootstrap(std::string const &plotName) const;
+    
+    /// Returns the total number of cut evaluations performed, for diagnostics
+    std::uint64_t GetNumCutEvaluations() const;
+    
+    /// Returns the number of distinct selection nodes
+    unsigned GetNumNodes() const;
+    
+    /// Returns names of all plots in the order in which they were added
+    std::vector<std::string> GetPlotNames() const;
+    
+private:
+    /// A named cut
+    struct Cut
+    {
+        /// Column for a cut on a single value, empty for a general cut
+        std::string column;
+        
+        /// Predicate for a cut on a single value
+        ValueCut valueCut;
+        
+        /// General predicate
+        EventCut eventCut;
+    };
+    
+    /// Node of the selection tree, which applies a cut to the events that pass its parent
+    struct Node
+    {
+        /// Index of the parent node, or -1 for nodes attached to the full batch
+        int parent;
+        
+        /// Index of the cut
+        unsigned cut;
+    };
+    
+    /// A plot and its histograms
+    struct Plot
+    {
+        /// Name of the plot
+        std::string name;
+        
+        /// Title of the plot
+        std::string title;
+        
+        /// Index of the node that defines the selection, or -1 if there are no cuts
+        int node;
+        
+        /// Names of the columns with the variable and the weight
+        std::string variable, weight;
+        
+        /// Bin edges
+        std::vector<double> edges;
+        
+        /// Bin contents and sums of squared weights for each sample, indexed by sample
+        std::vector<std::pair<std::vector<double>, std::vector<double>>> hists;
+        
+        /// Bootstrap replicas of the data histogram, or null if bootstrap is not enabled
+        std::unique_ptr<BootstrapHists> bootstrap;
+    };
+    
+private:
+    /// Returns the plot with the given name. Throws an exception if there is no such plot
+    Plot const &FindPlot(std::string const &plotName) const;
+    
+    /// Returns the index of the sample with the given name, registering it if needed
+    unsigned GetSampleIndex(std::string const &sample);
+    
+private:
+    /// Defined cuts
+    std::vector<Cut> cuts;
+    
+    /// Indices of cuts by their names
+    std::map<std::string, unsigned> cutIndices;
+    
+    /// Derived columns in the order of definition
+    std::vector<std::pair<std::string, Expression>> derivedColumns;
+    
+    /**
+     * \brief Selection nodes
+     * 
+     * A node is always added after its parent, so iterating over this vector visits parents first.
+     */
+    std::vector<Node> nodes;
+    
+    /// Indices of nodes by pairs of the parent and the cut
+    std::map<std::pair<int, unsigned>, unsigned> nodeIndices;
+    
+    /// Plots
+    std::vector<Plot> plots;
+    
+    /// Names of samples in the order in which they were first filled
+    std::vector<std::string> samples;
+    
+    /// Buffers for derived columns, reused between batches
+    std::vector<std::vector<double>> derivedBuffers;
+    
+    /// Indices of events that pass each node in the current batch
+    std::vector<std::vector<std::uint32_t>> selected;
+    
+    /// Number of cut evaluations performed
+    std::uint64_t numCutEvaluations;
+    
+    /// Number of bootstrap replicas of data histograms, or 0 if bootstrap is disabled
+    unsigned numBootstrapReplicas;
+    
+    /// Name of the column with identifiers of data events
+    std::string eventIdColumn;
+    
+    /// Seed for Poisson weights of the bootstrap
+    std::uint64_t bootstrapSeed;
+    
+    /// Buffer for Poisson weights of the current event
+    std::vector<std::uint32_t> poissonWeights;
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <PlotReader.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/**
+ * \class SharedHistFeedWriter
+ * \brief Producer side of a shared-memory segment with histograms for live monitoring plots
+ * 
+ * The writer creates a POSIX shared-memory segment that describes a data/MC plot with a fixed
+ * binning and a fixed set of histograms. Histograms are filled in a private buffer of the writer,
+ * and their current state is made visible to readers with Publish. The segment contains two
+ * buffers with bin contents and a sequence counter. Publish copies the private buffer into the
+ * buffer that is not currently published and then advances the counter, so that readers never
+ * block the writer. There must be only one writer per segment.
+ * 
+ * The segment is removed when the writer is destroyed. Readers that are attached at that moment
+ * keep their mappings.
+ */
+class SharedHistFeedWriter
+{
+public:
+    /**
+     * \brief Creates a segment with the given name
+     * 
+     * The layout (binning, names and titles of histograms, colours, and the title of the plot) is
+     * copied from the given content, and initial bin contents are set from it as well. Sums of
+     * squared weights are not transferred.
+     */
+    SharedHistFeedWriter(std::string const &segmentName, PlotContent const &layout);
+    
+    /// Copy constructor is deleted
+    SharedHistFeedWriter(SharedHistFeedWriter const &) = delete;
+    
+    /// Assignment operator is deleted
+    SharedHistFeedWriter &operator=(SharedHistFeedWriter const &) = delete;
+    
+    /// Destructor
+    ~SharedHistFeedWriter();
+    
+public:
+    /**
+     * \brief Returns index of the histogram with the given name
+     * 
+     * The index is to be used with methods Fill and GetContents. Throws an exception if there is
+     * no such histogram.
+     */
+    unsigned FindHist(std::string const &name) const;
+    
+    /// Adds the given weight to the bin of the histogram that contains the given value
+    void Fill(unsigned histIndex, double x, double weight = 1.);
+    
+    /**
+     * \brief Returns pointer to the private bin contents of the histogram, including under- and
+     * overflow bins
+     * 
+     * Changes are not visible to readers until Publish is called.
+     */
+    double *GetContents(unsigned histIndex);
+    
+    /// Makes the current state of all histograms visible to readers
+    void Publish();
+    
+    /// Sets contents of all histograms to zero. Readers see the change after Publish
+    void Reset();
+    
+private:
+    /// Name of the segment
+    std::string segmentName;
+    
+    /// Pointer to the mapped segment
+    char *segment;
+    
+    /// Size of the segment
+    std::size_t segmentSize;
+    
+    /// Bin edges
+    std::vector<double> edges;
+    
+    /// Names of the histograms
+    std::vector<std::string> names;
+    
+    /// Private bin contents of all histograms, stored one after another
+    std::vector<double> contents;
+};
+
+
+/**
+ * \class SharedHistFeedReader
+ * \brief Consumer side of a shared-memory segment with histograms for live monitoring plots
+ * 
+ * The reader attaches to a segment created by SharedHistFeedWriter. Consistency of the data is
+ * ensured with the sequence counter of the segment: a view of the published buffer stays valid
+ * until the writer publishes twice more, which is checked with IsValid.
+ */
+class SharedHistFeedReader: public PlotReader
+{
+public:
+    /// Attaches to the segment with the given name
+    SharedHistFeedReader(std::string const &segmentName);
+    
+public:
+    /**
+     * \brief Returns the number of updates published so far
+     * 
+     * Can be used to check if there is new information without reading the histograms.
+     */
+    std::uint64_t GetGeneration() const;
+    
+    /**
+     * \brief Returns a consistent snapshot of the histograms
+     * 
+     * Bin contents are copied from the segment, and the copy is repeated if the writer has
+     * overwritten the buffer in the meantime. The directory name is ignored.
+     */
+    virtual PlotContent Read(std::string const &dirName = "") const override;
+    
+    /**
+     * \brief Returns a view of the published histograms without copying them
+     * 
+     * The sequence number at the moment of the call is written into the second argument. Data
+     * referenced by the content are only guaranteed to be consistent if IsValid returns true
+     * after they have been used.
+     */
+    PlotContent View(std::uint64_t &sequence) const;
+    
+    /// Checks if a view obtained with the given sequence number has not been overwritten
+    bool IsValid(std::uint64_t sequence) const;
+    
+private:
+    /// Memory-mapped segment
+    std::shared_ptr<void const> mapping;
+    
+    /// Pointer to the beginning of the segment
+    char const *segment;
+};
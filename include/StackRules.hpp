@@ -0,0 +1,49 @@
+#pragma once
+
+#include <ArrayView.hpp>
+#include <BinMask.hpp>
+
+#include <string>
+#include <vector>
+
+
+/**
+ * \class StackRules
+ * \brief Rules that define the stack of MC processes and its normalization to data
+ * 
+ * DataMCPlot, PlotBatch, and YieldTable all move some processes out of the stack and rescale the
+ * stack to data. They use the functions of this class, which does not depend on ROOT, so that they
+ * give the same results. All arrays include under- and overflow bins.
+ */
+class StackRules
+{
+public:
+    /**
+     * \brief Computes the factor that rescales the total expectation to the normalization of data
+     * 
+     * Bins hidden by the mask are excluded from both integrals. If an array of bin widths is given,
+     * contents are weighted with it, which is needed when histograms represent event densities.
+     * Sums are compensated (see Summation). A mask that hides no bins may have any size. Throws an
+     * exception if sizes of the arrays do not match.
+     */
+    static double ComputeNormFactor(ArrayView<double> const &data, ArrayView<double> const &total,
+     BinMask const &mask, ArrayView<double> const &widths = ArrayView<double>());
+    
+    /**
+     * \brief Returns widths of bins with the given edges
+     * 
+     * Under- and overflow bins are given the widths of the adjacent bins, as in
+     * TAxis::GetBinWidth.
+     */
+    static std::vector<double> GetWidths(ArrayView<double> const &edges);
+    
+    /**
+     * \brief Finds processes in the stack that are moved out of it by an overlay pattern
+     * 
+     * Returns indices of the names that match the given shell-style pattern. Throws an exception
+     * if all names match, since the stack would be left empty, or if none of them matches and the
+     * last argument is true.
+     */
+    static std::vector<unsigned> MatchOverlay(std::vector<std::string> const &stackNames,
+     std::string const &pattern, bool requireMatch = true);
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <ArrayView.hpp>
+
+#include <cmath>
+#include <vector>
+
+
+/**
+ * \class Summation
+ * \brief Summation kernels with a choice of accuracy
+ * 
+ * Three modes are provided. The naive mode adds numbers sequentially. The pairwise mode sums
+ * blocks of numbers in a binary tree, which reduces the growth of the rounding error from O(n) to
+ * O(log n). The compensated mode implements the Kahan-Babuska-Neumaier algorithm: the rounding
+ * error of every addition is accumulated separately and added back at the end. Its result is
+ * usually the correctly rounded sum, even if the terms differ by many orders of magnitude, and is
+ * thus nearly independent of the order of terms. Bitwise reproducibility under reordering is not
+ * guaranteed.
+ * 
+ * All kernels keep several independent partial sums so that the compiler can vectorize them. When
+ * summing several arrays element by element, the compensation is done independently for each
+ * element, and the loop over elements is vectorized.
+ */
+class Summation
+{
+public:
+    /// Summation algorithm
+    enum class Mode
+    {
+        Naive,
+        Pairwise,
+        Compensated
+    };
+    
+public:
+    /**
+     * \brief Adds a number to a sum with Neumaier's compensation
+     * 
+     * Allows a compensated sum to be accumulated term by term, without storing the terms. The
+     * result is sum + comp. The branch is expressed as a selection so that loops calling this
+     * function can be vectorized.
+     */
+    static void AddCompensated(double &sum, double &comp, double x);
+    
+    /// Computes the sum of all elements of the array
+    static double Sum(ArrayView<double> const &values, Mode mode = Mode::Compensated);
+    
+    /**
+     * \brief Sums several arrays element by element
+     * 
+     * All arrays must have the same size. The result is resized to match it.
+     */
+    static void SumArrays(std::vector<ArrayView<double>> const &arrays,
+     std::vector<double> &result, Mode mode = Mode::Compensated);
+    
+private:
+    /// Pairwise summation of a range of arrays into the given buffer
+    static void SumArraysPairwise(ArrayView<double> const *arrays, unsigned numArrays,
+     unsigned size, double *result);
+    
+    /// Pairwise summation of an array
+    static double SumPairwise(double const *values, std::size_t size);
+};
+
+
+inline void Summation::AddCompensated(double &sum, double &comp, double x)
+{
+    double const t = sum + x;
+    comp += (std::fabs(sum) >= std::fabs(x)) ? (sum - t) + x : (x - t) + sum;
+    sum = t;
+}
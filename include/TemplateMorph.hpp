@@ -0,0 +1,154 @@
+#pragma once
+
+#include <ArrayView.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+
+/**
+ * \class TemplateMorph
+ * \brief Applies values of nuisance parameters to templates of processes by vertical interpolation
+ * 
+ * Each source of systematic uncertainty is described by a nuisance parameter theta and, for every
+ * affected process, by templates that correspond to theta = +1 and -1. For other values of theta
+ * the content of each bin is interpolated and extrapolated between the nominal and the varied
+ * templates, using one of the schemes adopted in common fit tools:
+ *  - additive: the variation is a polynomial in theta for |theta| < 1 and linear outside, and
+ *    variations from different sources are added up;
+ *  - multiplicative: the variation is a factor given by a polynomial for |theta| < 1 and an
+ *    exponential outside, and factors from different sources are multiplied.
+ * In both cases the polynomials are chosen so that the result and its first two derivatives are
+ * continuous at theta = +-1. The resulting contents are clipped at zero.
+ * 
+ * Coefficients of the polynomials are precomputed for every bin when templates are added, so that
+ * Evaluate only runs simple loops over contiguous arrays of bins, which the compiler vectorises.
+ * This makes repeated evaluation cheap, e.g. in scans of a nuisance parameter.
+ * 
+ * All arrays with bin contents must have the same size, which may or may not include under- and
+ * overflow bins.
+ */
+class TemplateMorph
+{
+public:
+    /// Supported interpolation schemes
+    enum class Interpolation
+    {
+        Additive,
+        Multiplicative
+    };
+    
+public:
+    /**
+     * \brief Constructor
+     * 
+     * Each array contains the nominal contents of bins of one process. The arrays are copied.
+     */
+    TemplateMorph(std::vector<ArrayView<double>> const &nominals);
+    
+public:
+    /**
+     * \brief Adds templates for the given process and source of uncertainty
+     * 
+     * The source is registered when it is encountered for the first time. All templates of a
+     * source must use the same interpolation scheme. With the multiplicative scheme, bins in which
+     * the nominal or a varied content is not positive are not affected. Throws an exception if
+     * sizes of the arrays do not match, the process index is out of range, or templates for this
+     * process and source have already been added.
+     */
+    void AddTemplates(unsigned process, std::string const &source, ArrayView<double> const &up,
+     ArrayView<double> const &down, Interpolation interpolation = Interpolation::Additive);
+    
+    /**
+     * \brief Computes morphed templates for the given values of nuisance parameters
+     * 
+     * The values are indexed in the same way as sources (see GetSourceIndex). Sources whose values
+     * are zero are skipped.
+     */
+    void Evaluate(std::vector<double> const &params);
+    
+    /**
+     * \brief Computes morphed templates for nuisance parameters given by names of their sources
+     * 
+     * Sources that are not mentioned are set to zero. Throws an exception if a source is unknown.
+     */
+    void Evaluate(std::map<std::string, double> const &params);
+    
+    /// Returns morphed contents of the given process computed by the last call to Evaluate
+    std::vector<double> const &GetMorphed(unsigned process) const;
+    
+    /// Returns the number of bins
+    unsigned GetNumBins() const;
+    
+    /// Returns the number of processes
+    unsigned GetNumProcesses() const;
+    
+    /// Returns the number of sources of uncertainty
+    unsigned GetNumSources() const;
+    
+    /// Returns the index of the source with the given name. Throws an exception if it is unknown
+    unsigned GetSourceIndex(std::string const &name) const;
+    
+    /// Returns names of sources in the order in which they were registered
+    std::vector<std::string> GetSourceNames() const;
+    
+    /// Returns the total morphed contents of all processes computed by the last call to Evaluate
+    std::vector<double> const &GetTotal() const;
+    
+private:
+    /// Precomputed coefficients describing the effect of a source on one process
+    struct Effect
+    {
+        /// Index of the affected process
+        unsigned process;
+        
+        /**
+         * \brief Coefficients for all bins, indexed as [coefficient][bin]
+         * 
+         * Additive scheme uses four coefficients: variations at theta = +1 and -1, and the
+         * coefficients of the polynomial. The multiplicative scheme uses logarithms of the factors
+         * at theta = +1 and -1 and six coefficients of the polynomial.
+         */
+        std::vector<double> coeffs;
+    };
+    
+    /// A source of uncertainty
+    struct Source
+    {
+        /// Name of the source
+        std::string name;
+        
+        /// Interpolation scheme
+        Interpolation interpolation;
+        
+        /// Effects on individual processes
+        std::vector<Effect> effects;
+    };
+    
+private:
+    /// Computes additive variations of one process and adds them to the given buffer
+    void AddShifts(Effect const &effect, double theta, double *shifts) const;
+    
+    /// Computes multiplicative variations of one process and applies them to the given buffer
+    void ApplyFactors(Effect const &effect, double theta, double *factors) const;
+    
+private:
+    /// Number of bins
+    unsigned numBins;
+    
+    /// Nominal contents of all processes
+    std::vector<std::vector<double>> nominals;
+    
+    /// Sources of uncertainty
+    std::vector<Source> sources;
+    
+    /// Buffers for additive shifts and multiplicative factors, indexed as [process][bin]
+    std::vector<double> shifts, factors;
+    
+    /// Morphed contents of all processes
+    std::vector<std::vector<double>> morphed;
+    
+    /// Total morphed contents
+    std::vector<double> total;
+};
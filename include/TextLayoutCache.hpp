@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+class TVirtualPad;
+
+
+/**
+ * \class TextLayoutCache
+ * \brief Process-wide cache of measured widths of text labels
+ * 
+ * Measuring a TLatex string requires parsing it and querying font metrics, which is expensive when
+ * the same labels are decorated in thousands of figures. This class measures each distinct pair
+ * of a string and a font once and stores its width in units of the text size, which does not
+ * depend on the pad. Widths of legends are additionally cached for each distinct set of entries.
+ * The cache is shared by all threads.
+ * 
+ * Text sizes follow the convention of ROOT for fonts with precision 2, i.e. they are given relative
+ * to the smaller dimension of the pad.
+ */
+class TextLayoutCache
+{
+public:
+    /**
+     * \brief Returns width of a label, as a fraction of the width of the given pad
+     * 
+     * If the label has not been measured yet, this is done in the given pad.
+     */
+    static double GetWidth(std::string const &text, short font, double textSize,
+     TVirtualPad &pad);
+    
+    /**
+     * \brief Returns width of a legend that accommodates all given labels
+     * 
+     * The width is given as a fraction of the width of the given pad and includes the column for
+     * symbols, whose relative width is the last argument (the default value is the one used in
+     * TLegend).
+     */
+    static double GetLegendWidth(std::vector<std::string> const &labels, short font,
+     double textSize, TVirtualPad &pad, double symbolFraction = 0.25);
+    
+private:
+    /// Returns width of a label in units of the text size, measuring it if needed
+    static double GetRelativeWidth(std::string const &text, short font, TVirtualPad &pad);
+    
+    /// Returns ratio between the smaller dimension and the width of the pad, in pixels
+    static double GetScale(TVirtualPad const &pad);
+};
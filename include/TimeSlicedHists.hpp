@@ -0,0 +1,125 @@
+#pragma once
+
+#include <PlotContent.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/**
+ * \class TimeSlicedHists
+ * \brief Accumulates histograms for a data/MC plot in time slices and provides their sums over a
+ * sliding window and over the whole run
+ * 
+ * Histograms are kept per time slice in a ring buffer that covers the window. Sums over the window
+ * are maintained incrementally: a fill is added both to its slice and to the window sum, and when
+ * a slice expires, its contents are subtracted from the window sum and the slice is reused. Thus
+ * obtaining the window sums costs O(bins) regardless of the length of the window. To prevent
+ * accumulation of rounding errors, the window sums are recomputed from the slices once per full
+ * turn of the ring buffer.
+ * 
+ * The window consists of the current slice, which is still being filled, and the preceding
+ * complete slices. Systematic variations are not supported. The sums are returned as PlotContent
+ * and thus can be given directly to DataMCPlot.
+ */
+class TimeSlicedHists
+{
+public:
+    /**
+     * \brief Constructor
+     * 
+     * The binning, the title of the plot, and names, titles, and colours of the data and MC
+     * histograms are copied from the given layout; its bin contents are ignored. The window
+     * consists of numSlices slices of the given duration. Time is measured in arbitrary units
+     * (e.g. seconds), and the first slice starts at startTime.
+     */
+    TimeSlicedHists(PlotContent const &layout, double sliceDuration, unsigned numSlices,
+     double startTime = 0.);
+    
+public:
+    /**
+     * \brief Closes slices that end before the given time
+     * 
+     * Should be called before the sums are requested so that the window follows the clock even if
+     * there have been no fills recently. Going back in time has no effect.
+     */
+    void Advance(double time);
+    
+    /**
+     * \brief Returns index of the histogram with the given name
+     * 
+     * The data histogram has index 0, and MC histograms follow in the order of the layout. Throws
+     * an exception if there is no such histogram.
+     */
+    unsigned FindHist(std::string const &name) const;
+    
+    /**
+     * \brief Adds the given weight to the bin of the histogram that contains the given value
+     * 
+     * The time determines the slice. If it is later than the current slice, the window is advanced
+     * first. Fills that are older than the window only contribute to the sums over the run.
+     */
+    void Fill(unsigned histIndex, double time, double x, double weight = 1.);
+    
+    /**
+     * \brief Returns sums of the histograms over the whole run
+     * 
+     * The content refers to internal buffers and is only valid until the next modification of
+     * this object.
+     */
+    PlotContent GetRun() const;
+    
+    /**
+     * \brief Returns sums of the histograms over the window
+     * 
+     * The content refers to internal buffers and is only valid until the next modification of
+     * this object.
+     */
+    PlotContent GetWindow() const;
+    
+    /// Resets the sums over the run without affecting the window
+    void ResetRun();
+    
+private:
+    /// Returns index of the slice that contains the given time
+    std::int64_t GetSliceIndex(double time) const;
+    
+    /// Builds a content that refers to the given buffers with bin contents
+    PlotContent MakeContent(std::vector<double> const &sums,
+     std::vector<double> const &sumsw2) const;
+    
+    /// Recomputes sums over the window from the slices
+    void Resum();
+    
+private:
+    /// Layout of the plot. Views of bin contents are empty
+    PlotContent layout;
+    
+    /// Duration of a slice
+    double sliceDuration;
+    
+    /// Number of slices in the window
+    unsigned numSlices;
+    
+    /// Starting time of the first slice
+    double startTime;
+    
+    /// Number of values in all histograms of a single slice, including under- and overflow bins
+    unsigned stride;
+    
+    /// Index of the current slice, counted from startTime
+    std::int64_t curSlice;
+    
+    /// Number of slices that have expired since the window sums were last recomputed
+    unsigned numExpired;
+    
+    /// Contents and sums of squared weights of all slices in the ring buffer
+    std::vector<double> slices, slicesw2;
+    
+    /// Sums over the window
+    std::vector<double> windowSums, windowSumsw2;
+    
+    /// Sums over the run
+    std::vector<double> runSums, runSumsw2;
+};
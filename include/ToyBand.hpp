@@ -0,0 +1,92 @@
+#pragma once
+
+#include <ArrayView.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+/**
+ * \class ToyBand
+ * \brief Builds an uncertainty band for a sum of processes from pseudo-experiments
+ * 
+ * Each nuisance parameter scales normalizations of processes by log-normal factors kappa^theta,
+ * where theta follows the standard normal distribution and kappa is specified for each process
+ * separately. A nuisance that affects several processes thus describes a correlated
+ * normalization uncertainty. In every pseudo-experiment all nuisances are sampled, and the total
+ * expectation is computed in each bin. The band is given by quantiles of the totals.
+ * 
+ * Random numbers are produced with the counter-based generator Philox4x32-10, with the counter
+ * built from the index of the pseudo-experiment. Results therefore depend only on the seed and
+ * not on how pseudo-experiments are split among threads. Quantiles are estimated from per-bin
+ * histograms (sketches) of the totals, which requires two passes over the pseudo-experiments: the
+ * first one finds the range of the totals in each bin, and the second one, which regenerates the
+ * same pseudo-experiments, fills the sketches. Memory therefore does not grow with the number of
+ * pseudo-experiments.
+ */
+class ToyBand
+{
+public:
+    /**
+     * \brief Constructor
+     * 
+     * Each array contains the contents of bins of one process. All arrays must have the same size.
+     * The arrays are not copied and must outlive this object.
+     */
+    ToyBand(std::vector<ArrayView<double>> const &processes);
+    
+public:
+    /**
+     * \brief Adds a nuisance parameter
+     * 
+     * The vector contains the value of kappa for each process, in the same order as given to the
+     * constructor. A value of 1 means that the process is not affected. Values must be positive.
+     */
+    void AddNuisance(std::vector<double> const &kappas);
+    
+    /**
+     * \brief Generates pseudo-experiments and computes the band
+     * 
+     * The band covers the given central probability. Pseudo-experiments are distributed among
+     * the given number of threads; zero means the number of hardware threads.
+     */
+    void Compute(unsigned numToys, uint64_t seed = 0, double confLevel = 0.682689492137086,
+     unsigned numThreads = 0);
+    
+    /// Returns lower boundaries of the band in all bins
+    std::vector<double> const &GetLower() const;
+    
+    /// Returns medians of the totals in all bins
+    std::vector<double> const &GetMedian() const;
+    
+    /// Returns total expectation with all nuisance parameters set to zero
+    std::vector<double> const &GetNominal() const;
+    
+    /// Returns upper boundaries of the band in all bins
+    std::vector<double> const &GetUpper() const;
+    
+private:
+    /**
+     * \brief Computes totals in all bins for the given pseudo-experiment
+     * 
+     * The buffers for normal variates and scale factors are provided to avoid allocations.
+     */
+    void ComputeToy(uint64_t toy, uint64_t seed, std::vector<double> &thetas,
+     std::vector<double> &factors, std::vector<double> &totals) const;
+    
+private:
+    /// Number of cells in the sketch of each bin
+    static unsigned const numCells;
+    
+    /// Number of bins
+    unsigned numBins;
+    
+    /// Contents of processes
+    std::vector<ArrayView<double>> processes;
+    
+    /// Logarithms of kappa, indexed by nuisance and then by process
+    std::vector<std::vector<double>> logKappas;
+    
+    /// Results
+    std::vector<double> nominal, lower, median, upper;
+};
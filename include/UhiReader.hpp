@@ -0,0 +1,54 @@
+#pragma once
+
+#include <PlotReader.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/**
+ * \class UhiReader
+ * \brief Reads inputs for data/MC plots from files with UHI JSON serialisation of histograms
+ * 
+ * The format is the one written by uhi.io.json for boost-histogram and hist objects. The file is a
+ * JSON object that maps names of histograms to their serialised representations. Histograms for a
+ * plot are named "<dirName>/<name>" or simply "<name>" if the directory name is empty, and the
+ * special names "data", "syst_up", and "syst_down" are recognised as in ROOT files. All other
+ * histograms are interpreted as MC processes, in the order in which they appear in the file.
+ * 
+ * Only one-dimensional histograms with a regular or variable axis and storage of types "int",
+ * "double", or "weighted" are supported. Bin contents are parsed directly into arrays owned by the
+ * resulting PlotContent. Missing under- or overflow bins are filled with zeros.
+ * 
+ * Legend titles and fill colours of processes are taken from keys "label" and "color" of the
+ * metadata of the histograms. The title of the plot is read from key "plot_title" of the metadata
+ * of the data histogram; if it is not given, it is composed of the label of the axis.
+ */
+class UhiReader: public PlotReader
+{
+public:
+    /// Constructor from the name of the JSON file
+    UhiReader(std::string const &fileName);
+    
+    /// Destructor
+    ~UhiReader();
+    
+public:
+    /// Reads the content of a plot stored in the given directory
+    virtual PlotContent Read(std::string const &dirName = "") const override;
+    
+    /// Returns names of all histograms in the file, in the order of storage
+    std::vector<std::string> GetHistNames() const;
+    
+private:
+    /// Parsed representation of a JSON document
+    struct JsonValue;
+    
+private:
+    /// Name of the source file
+    std::string fileName;
+    
+    /// Parsed content of the file
+    std::unique_ptr<JsonValue> document;
+};
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <BinMask.hpp>
+#include <DerivedProcesses.hpp>
+#include <PlotContent.hpp>
+#include <PlotReader.hpp>
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+/**
+ * \class YieldTable
+ * \brief Builds tables of event yields for many plots without drawing them
+ * 
+ * For every directory, the plot is read with a PlotReader, and only the sums of bin contents and
+ * their uncertainties are computed, without creating ROOT histograms, the total expectation
+ * histogram, or the band with systematic uncertainties. Directories are processed in parallel
+ * threads, and their contents are released as soon as the yields are computed.
+ * 
+ * The options of DataMCPlot that affect yields are reproduced: MC processes can be moved out of
+ * the stack with DeclareOverlay, which excludes them from the total expectation and the
+ * normalization, MC processes in the stack can be rescaled to data (see SetNormalization), data
+ * can be blinded (see SetBlinding), and processes can be defined or regrouped with
+ * DerivedProcesses. Overlays and the normalization follow the same rules as in DataMCPlot, which
+ * are implemented in StackRules.
+ * 
+ * Yields include under- and overflow bins, as TH1::Integral(0, -1). Statistical uncertainties are
+ * computed from sums of squared weights or, if they are not given, from the Poisson uncertainties
+ * of the bin contents. Tables are written in CSV, LaTeX, and JSON formats.
+ */
+class YieldTable
+{
+public:
+    /// Yield of a single histogram
+    struct Yield
+    {
+        /// Constructor
+        Yield();
+        
+        /// Name of the histogram
+        std::string name;
+        
+        /// Title of the histogram, as used in the legend
+        std::string title;
+        
+        /// Sum of bin contents
+        double value;
+        
+        /// Statistical uncertainty
+        double error;
+    };
+    
+    /// Yields in one directory
+    struct Region
+    {
+        /// Name of the directory
+        std::string dirName;
+        
+        /// Title of the plot, without axis titles
+        std::string title;
+        
+        /// MC processes in the stack, in the order of the input
+        std::vector<Yield> processes;
+        
+        /// MC processes excluded from the stack
+        std::vector<Yield> overlays;
+        
+        /// Total expectation from processes in the stack
+        Yield total;
+        
+        /**
+         * \brief Data
+         * 
+         * If the region is blinded, only bins that are not blinded are included.
+         */
+        Yield data;
+        
+        /// Indicates if some bins of data are blinded
+        bool isBlinded;
+        
+        /**
+         * \brief Absolute systematic variations of the total expectation
+         * 
+         * Variations are summed over bins with the same signs as in PlotContent. They are zero if
+         * systematic uncertainties are not available.
+         */
+        double systUp, systDown;
+        
+        /// Indicates if systematic uncertainties are available
+        bool hasSystematics;
+        
+        /// Factor applied to processes in the stack, or 1 if they are not normalized
+        double normFactor;
+    };
+    
+public:
+    /**
+     * \brief Function that returns the mask of blinded bins for the given plot and directory
+     * 
+     * The plot includes derived processes. The mask can be default-constructed if no bins are
+     * blinded.
+     */
+    typedef std::function<BinMask(PlotContent const &content, std::string const &dirName)>
+     Blinder;
+    
+public:
+    /**
+     * \brief Constructor
+     * 
+     * The reader must outlive this object and support concurrent calls to Read, as
+     * RootFileReader does.
+     */
+    YieldTable(PlotReader const &reader);
+    
+public:
+    /**
+     * \brief Declares MC processes that are excluded from the stack
+     * 
+     * Processes whose names match the given shell-style pattern are listed separately and are not
+     * included in the total expectation and the normalization, as with
+     * DataMCPlot::DeclareOverlay. Patterns are applied in the order in which they are declared.
+     * Unlike in DataMCPlot, it is not an error if a pattern does not match any process in some
+     * directory, but Fill throws an exception if no processes would remain in the stack. Must be
+     * called before Fill.
+     */
+    void DeclareOverlay(std::string const &pattern);
+    
+    /**
+     * \brief Computes yields in the given directories
+     * 
+     * Directories are distributed among the given number of threads; zero means the number of
+     * hardware threads. Regions are appended in the order of the directories. Throws an exception
+     * if a directory cannot be read.
+     */
+    void Fill(std::vector<std::string> const &dirNames, unsigned numThreads = 0);
+    
+    /// Returns yields in all regions filled so far
+    std::vector<Region> const &GetRegions() const;
+    
+    /**
+     * \brief Sets the function that blinds data in every directory
+     * 
+     * Data in blinded bins are excluded from the data yield and the normalization, as in
+     * DataMCPlot. The data yields of blinded regions are not written in the tables. Calls to the
+     * function are serialized. Must be called before Fill.
+     */
+    void SetBlinding(Blinder const &blinder);
+    
+    /**
+     * \brief Sets derived processes that are applied to every plot before the yields are computed
+     * 
+     * The object must outlive this one. Calls to DerivedProcesses::Apply are serialized. Must be
+     * called before Fill.
+     */
+    void SetDerivedProcesses(DerivedProcesses &derived);
+    
+    /**
+     * \brief Requests rescaling of MC processes in the stack to data
+     * 
+     * Follows DataMCPlot::NormalizeMCToData. If isDensity is true, histograms are treated as
+     * event densities, and both normalizations and yields are computed weighting bin contents
+     * with bin widths. Under- and overflow bins are assigned the widths of the adjacent bins. Must
+     * be called before Fill.
+     */
+    void SetNormalization(bool normalize, bool isDensity = false);
+    
+    /**
+     * \brief Writes the table in CSV format
+     * 
+     * Each line describes one histogram in one region, with columns "region", "process", "kind"
+     * (one of "mc", "overlay", "total", "data"), "yield", "error", "syst_up", and "syst_down". The
+     * last two columns are only filled for the total expectation. For blinded regions, the yield
+     * of data is given as "blinded", and its error is left empty.
+     */
+    void WriteCsv(std::ostream &out) const;
+    
+    /**
+     * \brief Writes the table in JSON format, as an array with an object for every region
+     * 
+     * For blinded regions, the field "blinded" is set to true and data are given as null.
+     */
+    void WriteJson(std::ostream &out) const;
+    
+    /**
+     * \brief Writes the table in LaTeX format
+     * 
+     * Processes are given in rows and regions in columns. Since there can be many regions, they
+     * are split into several tabular environments with the given number of columns. Tables use
+     * the booktabs package. Values are printed with the given number of decimal places. Data in
+     * blinded regions are replaced with the word "blinded".
+     */
+    void WriteLatex(std::ostream &out, unsigned regionsPerTable = 5, int precision = 1) const;
+    
+private:
+    /// Computes yields for the given plot with the given blinded bins
+    Region ComputeRegion(PlotContent const &content, std::string const &dirName,
+     BinMask const &blinding) const;
+    
+private:
+    /// Reader for the plots
+    PlotReader const &reader;
+    
+    /// Patterns of names of processes excluded from the stack
+    std::vector<std::string> overlayPatterns;
+    
+    /// Indicates whether MC processes in the stack are rescaled to data
+    bool normalize;
+    
+    /// Indicates whether histograms represent event densities
+    bool isDensity;
+    
+    /// Derived processes, or null if they are not used
+    DerivedProcesses *derived;
+    
+    /// Function that blinds data, or an empty function if data are not blinded
+    Blinder blinder;
+    
+    /// Regions filled so far
+    std::vector<Region> regions;
+};
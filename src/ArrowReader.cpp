@@ -0,0 +1,540 @@
+#include <ArrowReader.hpp>
+
+#include <MappedFile.hpp>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /**
+     * \class FlatTable
+     * \brief Minimal read-only accessor for a table serialised with FlatBuffers
+     * 
+     * Arrow IPC files describe their schema and record batches with FlatBuffers. Only the features
+     * needed to read these descriptions are implemented. All accesses are checked against the
+     * boundaries of the buffer.
+     */
+    class FlatTable
+    {
+    public:
+        /// Constructs a null table
+        FlatTable():
+            buffer(nullptr), size(0), pos(0)
+        {}
+        
+        /// Constructs the root table of the given buffer
+        FlatTable(char const *buffer_, size_t size_):
+            buffer(buffer_), size(size_), pos(0)
+        {
+            pos = Load<uint32_t>(0);
+        }
+        
+    public:
+        /// Checks if the table is null, which happens when a field with a table is absent
+        bool IsNull() const
+        {
+            return (buffer == nullptr);
+        }
+        
+        /// Reads a scalar field, returning the default value if the field is absent
+        template<typename T>
+        T GetScalar(unsigned field, T defaultValue) const
+        {
+            size_t const fieldPos = FieldPos(field);
+            return (fieldPos == 0) ? defaultValue : Load<T>(fieldPos);
+        }
+        
+        /// Reads a field with a nested table
+        FlatTable GetTable(unsigned field) const
+        {
+            size_t const fieldPos = FieldPos(field);
+            return (fieldPos == 0) ? FlatTable() : FlatTable(buffer, size, Deref(fieldPos));
+        }
+        
+        /// Reads a string field, returning an empty string if the field is absent
+        string GetString(unsigned field) const
+        {
+            size_t const fieldPos = FieldPos(field);
+            
+            if (fieldPos == 0)
+                return "";
+            
+            size_t const stringPos = Deref(fieldPos);
+            uint32_t const length = Load<uint32_t>(stringPos);
+            CheckRange(stringPos + 4, length);
+            return string(buffer + stringPos + 4, length);
+        }
+        
+        /// Returns the length of a vector field, or 0 if the field is absent
+        size_t GetVectorLength(unsigned field) const
+        {
+            size_t const fieldPos = FieldPos(field);
+            return (fieldPos == 0) ? 0 : Load<uint32_t>(Deref(fieldPos));
+        }
+        
+        /// Returns a table from a vector of tables
+        FlatTable GetTableElement(unsigned field, size_t index) const
+        {
+            size_t const elementPos = Deref(FieldPos(field)) + 4 + 4 * index;
+            return FlatTable(buffer, size, Deref(elementPos));
+        }
+        
+        /// Reads a member of a struct from a vector of structs
+        template<typename T>
+        T GetStructMember(unsigned field, size_t index, size_t structSize, size_t offset) const
+        {
+            return Load<T>(Deref(FieldPos(field)) + 4 + structSize * index + offset);
+        }
+        
+    private:
+        /// Constructs a table located at the given position in the buffer
+        FlatTable(char const *buffer_, size_t size_, size_t pos_):
+            buffer(buffer_), size(size_), pos(pos_)
+        {}
+        
+        /// Throws an exception if the given range does not fit into the buffer
+        void CheckRange(size_t start, size_t length) const
+        {
+            if (start + length > size or start + length < start)
+                throw runtime_error("Malformed FlatBuffers metadata in Arrow IPC file.");
+        }
+        
+        /// Reads a little-endian value from the given position in the buffer
+        template<typename T>
+        T Load(size_t at) const
+        {
+            CheckRange(at, sizeof(T));
+            T value;
+            memcpy(&value, buffer + at, sizeof(T));
+            return value;
+        }
+        
+        /// Follows an unsigned offset stored at the given position
+        size_t Deref(size_t at) const
+        {
+            return at + Load<uint32_t>(at);
+        }
+        
+        /// Returns position of the given field in the buffer, or 0 if the field is absent
+        size_t FieldPos(unsigned field) const
+        {
+            size_t const vtablePos = pos - Load<int32_t>(pos);
+            unsigned const vtableSize = Load<uint16_t>(vtablePos);
+            
+            if (4 + 2 * field >= vtableSize)
+                return 0;
+            
+            unsigned const fieldOffset = Load<uint16_t>(vtablePos + 4 + 2 * field);
+            return (fieldOffset == 0) ? 0 : pos + fieldOffset;
+        }
+        
+    private:
+        /// Buffer that contains the table
+        char const *buffer;
+        
+        /// Size of the buffer
+        size_t size;
+        
+        /// Position of the table in the buffer
+        size_t pos;
+    };
+    
+    
+    /// Reads a vector of key-value pairs from the given field of a table
+    map<string, string> ReadKeyValues(FlatTable const &table, unsigned field)
+    {
+        map<string, string> result;
+        
+        for (size_t i = 0; i < table.GetVectorLength(field); ++i)
+        {
+            FlatTable const keyValue(table.GetTableElement(field, i));
+            result[keyValue.GetString(0)] = keyValue.GetString(1);
+        }
+        
+        return result;
+    }
+}
+
+
+ArrowReader::ArrowReader(string const &fileName):
+    file(new MappedFile(fileName)),
+    numRows(0)
+{
+    ReadStructure();
+}
+
+
+PlotContent ArrowReader::Read(string const &dirName /*= ""*/) const
+{
+    PlotContent content;
+    content.KeepAlive(file);
+    
+    string const prefix((dirName.empty()) ? "" : dirName + "/");
+    
+    ostringstream source;
+    source << "file \"" << file->GetFileName() << "\", directory \"" << dirName << "\"";
+    
+    
+    // At least one bin is needed in addition to the under- and overflow bins
+    if (numRows < 3)
+    {
+        ostringstream ost;
+        ost << "Table in " << source.str() << " contains too few rows.";
+        throw runtime_error(ost.str());
+    }
+    
+    auto const titleIt = metadata.find(prefix + "title");
+    
+    if (titleIt != metadata.end())
+        content.title = titleIt->second;
+    
+    
+    for (auto const &c: columns)
+    {
+        // Skip columns from other directories, including nested ones
+        if (not boost::starts_with(c.name, prefix) or
+         c.name.find('/', prefix.length()) != string::npos)
+            continue;
+        
+        string const name(c.name.substr(prefix.length()));
+        
+        if (name == "low_edge")
+        {
+            // The row for the underflow bin does not define an edge
+            content.edges = ReadColumn(c, content).Slice(1, numRows - 1);
+            continue;
+        }
+        
+        
+        PlotContent::Hist *hist;
+        
+        if (name == "data")
+            hist = &content.data;
+        else if (name == "syst_up")
+            hist = &content.systUp;
+        else if (name == "syst_down")
+            hist = &content.systDown;
+        else
+        {
+            content.processes.emplace_back();
+            hist = &content.processes.back();
+        }
+        
+        hist->name = name;
+        hist->contents = ReadColumn(c, content);
+        
+        auto const fieldTitleIt = c.metadata.find("title");
+        hist->title = (fieldTitleIt != c.metadata.end()) ? fieldTitleIt->second : name;
+        
+        auto const colourIt = c.metadata.find("color");
+        
+        if (colourIt != c.metadata.end())
+            hist->colour = stoi(colourIt->second);
+    }
+    
+    
+    if (content.data.title == "data")
+        content.data.title = "Data";
+    
+    content.Validate(source.str());
+    return content;
+}
+
+
+vector<string> ArrowReader::GetColumnNames() const
+{
+    vector<string> names;
+    
+    for (auto const &c: columns)
+        names.push_back(c.name);
+    
+    return names;
+}
+
+
+void ArrowReader::ReadStructure()
+{
+    char const *const data = file->GetData();
+    size_t const size = file->GetSize();
+    
+    
+    // The file starts with magic string "ARROW1" padded to 8 bytes and ends with the footer
+    //followed by its length and the same magic string
+    if (size < 8 + 10 or memcmp(data, "ARROW1", 6) != 0 or
+     memcmp(data + size - 6, "ARROW1", 6) != 0)
+    {
+        ostringstream ost;
+        ost << "File \"" << file->GetFileName() << "\" is not in Arrow IPC file format.";
+        throw runtime_error(ost.str());
+    }
+    
+    int32_t footerLength;
+    memcpy(&footerLength, data + size - 10, 4);
+    
+    if (footerLength <= 0 or size_t(footerLength) > size - 18)
+    {
+        ostringstream ost;
+        ost << "Footer of Arrow IPC file \"" << file->GetFileName() << "\" is corrupted.";
+        throw runtime_error(ost.str());
+    }
+    
+    FlatTable const footer(data + size - 10 - footerLength, footerLength);
+    
+    
+    // Read the schema
+    FlatTable const schema(footer.GetTable(1));
+    
+    if (schema.IsNull() or schema.GetScalar<int16_t>(0, 0) != 0)
+    {
+        ostringstream ost;
+        ost << "Arrow IPC file \"" << file->GetFileName() <<
+         "\" has no schema or uses big-endian encoding, which is not supported.";
+        throw runtime_error(ost.str());
+    }
+    
+    metadata = ReadKeyValues(schema, 2);
+    
+    
+    // Read the only record batch. The block is a struct with the offset of the message (int64),
+    //length of the metadata (int32, followed by padding), and length of the body (int64)
+    if (footer.GetVectorLength(3) != 1)
+    {
+        ostringstream ost;
+        ost << "Arrow IPC file \"" << file->GetFileName() << "\" contains " <<
+         footer.GetVectorLength(3) << " record batches while exactly one is expected.";
+        throw runtime_error(ost.str());
+    }
+    
+    int64_t const blockOffset = footer.GetStructMember<int64_t>(3, 0, 24, 0);
+    int32_t const blockMetaLength = footer.GetStructMember<int32_t>(3, 0, 24, 8);
+    int64_t const blockBodyLength = footer.GetStructMember<int64_t>(3, 0, 24, 16);
+    
+    if (blockOffset < 0 or blockMetaLength < 8 or blockBodyLength < 0 or
+     size_t(blockOffset + blockMetaLength + blockBodyLength) > size)
+    {
+        ostringstream ost;
+        ost << "Record batch in Arrow IPC file \"" << file->GetFileName() << "\" is corrupted.";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // The message with the record batch is prefixed with a continuation marker (absent in old
+    //versions of the format) and its length
+    size_t messagePos = blockOffset;
+    uint32_t marker;
+    memcpy(&marker, data + messagePos, 4);
+    
+    if (marker == 0xFFFFFFFF)
+        messagePos += 4;
+    
+    int32_t messageLength;
+    memcpy(&messageLength, data + messagePos, 4);
+    messagePos += 4;
+    
+    if (messageLength <= 0 or messagePos + messageLength > size_t(blockOffset + blockMetaLength))
+    {
+        ostringstream ost;
+        ost << "Record batch in Arrow IPC file \"" << file->GetFileName() << "\" is corrupted.";
+        throw runtime_error(ost.str());
+    }
+    
+    FlatTable const message(data + messagePos, messageLength);
+    FlatTable const recordBatch(message.GetTable(2));
+    
+    if (message.GetScalar<uint8_t>(1, 0) != 3 or recordBatch.IsNull())
+    {
+        ostringstream ost;
+        ost << "Arrow IPC file \"" << file->GetFileName() <<
+         "\" does not point to a valid record batch.";
+        throw runtime_error(ost.str());
+    }
+    
+    if (not recordBatch.GetTable(3).IsNull())
+    {
+        ostringstream ost;
+        ost << "Arrow IPC file \"" << file->GetFileName() <<
+         "\" is compressed. Only uncompressed files are supported.";
+        throw runtime_error(ost.str());
+    }
+    
+    numRows = recordBatch.GetScalar<int64_t>(0, 0);
+    char const *const body = data + blockOffset + blockMetaLength;
+    
+    
+    // Go over fields of the schema and match them with field nodes and buffers of the record
+    //batch. Each node and buffer is a struct of two int64 numbers
+    size_t const numNodes = recordBatch.GetVectorLength(1);
+    size_t const numBuffers = recordBatch.GetVectorLength(2);
+    size_t bufferIndex = 0;
+    
+    for (size_t iField = 0; iField < schema.GetVectorLength(1); ++iField)
+    {
+        FlatTable const field(schema.GetTableElement(1, iField));
+        string const name(field.GetString(0));
+        unsigned const typeCode = field.GetScalar<uint8_t>(2, 0);
+        FlatTable const type(field.GetTable(3));
+        
+        if (field.GetVectorLength(5) != 0 or iField >= numNodes)
+        {
+            ostringstream ost;
+            ost << "Field \"" << name << "\" in Arrow IPC file \"" << file->GetFileName() <<
+             "\" is nested, which is not supported.";
+            throw runtime_error(ost.str());
+        }
+        
+        
+        // Determine the number of buffers used by the field. Numeric columns consist of the
+        //validity bitmap and the values
+        unsigned numFieldBuffers;
+        
+        if (typeCode == 4 or typeCode == 5 or typeCode == 19 or typeCode == 20)
+            numFieldBuffers = 3;  // (large) binary or string: validity, offsets, values
+        else if (typeCode == 1)
+            numFieldBuffers = 0;  // null type
+        else if ((typeCode >= 2 and typeCode <= 11) or typeCode == 15 or typeCode == 18)
+            numFieldBuffers = 2;
+        else
+        {
+            ostringstream ost;
+            ost << "Field \"" << name << "\" in Arrow IPC file \"" << file->GetFileName() <<
+             "\" has an unsupported type.";
+            throw runtime_error(ost.str());
+        }
+        
+        if (bufferIndex + numFieldBuffers > numBuffers)
+        {
+            ostringstream ost;
+            ost << "Record batch in Arrow IPC file \"" << file->GetFileName() <<
+             "\" contains too few buffers.";
+            throw runtime_error(ost.str());
+        }
+        
+        size_t const valuesIndex = bufferIndex + 1;
+        bufferIndex += numFieldBuffers;
+        
+        
+        // Only floating-point and integer columns are used
+        Column column;
+        column.name = name;
+        
+        if (typeCode == 3)
+        {
+            column.kind = 'f';
+            int16_t const precision = type.GetScalar<int16_t>(0, 0);
+            
+            if (precision == 1)
+                column.itemSize = 4;
+            else if (precision == 2)
+                column.itemSize = 8;
+            else
+                continue;  // half-precision numbers are not supported
+        }
+        else if (typeCode == 2)
+        {
+            column.kind = (type.GetScalar<uint8_t>(1, 0)) ? 'i' : 'u';
+            column.itemSize = type.GetScalar<int32_t>(0, 0) / 8;
+            
+            if (column.itemSize != 4 and column.itemSize != 8)
+                continue;
+        }
+        else
+            continue;
+        
+        
+        int64_t const nodeLength = recordBatch.GetStructMember<int64_t>(1, iField, 16, 0);
+        int64_t const nullCount = recordBatch.GetStructMember<int64_t>(1, iField, 16, 8);
+        int64_t const valuesOffset =
+         recordBatch.GetStructMember<int64_t>(2, valuesIndex, 16, 0);
+        int64_t const valuesLength =
+         recordBatch.GetStructMember<int64_t>(2, valuesIndex, 16, 8);
+        
+        if (nullCount != 0)
+        {
+            ostringstream ost;
+            ost << "Column \"" << name << "\" in Arrow IPC file \"" << file->GetFileName() <<
+             "\" contains null values.";
+            throw runtime_error(ost.str());
+        }
+        
+        if (nodeLength != int64_t(numRows) or valuesOffset < 0 or
+         valuesLength < nodeLength * column.itemSize or
+         valuesOffset + valuesLength > blockBodyLength)
+        {
+            ostringstream ost;
+            ost << "Column \"" << name << "\" in Arrow IPC file \"" << file->GetFileName() <<
+             "\" is corrupted.";
+            throw runtime_error(ost.str());
+        }
+        
+        column.data = body + valuesOffset;
+        column.metadata = ReadKeyValues(field, 6);
+        columns.emplace_back(column);
+    }
+}
+
+
+ArrayView<double> ArrowReader::ReadColumn(Column const &column, PlotContent &content) const
+{
+    // View the column in place if possible. Buffers in Arrow files are normally aligned to 8 or 64
+    //bytes
+    if (column.kind == 'f' and column.itemSize == sizeof(double) and
+     reinterpret_cast<uintptr_t>(column.data) % alignof(double) == 0)
+        return ArrayView<double>(reinterpret_cast<double const *>(column.data), numRows);
+    
+    
+    // Otherwise convert the column
+    vector<double> buffer(numRows);
+    
+    for (size_t i = 0; i < numRows; ++i)
+    {
+        char const *const src = column.data + i * column.itemSize;
+        
+        if (column.kind == 'f' and column.itemSize == 8)
+        {
+            double value;
+            memcpy(&value, src, 8);
+            buffer[i] = value;
+        }
+        else if (column.kind == 'f')
+        {
+            float value;
+            memcpy(&value, src, 4);
+            buffer[i] = value;
+        }
+        else if (column.kind == 'i' and column.itemSize == 8)
+        {
+            int64_t value;
+            memcpy(&value, src, 8);
+            buffer[i] = value;
+        }
+        else if (column.kind == 'i')
+        {
+            int32_t value;
+            memcpy(&value, src, 4);
+            buffer[i] = value;
+        }
+        else if (column.itemSize == 8)
+        {
+            uint64_t value;
+            memcpy(&value, src, 8);
+            buffer[i] = value;
+        }
+        else
+        {
+            uint32_t value;
+            memcpy(&value, src, 4);
+            buffer[i] = value;
+        }
+    }
+    
+    return content.Adopt(move(buffer));
+}
@@ -0,0 +1,114 @@
+#include <BinMask.hpp>
+
+#include <Summation.hpp>
+
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+BinMask::BinMask(unsigned numBins_ /*= 0*/):
+    numBins(numBins_),
+    bits((numBins + 2 + 63) / 64, 0),
+    numMasked(0)
+{}
+
+
+unsigned BinMask::GetNumBins() const
+{
+    return numBins;
+}
+
+
+bool BinMask::IsActive() const
+{
+    return (numMasked > 0);
+}
+
+
+bool BinMask::IsMasked(unsigned bin) const
+{
+    if (bin > numBins + 1)
+        return false;
+    
+    return (bits[bin / 64] >> (bin % 64)) & 1;
+}
+
+
+void BinMask::Mask(unsigned bin)
+{
+    if (bin > numBins + 1)
+    {
+        ostringstream ost;
+        ost << "Cannot mask bin " << bin << " in a histogram with " << numBins << " bins.";
+        throw runtime_error(ost.str());
+    }
+    
+    if (not IsMasked(bin))
+    {
+        bits[bin / 64] |= uint64_t(1) << (bin % 64);
+        ++numMasked;
+    }
+}
+
+
+void BinMask::MaskIf(function<bool(unsigned bin)> const &predicate)
+{
+    for (unsigned bin = 0; bin <= numBins + 1; ++bin)
+    {
+        if (predicate(bin))
+            Mask(bin);
+    }
+}
+
+
+void BinMask::MaskRange(ArrayView<double> const &edges, double min, double max)
+{
+    if (edges.GetSize() != numBins + 1)
+    {
+        ostringstream ost;
+        ost << "Cannot mask a range using " << edges.GetSize() << " bin edges in a histogram " <<
+         "with " << numBins << " bins.";
+        throw runtime_error(ost.str());
+    }
+    
+    if (min >= max)
+        return;
+    
+    
+    // Bin i spans [edges[i - 1], edges[i]). Under- and overflow bins extend to infinity
+    for (unsigned bin = 0; bin <= numBins + 1; ++bin)
+    {
+        bool const belowMax = (bin == 0 or edges[bin - 1] < max);
+        bool const aboveMin = (bin == numBins + 1 or edges[bin] > min);
+        
+        if (belowMax and aboveMin)
+            Mask(bin);
+    }
+}
+
+
+double BinMask::SumUnmasked(ArrayView<double> const &values,
+ ArrayView<double> const &weights /*= ArrayView<double>()*/) const
+{
+    if (values.GetSize() != numBins + 2 or
+     (not weights.IsEmpty() and weights.GetSize() != values.GetSize()))
+    {
+        ostringstream ost;
+        ost << "Array sizes do not match a mask for a histogram with " << numBins << " bins.";
+        throw runtime_error(ost.str());
+    }
+    
+    double sum = 0., comp = 0.;
+    
+    for (unsigned bin = 0; bin < values.GetSize(); ++bin)
+    {
+        if (not IsMasked(bin))
+            Summation::AddCompensated(sum, comp,
+             (weights.IsEmpty()) ? values[bin] : values[bin] * weights[bin]);
+    }
+    
+    return sum + comp;
+}
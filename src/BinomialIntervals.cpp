@@ -0,0 +1,322 @@
+#include <BinomialIntervals.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <sstream>
+#include <unordered_map>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Maximal number of intervals cached for each confidence level
+    size_t const maxCacheSize = 1 << 20;
+    
+    
+    /**
+     * \brief Process-wide cache of Clopper-Pearson intervals
+     * 
+     * The outer map is indexed by the confidence level, the inner one by a key that combines the
+     * numbers of passed and total events.
+     */
+    map<double, unordered_map<uint64_t, pair<double, double>>> intervalCache;
+    
+    /// Mutex that guards the cache
+    mutex intervalCacheMutex;
+    
+    
+    /// Evaluates the continued fraction for the incomplete beta function (modified Lentz's method)
+    double BetaContinuedFraction(double a, double b, double x)
+    {
+        double const tiny = 1e-300;
+        double const eps = 1e-15;
+        
+        double c = 1.;
+        double d = 1. - (a + b) * x / (a + 1.);
+        
+        if (fabs(d) < tiny)
+            d = tiny;
+        
+        d = 1. / d;
+        double h = d;
+        
+        for (int m = 1; m <= 1000; ++m)
+        {
+            // Even step of the recurrence
+            double aa = m * (b - m) * x / ((a - 1. + 2 * m) * (a + 2 * m));
+            d = 1. + aa * d;
+            c = 1. + aa / c;
+            
+            if (fabs(d) < tiny)
+                d = tiny;
+            
+            if (fabs(c) < tiny)
+                c = tiny;
+            
+            d = 1. / d;
+            h *= d * c;
+            
+            
+            // Odd step
+            aa = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 1. + 2 * m));
+            d = 1. + aa * d;
+            c = 1. + aa / c;
+            
+            if (fabs(d) < tiny)
+                d = tiny;
+            
+            if (fabs(c) < tiny)
+                c = tiny;
+            
+            d = 1. / d;
+            double const delta = d * c;
+            h *= delta;
+            
+            if (fabs(delta - 1.) < eps)
+                break;
+        }
+        
+        return h;
+    }
+    
+    
+    /// Computes the regularized incomplete beta function I_x(a, b)
+    double IncompleteBeta(double a, double b, double x, double logBeta)
+    {
+        if (x <= 0.)
+            return 0.;
+        
+        if (x >= 1.)
+            return 1.;
+        
+        double const front = exp(a * log(x) + b * log1p(-x) - logBeta);
+        
+        // The continued fraction converges rapidly for x < (a + 1) / (a + b + 2). Otherwise use the
+        //symmetry relation
+        if (x < (a + 1.) / (a + b + 2.))
+            return front * BetaContinuedFraction(a, b, x) / a;
+        else
+            return 1. - front * BetaContinuedFraction(b, a, 1. - x) / b;
+    }
+    
+    
+    /// Computes the quantile of the beta distribution with parameters a and b
+    double BetaQuantile(double p, double a, double b)
+    {
+        double const logBeta = lgamma(a) + lgamma(b) - lgamma(a + b);
+        double lo = 0., hi = 1.;
+        double x = a / (a + b);
+        
+        for (int i = 0; i < 200; ++i)
+        {
+            // Keep the bracket up to date so that Newton steps that leave it can be replaced by
+            //bisection
+            double const f = IncompleteBeta(a, b, x, logBeta) - p;
+            
+            if (f < 0.)
+                lo = x;
+            else
+                hi = x;
+            
+            double const pdf = exp((a - 1.) * log(x) + (b - 1.) * log1p(-x) - logBeta);
+            double xNew = x - f / pdf;
+            
+            if (not (xNew > lo and xNew < hi))
+                xNew = 0.5 * (lo + hi);
+            
+            if (fabs(xNew - x) < 1e-13 * x or hi - lo < 1e-15)
+                return xNew;
+            
+            x = xNew;
+        }
+        
+        return x;
+    }
+    
+    
+    /// Computes the quantile of the standard normal distribution for p > 0.5
+    double NormalQuantile(double p)
+    {
+        // The cumulative distribution function is concave for positive arguments, so that Newton
+        //iterations started from zero approach the root monotonically
+        double z = 0.;
+        
+        for (int i = 0; i < 100; ++i)
+        {
+            double const f = 0.5 * erfc(-z / sqrt(2.)) - p;
+            double const pdf = exp(-0.5 * z * z) / sqrt(2. * M_PI);
+            double const step = f / pdf;
+            z -= step;
+            
+            if (fabs(step) < 1e-14 * z)
+                break;
+        }
+        
+        return z;
+    }
+    
+    
+    /**
+     * \brief Builds a key for the cache from numbers of passed and total events
+     * 
+     * Returns false if the numbers are not integer or too large to be cached.
+     */
+    bool MakeKey(double passed, double total, uint64_t &key)
+    {
+        if (passed < 0. or passed > total or total >= 4294967296. or passed != floor(passed) or
+         total != floor(total))
+            return false;
+        
+        key = (uint64_t(total) << 32) | uint64_t(passed);
+        return true;
+    }
+}
+
+
+BinomialIntervals::BinomialIntervals(Method method_ /*= Method::ClopperPearson*/,
+ double confLevel_ /*= 0.682689492137086*/):
+    method(method_), confLevel(confLevel_)
+{
+    if (confLevel <= 0. or confLevel >= 1.)
+    {
+        ostringstream ost;
+        ost << "Confidence level " << confLevel << " is outside of the range (0, 1).";
+        throw runtime_error(ost.str());
+    }
+    
+    z = NormalQuantile(0.5 * (1. + confLevel));
+}
+
+
+void BinomialIntervals::Compute(ArrayView<double> const &passed, ArrayView<double> const &total,
+ vector<double> &efficiency, vector<double> &lower, vector<double> &upper) const
+{
+    unsigned const numBins = passed.GetSize();
+    
+    if (total.GetSize() != numBins)
+    {
+        ostringstream ost;
+        ost << "Arrays with numbers of passed and total events have different sizes (" <<
+         numBins << " and " << total.GetSize() << ").";
+        throw runtime_error(ost.str());
+    }
+    
+    efficiency.resize(numBins);
+    lower.resize(numBins);
+    upper.resize(numBins);
+    
+    
+    // Efficiencies and trivial intervals for empty bins
+    for (unsigned i = 0; i < numBins; ++i)
+    {
+        bool const empty = (total[i] <= 0.);
+        efficiency[i] = (empty) ? 0. : min(max(passed[i] / total[i], 0.), 1.);
+        lower[i] = 0.;
+        upper[i] = 1.;
+    }
+    
+    
+    if (method == Method::Wilson)
+    {
+        // The Wilson interval has a closed form and is computed in a simple loop
+        double const z2 = z * z;
+        
+        for (unsigned i = 0; i < numBins; ++i)
+        {
+            double const n = total[i];
+            
+            if (n <= 0.)
+                continue;
+            
+            double const p = efficiency[i];
+            double const denom = 1. + z2 / n;
+            double const centre = (p + z2 / (2. * n)) / denom;
+            double const halfWidth = z * sqrt(p * (1. - p) / n + z2 / (4. * n * n)) / denom;
+            lower[i] = max(centre - halfWidth, 0.);
+            upper[i] = min(centre + halfWidth, 1.);
+        }
+        
+        return;
+    }
+    
+    
+    // Clopper-Pearson intervals. Look up all bins in the cache under a single lock, and compute
+    //the missing intervals outside of it
+    vector<unsigned> misses;
+    vector<uint64_t> keys(numBins);
+    vector<bool> cacheable(numBins);
+    
+    {
+        lock_guard<mutex> lock(intervalCacheMutex);
+        auto const &cache = intervalCache[confLevel];
+        
+        for (unsigned i = 0; i < numBins; ++i)
+        {
+            if (total[i] <= 0.)
+                continue;
+            
+            cacheable[i] = MakeKey(passed[i], total[i], keys[i]);
+            auto const res = (cacheable[i]) ? cache.find(keys[i]) : cache.end();
+            
+            if (res != cache.end())
+            {
+                lower[i] = res->second.first;
+                upper[i] = res->second.second;
+            }
+            else
+                misses.push_back(i);
+        }
+    }
+    
+    if (misses.empty())
+        return;
+    
+    for (auto const &i: misses)
+        tie(lower[i], upper[i]) = ClopperPearson(passed[i], total[i]);
+    
+    {
+        lock_guard<mutex> lock(intervalCacheMutex);
+        auto &cache = intervalCache[confLevel];
+        
+        if (cache.size() + misses.size() > maxCacheSize)
+            cache.clear();
+        
+        for (auto const &i: misses)
+        {
+            if (cacheable[i])
+                cache[keys[i]] = make_pair(lower[i], upper[i]);
+        }
+    }
+}
+
+
+double BinomialIntervals::GetConfLevel() const
+{
+    return confLevel;
+}
+
+
+BinomialIntervals::Method BinomialIntervals::GetMethod() const
+{
+    return method;
+}
+
+
+pair<double, double> BinomialIntervals::ClopperPearson(double passed, double total) const
+{
+    double const alpha = 1. - confLevel;
+    passed = min(max(passed, 0.), total);
+    
+    double const lower = (passed > 0.) ?
+     BetaQuantile(0.5 * alpha, passed, total - passed + 1.) : 0.;
+    double const upper = (passed < total) ?
+     BetaQuantile(1. - 0.5 * alpha, passed + 1., total - passed) : 1.;
+    
+    return make_pair(lower, upper);
+}
@@ -0,0 +1,382 @@
+#include <BootstrapHists.hpp>
+
+#include <Philox.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Number of tabulated values of the cumulative distribution function of Poisson(1)
+    unsigned const numPoissonThresholds = 16;
+    
+    
+    /**
+     * \brief Returns thresholds for sampling from Poisson(1) by inversion of 32-bit integers
+     * 
+     * A random integer u corresponds to the smallest k such that u < thresholds[k], or to the
+     * number of thresholds if there is no such k. Thresholds are saturated at 2^32 - 1, and the
+     * probability of values of k beyond the table is below the resolution of 32-bit numbers.
+     */
+    uint32_t const *GetPoissonThresholds()
+    {
+        static vector<uint32_t> const thresholds = []()
+        {
+            vector<uint32_t> t(numPoissonThresholds);
+            double p = exp(-1.), cdf = 0.;
+            
+            for (unsigned k = 0; k < numPoissonThresholds; ++k)
+            {
+                cdf += p;
+                p /= k + 1;
+                t[k] = uint32_t(min(cdf * 4294967296., 4294967295.));
+            }
+            
+            return t;
+        }();
+        
+        return thresholds.data();
+    }
+    
+    
+    /**
+     * \class UniformStream
+     * \brief Sequence of uniform random numbers generated by Philox for a fixed counter prefix
+     */
+    class UniformStream
+    {
+    public:
+        /// Constructor from the two counter words that identify the stream and the seed
+        UniformStream(uint32_t id0, uint32_t id1, uint64_t seed_):
+            seed(seed_), block(0), pos(4)
+        {
+            ids[0] = id0;
+            ids[1] = id1;
+        }
+        
+    public:
+        /// Returns the next uniform number in (0, 1)
+        double Next()
+        {
+            if (pos == 4)
+            {
+                buffer[0] = ids[0];
+                buffer[1] = ids[1];
+                buffer[2] = block++;
+                buffer[3] = Philox::BootstrapBin;
+                Philox::Transform(buffer, seed);
+                pos = 0;
+            }
+            
+            return Philox::ToUniform(buffer[pos++]);
+        }
+        
+    private:
+        /// Counter words that identify the stream
+        uint32_t ids[2];
+        
+        /// Seed
+        uint64_t seed;
+        
+        /// Index of the next block of four numbers
+        uint32_t block;
+        
+        /// Current block of random numbers
+        uint32_t buffer[4];
+        
+        /// Position of the next number in the current block
+        unsigned pos;
+    };
+    
+    
+    /**
+     * \brief Draws a number from the Poisson distribution with the given mean
+     * 
+     * Small means are handled with the multiplication method, and large ones with the
+     * transformed rejection method PTRS [W. Hoermann, Insurance Math. Econom. 12 (1993) 39].
+     */
+    double SamplePoisson(double mean, UniformStream &stream)
+    {
+        if (mean <= 0.)
+            return 0.;
+        
+        if (mean < 10.)
+        {
+            double const limit = exp(-mean);
+            double product = stream.Next();
+            unsigned k = 0;
+            
+            while (product > limit)
+            {
+                product *= stream.Next();
+                ++k;
+            }
+            
+            return k;
+        }
+        
+        double const sqrtMean = sqrt(mean), logMean = log(mean);
+        double const b = 0.931 + 2.53 * sqrtMean;
+        double const a = -0.059 + 0.02483 * b;
+        double const invAlpha = 1.1239 + 1.1328 / (b - 3.4);
+        double const vr = 0.9277 - 3.6224 / (b - 2.);
+        
+        while (true)
+        {
+            double const u = stream.Next() - 0.5;
+            double const v = stream.Next();
+            double const us = 0.5 - fabs(u);
+            double const k = floor((2. * a / us + b) * u + mean + 0.43);
+            
+            if (us >= 0.07 and v <= vr)
+                return k;
+            
+            if (k < 0. or (us < 0.013 and v > us))
+                continue;
+            
+            if (log(v) + log(invAlpha) - log(a / (us * us) + b) <=
+             -mean + k * logMean - lgamma(k + 1.))
+                return k;
+        }
+    }
+}
+
+
+BootstrapHists::BootstrapHists(vector<double> const &edges_, unsigned numReplicas_,
+ uint64_t seed_ /*= 0*/):
+    edges(edges_), numReplicas(numReplicas_), seed(seed_)
+{
+    if (edges.size() < 2 or not is_sorted(edges.begin(), edges.end()))
+        throw runtime_error("BootstrapHists requires at least one bin with sorted edges.");
+    
+    if (numReplicas < 2)
+        throw runtime_error("BootstrapHists requires at least two replicas.");
+    
+    numBins = edges.size() - 1;
+    contents.assign(size_t(numBins + 2) * numReplicas, 0.);
+}
+
+
+void BootstrapHists::Fill(double x, uint64_t eventId, double weight /*= 1.*/)
+{
+    FillBin(upper_bound(edges.begin(), edges.end(), x) - edges.begin(), eventId, weight);
+}
+
+
+void BootstrapHists::FillBin(unsigned bin, uint64_t eventId, double weight /*= 1.*/)
+{
+    GetPoissonWeights(eventId, seed, numReplicas, poissonWeights);
+    FillBin(bin, poissonWeights, weight);
+}
+
+
+void BootstrapHists::FillBin(unsigned bin, vector<uint32_t> const &poissonWeights_,
+ double weight /*= 1.*/)
+{
+    if (bin > numBins + 1 or poissonWeights_.size() < numReplicas)
+    {
+        ostringstream ost;
+        ost << "Bin index " << bin << " is out of range or too few Poisson weights are given.";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Add the event to all replicas, which are contiguous in memory
+    double *const row = contents.data() + size_t(bin) * numReplicas;
+    
+    for (unsigned r = 0; r < numReplicas; ++r)
+        row[r] += weight * poissonWeights_[r];
+}
+
+
+BootstrapHists BootstrapHists::FromHistogram(vector<double> const &edges,
+ ArrayView<double> const &contents, unsigned numReplicas, uint64_t seed /*= 0*/)
+{
+    BootstrapHists hists(edges, numReplicas, seed);
+    
+    if (contents.GetSize() != hists.numBins + 2)
+    {
+        ostringstream ost;
+        ost << "Histogram with " << contents.GetSize() << " bins including under- and " <<
+         "overflows does not match binning with " << hists.numBins << " bins.";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Every pair of a bin and a replica has its own stream of random numbers, so that the result
+    //does not depend on how many numbers the rejection sampling consumes in other bins
+    for (unsigned bin = 0; bin < hists.numBins + 2; ++bin)
+    {
+        double *const row = hists.contents.data() + size_t(bin) * numReplicas;
+        
+        for (unsigned r = 0; r < numReplicas; ++r)
+        {
+            UniformStream stream(bin, r, seed);
+            row[r] = SamplePoisson(contents[bin], stream);
+        }
+    }
+    
+    return hists;
+}
+
+
+double BootstrapHists::GetContent(unsigned bin, unsigned replica) const
+{
+    return contents[size_t(bin) * numReplicas + replica];
+}
+
+
+vector<double> BootstrapHists::GetCovariance() const
+{
+    return GetCrossCovariance(*this, *this);
+}
+
+
+vector<double> BootstrapHists::GetCrossCovariance(BootstrapHists const &first,
+ BootstrapHists const &second)
+{
+    if (first.numReplicas != second.numReplicas or first.seed != second.seed)
+        throw runtime_error("Cannot compute covariance between histograms whose replicas were "
+         "generated with different numbers of replicas or seeds.");
+    
+    vector<double> const x(first.GetCentred());
+    vector<double> const y((&first == &second) ? x : second.GetCentred());
+    unsigned const R = first.numReplicas;
+    unsigned const n1 = first.numBins + 2, n2 = second.numBins + 2;
+    vector<double> covariance(size_t(n1) * n2);
+    
+    for (unsigned i = 0; i < n1; ++i)
+    {
+        double const *const xi = x.data() + size_t(i) * R;
+        
+        for (unsigned j = 0; j < n2; ++j)
+        {
+            double const *const yj = y.data() + size_t(j) * R;
+            double sum = 0.;
+            
+            for (unsigned r = 0; r < R; ++r)
+                sum += xi[r] * yj[r];
+            
+            covariance[size_t(i) * n2 + j] = sum / (R - 1);
+        }
+    }
+    
+    return covariance;
+}
+
+
+vector<double> const &BootstrapHists::GetEdges() const
+{
+    return edges;
+}
+
+
+vector<double> BootstrapHists::GetErrors() const
+{
+    vector<double> const centred(GetCentred());
+    vector<double> errors(numBins + 2);
+    
+    for (unsigned bin = 0; bin < numBins + 2; ++bin)
+    {
+        double sum = 0.;
+        
+        for (unsigned r = 0; r < numReplicas; ++r)
+        {
+            double const d = centred[size_t(bin) * numReplicas + r];
+            sum += d * d;
+        }
+        
+        errors[bin] = sqrt(sum / (numReplicas - 1));
+    }
+    
+    return errors;
+}
+
+
+unsigned BootstrapHists::GetNumBins() const
+{
+    return numBins;
+}
+
+
+unsigned BootstrapHists::GetNumReplicas() const
+{
+    return numReplicas;
+}
+
+
+void BootstrapHists::GetPoissonWeights(uint64_t eventId, uint64_t seed, unsigned numReplicas,
+ vector<uint32_t> &weights)
+{
+    // Draw random numbers for all replicas, four per call to the generator. The counter is built
+    //from the event identifier only, so that the weights do not depend on the histogram. Its last
+    //word separates these numbers from other users of the generator
+    weights.resize((numReplicas + 3) / 4 * 4);
+    
+    for (unsigned block = 0; block < weights.size() / 4; ++block)
+    {
+        uint32_t ctr[4] = {uint32_t(eventId), uint32_t(eventId >> 32), block,
+         Philox::BootstrapEvent};
+        Philox::Transform(ctr, seed);
+        copy(ctr, ctr + 4, weights.begin() + 4 * block);
+    }
+    
+    
+    // Convert them into Poisson weights by inversion. The first thresholds are compared without
+    //branches in a loop that the compiler can vectorise, and the rare draws beyond them, with a
+    //probability of 1e-5, are corrected afterwards
+    uint32_t const *const thresholds = GetPoissonThresholds();
+    
+    for (unsigned r = 0; r < numReplicas; ++r)
+    {
+        uint32_t const u = weights[r];
+        unsigned k = 0;
+        
+        for (unsigned t = 0; t < 8; ++t)
+            k += (u >= thresholds[t]);
+        
+        if (k == 8)
+        {
+            while (k < numPoissonThresholds and u >= thresholds[k])
+                ++k;
+        }
+        
+        weights[r] = k;
+    }
+    
+    weights.resize(numReplicas);
+}
+
+
+uint64_t BootstrapHists::GetSeed() const
+{
+    return seed;
+}
+
+
+vector<double> BootstrapHists::GetCentred() const
+{
+    vector<double> centred(contents);
+    
+    for (unsigned bin = 0; bin < numBins + 2; ++bin)
+    {
+        double *const row = centred.data() + size_t(bin) * numReplicas;
+        double mean = 0.;
+        
+        for (unsigned r = 0; r < numReplicas; ++r)
+            mean += row[r];
+        
+        mean /= numReplicas;
+        
+        for (unsigned r = 0; r < numReplicas; ++r)
+            row[r] -= mean;
+    }
+    
+    return centred;
+}
@@ -0,0 +1,401 @@
+#include <CampaignDiff.hpp>
+
+#include <Parallel.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <ostream>
+#include <set>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Checks if two lists of digests describe byte-identical directories
+    bool DigestsMatch(vector<RootFileReader::ObjectDigest> const &a,
+     vector<RootFileReader::ObjectDigest> const &b)
+    {
+        if (a.size() != b.size())
+            return false;
+        
+        for (unsigned i = 0; i < a.size(); ++i)
+        {
+            if (a[i].name != b[i].name or a[i].className != b[i].className or
+             a[i].storedSize != b[i].storedSize or a[i].objLength != b[i].objLength or
+             a[i].checksum != b[i].checksum)
+                return false;
+        }
+        
+        return true;
+    }
+    
+    
+    /// Collects all non-empty histograms in a plot, indexed by their names
+    map<string, PlotContent::Hist const *> CollectHists(PlotContent const &content)
+    {
+        map<string, PlotContent::Hist const *> hists;
+        hists[content.data.name] = &content.data;
+        
+        for (auto const &p: content.processes)
+            hists[p.name] = &p;
+        
+        if (content.HasSystematics())
+        {
+            hists["syst_up"] = &content.systUp;
+            hists["syst_down"] = &content.systDown;
+        }
+        
+        return hists;
+    }
+}
+
+
+CampaignDiff::Entry::Entry():
+    status(Status::Identical), score(0.), maxAbsDiff(0.), maxRelDiff(0.), numChangedBins(0),
+    worstBin(0)
+{}
+
+
+CampaignDiff::CampaignDiff(string const &refFileName_, string const &targetFileName_):
+    refFileName(refFileName_), targetFileName(targetFileName_),
+    refReader(refFileName), targetReader(targetFileName),
+    absTol(0.), relTol(1e-6)
+{}
+
+
+vector<CampaignDiff::Entry> const &CampaignDiff::GetEntries() const
+{
+    return entries;
+}
+
+
+unsigned CampaignDiff::GetNumChanged() const
+{
+    return count_if(entries.begin(), entries.end(), [](Entry const &e)
+    {
+        return (e.status != Status::Identical and e.status != Status::Compatible);
+    });
+}
+
+
+string const &CampaignDiff::GetRefFileName() const
+{
+    return refFileName;
+}
+
+
+string const &CampaignDiff::GetTargetFileName() const
+{
+    return targetFileName;
+}
+
+
+void CampaignDiff::Run(vector<string> const &dirNames /*= {}*/, unsigned numThreads /*= 0*/)
+{
+    // Build the list of directories. By default the union of top-level directories is used, in
+    //the order in which they appear in the reference file. A file without subdirectories is
+    //treated as a single plot
+    vector<string> names(dirNames);
+    
+    if (names.empty())
+    {
+        names = ListDirectories(refReader);
+        set<string> known(names.begin(), names.end());
+        
+        for (auto const &name: ListDirectories(targetReader))
+        {
+            if (known.insert(name).second)
+                names.emplace_back(name);
+        }
+        
+        if (names.empty())
+            names.emplace_back("");
+    }
+    
+    entries.clear();
+    entries.resize(names.size());
+    
+    for (unsigned i = 0; i < names.size(); ++i)
+        entries[i].dirName = names[i];
+    
+    
+    // Directories are distributed among threads dynamically since the cost of processing them
+    //varies widely: byte-identical ones are only checksummed, while the rest are decompressed and
+    //compared bin by bin
+    Parallel::Run(entries.size(), numThreads, [this](unsigned i)
+    {
+        CompareDirectory(entries[i]);
+    });
+    
+    
+    // Rank the entries by severity
+    stable_sort(entries.begin(), entries.end(), [](Entry const &a, Entry const &b)
+    {
+        if (a.score != b.score)
+            return (a.score > b.score);
+        else
+            return (a.status > b.status);
+    });
+}
+
+
+void CampaignDiff::SetTolerances(double absTol_, double relTol_)
+{
+    if (absTol_ < 0. or relTol_ < 0.)
+        throw invalid_argument("Tolerances must be non-negative.");
+    
+    absTol = absTol_;
+    relTol = relTol_;
+}
+
+
+void CampaignDiff::WriteReport(ostream &out, bool includeUnchanged /*= false*/) const
+{
+    out << "# Reference: " << refFileName << "\n# Target: " << targetFileName << '\n';
+    out << "# Tolerances: absolute " << absTol << ", relative " << relTol << '\n';
+    out << "# Directories compared: " << entries.size() << ", changed: " << GetNumChanged() <<
+     '\n';
+    out << "rank\tstatus\tscore\tmax_abs_diff\tmax_rel_diff\tchanged_bins\tworst_hist\t"
+     "worst_bin\tdirectory\tmessage\n";
+    
+    unsigned rank = 0;
+    
+    for (auto const &e: entries)
+    {
+        ++rank;
+        
+        if (not includeUnchanged and
+         (e.status == Status::Identical or e.status == Status::Compatible))
+            continue;
+        
+        out << rank << '\t' << StatusLabel(e.status) << '\t' << e.score << '\t' <<
+         e.maxAbsDiff << '\t' << e.maxRelDiff << '\t' << e.numChangedBins << '\t' <<
+         e.worstHist << '\t' << e.worstBin << '\t' << e.dirName << '\t' << e.message << '\n';
+    }
+}
+
+
+char const *CampaignDiff::StatusLabel(Status status)
+{
+    switch (status)
+    {
+        case Status::Identical:
+            return "identical";
+        
+        case Status::Compatible:
+            return "compatible";
+        
+        case Status::Changed:
+            return "changed";
+        
+        case Status::Structural:
+            return "structural";
+        
+        case Status::OnlyInReference:
+            return "only_in_reference";
+        
+        case Status::OnlyInTarget:
+            return "only_in_target";
+        
+        case Status::Failed:
+            return "failed";
+    }
+    
+    return "unknown";
+}
+
+
+void CampaignDiff::CompareDirectory(Entry &entry) const
+{
+    double const inf = numeric_limits<double>::infinity();
+    
+    
+    // Pre-screen the directory with digests of stored objects. Only a directory that is absent
+    //from one of the files is reported as missing. Any other error, e.g. a corrupted file, marks
+    //the directory as failed
+    vector<RootFileReader::ObjectDigest> refDigests, targetDigests;
+    bool refExists = false, targetExists = false;
+    
+    try
+    {
+        refExists = refReader.HasDirectory(entry.dirName);
+        
+        if (refExists)
+            refDigests = refReader.GetDigests(entry.dirName);
+    }
+    catch (exception const &e)
+    {
+        entry.status = Status::Failed;
+        entry.score = inf;
+        entry.message = string("reference: ") + e.what();
+        return;
+    }
+    
+    try
+    {
+        targetExists = targetReader.HasDirectory(entry.dirName);
+        
+        if (targetExists)
+            targetDigests = targetReader.GetDigests(entry.dirName);
+    }
+    catch (exception const &e)
+    {
+        entry.status = Status::Failed;
+        entry.score = inf;
+        entry.message = string("target: ") + e.what();
+        return;
+    }
+    
+    if (not refExists or not targetExists)
+    {
+        entry.score = inf;
+        
+        if (refExists)
+            entry.status = Status::OnlyInReference;
+        else if (targetExists)
+            entry.status = Status::OnlyInTarget;
+        else
+        {
+            entry.status = Status::Failed;
+            entry.message = "directory not found in either file";
+        }
+        
+        return;
+    }
+    
+    if (DigestsMatch(refDigests, targetDigests))
+    {
+        entry.status = Status::Identical;
+        return;
+    }
+    
+    
+    // Bin-level comparison
+    try
+    {
+        PlotContent const ref(refReader.Read(entry.dirName));
+        PlotContent const target(targetReader.Read(entry.dirName));
+        ostringstream message;
+        
+        if (ref.GetNumBins() != target.GetNumBins() or
+         not equal(ref.edges.begin(), ref.edges.end(), target.edges.begin()))
+        {
+            entry.status = Status::Structural;
+            entry.score = inf;
+            entry.message = "binning differs";
+            return;
+        }
+        
+        auto const refHists(CollectHists(ref)), targetHists(CollectHists(target));
+        bool structural = false;
+        
+        for (auto const &h: refHists)
+        {
+            auto const match = targetHists.find(h.first);
+            
+            if (match == targetHists.end())
+            {
+                message << "removed " << h.first << "; ";
+                structural = true;
+            }
+            else
+                CompareHists(*h.second, *match->second, entry);
+        }
+        
+        for (auto const &h: targetHists)
+        {
+            if (refHists.count(h.first) == 0)
+            {
+                message << "added " << h.first << "; ";
+                structural = true;
+            }
+        }
+        
+        if (ref.title != target.title)
+            message << "title differs; ";
+        
+        if (structural)
+        {
+            entry.status = Status::Structural;
+            entry.score = inf;
+        }
+        else
+            entry.status = (entry.numChangedBins > 0) ? Status::Changed : Status::Compatible;
+        
+        entry.message = message.str();
+        
+        if (not entry.message.empty())
+            entry.message.resize(entry.message.size() - 2);
+    }
+    catch (exception const &e)
+    {
+        entry.status = Status::Failed;
+        entry.score = inf;
+        entry.message = e.what();
+    }
+}
+
+
+void CampaignDiff::CompareHists(PlotContent::Hist const &ref, PlotContent::Hist const &target,
+ Entry &entry) const
+{
+    vector<pair<string, pair<ArrayView<double>, ArrayView<double>>>> arrays{
+     {ref.name, {ref.contents, target.contents}}};
+    
+    
+    // Sums of squared weights are only compared if both histograms provide them. Otherwise they
+    //would be substituted with contents, and every difference in contents would be counted twice
+    if (not ref.sumw2.IsEmpty() and not target.sumw2.IsEmpty())
+        arrays.push_back({ref.name + " (sumw2)", {ref.sumw2, target.sumw2}});
+    
+    for (auto const &a: arrays)
+    {
+        ArrayView<double> const &x = a.second.first, &y = a.second.second;
+        
+        for (unsigned bin = 0; bin < x.GetSize(); ++bin)
+        {
+            double const diff = fabs(x[bin] - y[bin]);
+            
+            if (diff == 0.)
+                continue;
+            
+            double const tolerance = max(absTol, relTol * max(fabs(x[bin]), fabs(y[bin])));
+            double const score = (tolerance > 0.) ? diff / tolerance :
+             numeric_limits<double>::infinity();
+            
+            entry.maxAbsDiff = max(entry.maxAbsDiff, diff);
+            entry.maxRelDiff = max(entry.maxRelDiff, (x[bin] != 0.) ? diff / fabs(x[bin]) :
+             numeric_limits<double>::infinity());
+            
+            if (score > 1.)
+                ++entry.numChangedBins;
+            
+            if (score > entry.score)
+            {
+                entry.score = score;
+                entry.worstHist = a.first;
+                entry.worstBin = bin;
+            }
+        }
+    }
+}
+
+
+vector<string> CampaignDiff::ListDirectories(RootFileReader const &reader)
+{
+    vector<string> names;
+    
+    for (auto const &digest: reader.GetDigests())
+    {
+        if (RootFileReader::IsDirectory(digest.className))
+            names.emplace_back(digest.name);
+    }
+    
+    return names;
+}
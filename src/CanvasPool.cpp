@@ -0,0 +1,112 @@
+#include <CanvasPool.hpp>
+
+#include <TList.h>
+#include <TROOT.h>
+
+#include <list>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /**
+     * \brief Canvas kept in the pool together with its main pad and size
+     * 
+     * Raw pointers are used so that pooled canvases are not deleted by static destructors, which
+     * might run after ROOT has been shut down. Until then ROOT deletes them itself.
+     */
+    struct PooledCanvas
+    {
+        TCanvas *canvas;
+        TPad *mainPad;
+        unsigned width, height;
+    };
+    
+    
+    /// Pooled canvases, the most recently released ones first
+    list<PooledCanvas> pool;
+    
+    /// Maximal size of the pool
+    unsigned capacity = 8;
+    
+    /// Counter used to give unique names to pooled canvases
+    unsigned long numReleased = 0;
+    
+    
+    /// Deletes the least recently released canvas
+    void DropOldest()
+    {
+        delete pool.back().mainPad;
+        delete pool.back().canvas;
+        pool.pop_back();
+    }
+}
+
+
+void CanvasPool::Acquire(unsigned width, unsigned height, unique_ptr<TCanvas> &canvas,
+ unique_ptr<TPad> &mainPad)
+{
+    // Delete the pad before the canvas as if the pointers went out of scope
+    mainPad.reset();
+    canvas.reset();
+    
+    for (auto it = pool.begin(); it != pool.end(); ++it)
+    {
+        if (it->width == width and it->height == height)
+        {
+            canvas.reset(it->canvas);
+            mainPad.reset(it->mainPad);
+            pool.erase(it);
+            
+            canvas->SetName("canvas");
+            canvas->SetTitle("");
+            return;
+        }
+    }
+    
+    canvas.reset(new TCanvas("canvas", "", width, height));
+    mainPad.reset(new TPad("mainPad", "", 0., 0., 1., 1.));
+}
+
+
+void CanvasPool::Release(unique_ptr<TCanvas> &canvas, unique_ptr<TPad> &mainPad)
+{
+    if (not canvas or not mainPad or not gROOT->IsBatch() or capacity == 0)
+    {
+        mainPad.reset();
+        canvas.reset();
+        return;
+    }
+    
+    
+    // Unlink everything drawn in the canvas, including the main pad, which will be drawn again by
+    //the next figure. TPad::Clear deletes objects created by the pad itself, such as frames
+    mainPad->Clear();
+    mainPad->SetLogy(0);
+    canvas->GetListOfPrimitives()->Clear();
+    
+    
+    // A canvas constructed with the name of an existing one replaces it, so pooled canvases are
+    //given unique names
+    ostringstream name;
+    name << "pooledCanvas" << numReleased++;
+    canvas->SetName(name.str().c_str());
+    
+    if (pool.size() >= capacity)
+        DropOldest();
+    
+    unsigned const width = canvas->GetWw(), height = canvas->GetWh();
+    pool.push_front({canvas.release(), mainPad.release(), width, height});
+}
+
+
+void CanvasPool::SetCapacity(unsigned capacity_)
+{
+    capacity = capacity_;
+    
+    while (pool.size() > capacity)
+        DropOldest();
+}
@@ -0,0 +1,164 @@
+#include <CutScan.hpp>
+
+#include <cmath>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+CutScan::CutScan(ArrayView<double> const &edges, ArrayView<double> const &signal,
+ ArrayView<double> const &background)
+{
+    Compute(edges, signal, background);
+}
+
+
+CutScan::CutScan(PlotContent const &content, string const &signalName)
+{
+    // Sum all processes except for the signal into the background
+    unsigned const size = content.GetNumBins() + 2;
+    vector<double> bkg(size, 0.);
+    PlotContent::Hist const *sgn = nullptr;
+    
+    for (auto const &p: content.processes)
+    {
+        if (p.name == signalName)
+        {
+            sgn = &p;
+            continue;
+        }
+        
+        for (unsigned i = 0; i < size; ++i)
+            bkg[i] += p.contents[i];
+    }
+    
+    if (not sgn)
+    {
+        ostringstream ost;
+        ost << "Cannot scan cuts since there is no MC process \"" << signalName << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    Compute(content.edges, sgn->contents, ArrayView<double>(bkg.data(), bkg.size()));
+}
+
+
+vector<double> const &CutScan::GetAsimovSignificance(Direction direction) const
+{
+    return asimovSignif[int(direction)];
+}
+
+
+vector<double> const &CutScan::GetBackground(Direction direction) const
+{
+    return background[int(direction)];
+}
+
+
+vector<double> const &CutScan::GetBackgroundEfficiency(Direction direction) const
+{
+    return backgroundEff[int(direction)];
+}
+
+
+vector<double> const &CutScan::GetCuts() const
+{
+    return cuts;
+}
+
+
+vector<double> const &CutScan::GetSignal(Direction direction) const
+{
+    return signal[int(direction)];
+}
+
+
+vector<double> const &CutScan::GetSignalEfficiency(Direction direction) const
+{
+    return signalEff[int(direction)];
+}
+
+
+vector<double> const &CutScan::GetSimpleSignificance(Direction direction) const
+{
+    return simpleSignif[int(direction)];
+}
+
+
+void CutScan::Compute(ArrayView<double> const &edges, ArrayView<double> const &sgn,
+ ArrayView<double> const &bkg)
+{
+    unsigned const numCuts = edges.GetSize();
+    
+    if (numCuts < 2 or sgn.GetSize() != numCuts + 1 or bkg.GetSize() != numCuts + 1)
+    {
+        ostringstream ost;
+        ost << "Inconsistent sizes of arrays in a cut scan: " << numCuts << " bin edges, " <<
+         sgn.GetSize() << " signal bins, and " << bkg.GetSize() << " background bins.";
+        throw runtime_error(ost.str());
+    }
+    
+    cuts.assign(edges.begin(), edges.end());
+    
+    int const above = int(Direction::Above), below = int(Direction::Below);
+    
+    for (int d: {above, below})
+    {
+        signal[d].resize(numCuts);
+        background[d].resize(numCuts);
+    }
+    
+    
+    // Cut at edge k (in ROOT numbering, the lower edge of bin k + 1) selects bins 0 to k from below
+    //and bins k + 1 to numCuts from above. Accumulate both sides in a single loop from the two
+    //ends of the arrays
+    double sumBelowS = 0., sumBelowB = 0., sumAboveS = 0., sumAboveB = 0.;
+    
+    for (unsigned k = 0; k < numCuts; ++k)
+    {
+        sumBelowS += sgn[k];
+        sumBelowB += bkg[k];
+        signal[below][k] = sumBelowS;
+        background[below][k] = sumBelowB;
+        
+        unsigned const kRev = numCuts - 1 - k;
+        sumAboveS += sgn[kRev + 1];
+        sumAboveB += bkg[kRev + 1];
+        signal[above][kRev] = sumAboveS;
+        background[above][kRev] = sumAboveB;
+    }
+    
+    double const totalS = sumBelowS + sgn[numCuts];
+    double const totalB = sumBelowB + bkg[numCuts];
+    
+    
+    // Compute efficiencies and significances
+    for (int d: {above, below})
+    {
+        signalEff[d].resize(numCuts);
+        backgroundEff[d].resize(numCuts);
+        simpleSignif[d].resize(numCuts);
+        asimovSignif[d].resize(numCuts);
+        
+        for (unsigned k = 0; k < numCuts; ++k)
+        {
+            double const s = signal[d][k], b = background[d][k];
+            signalEff[d][k] = (totalS != 0.) ? s / totalS : 0.;
+            backgroundEff[d][k] = (totalB != 0.) ? b / totalB : 0.;
+            
+            if (b > 0.)
+            {
+                simpleSignif[d][k] = s / sqrt(b);
+                double const arg = 2. * ((s + b) * log1p(s / b) - s);
+                asimovSignif[d][k] = (arg > 0. and s > 0.) ? sqrt(arg) : 0.;
+            }
+            else
+            {
+                simpleSignif[d][k] = 0.;
+                asimovSignif[d][k] = 0.;
+            }
+        }
+    }
+}
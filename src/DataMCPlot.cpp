@@ -1,16 +1,25 @@
 #include <DataMCPlot.hpp>
 
+#include <CanvasPool.hpp>
+#include <PlotStyle.hpp>
+#include <StackRules.hpp>
+#include <Summation.hpp>
+#include <TextLayoutCache.hpp>
+#include <ToyBand.hpp>
+
 #include <TFile.h>
 #include <TKey.h>
 #include <TObjString.h>
 #include <THStack.h>
 #include <TLegend.h>
 #include <TLatex.h>
-#include <TStyle.h>
-#include <TGaxis.h>
+#include <TGraph.h>
 
 #include <boost/algorithm/string/predicate.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <stdexcept>
 #include <sstream>
 
@@ -18,20 +27,94 @@
 using namespace std;
 
 
+namespace
+{
+    /// Default fill colours for MC histograms that do not specify them
+    Color_t const defaultColours[] = {kAzure + 1, kOrange + 1, kGreen + 2, kRed + 1, kMagenta + 1,
+     kCyan + 1, kYellow + 1, kGray + 1};
+    
+    
+    /**
+     * \brief Creates a histogram from the given ROOT-free description
+     * 
+     * The histogram is not associated with any directory.
+     */
+    TH1 *CreateHist(PlotContent const &content, PlotContent::Hist const &hist)
+    {
+        bool const addDirectoryStatus = TH1::AddDirectoryStatus();
+        TH1::AddDirectory(false);
+        
+        TH1D *h = new TH1D(hist.name.c_str(), hist.title.c_str(), content.GetNumBins(),
+         content.edges.GetData());
+        
+        TH1::AddDirectory(addDirectoryStatus);
+        
+        
+        // Copy bin contents and uncertainties in one go
+        h->SetContent(hist.contents.GetData());
+        
+        if (not hist.sumw2.IsEmpty())
+        {
+            h->Sumw2();
+            h->GetSumw2()->Set(hist.sumw2.GetSize(), hist.sumw2.GetData());
+        }
+        
+        double sum = 0.;
+        
+        for (auto const &c: hist.contents)
+            sum += c;
+        
+        h->SetEntries(sum);
+        
+        return h;
+    }
+}
+
+
 DataMCPlot::DataMCPlot(string const &srcFileName, string const &dirName /*= ""*/):
+    normFactor(1.), isNormalized(false),
     plotResiduals(true), residualsRange(-0.25, 0.28),
-    drawSystematics(false)
+    drawSystematics(false),
+    drawCutScan(false), cutScanAsimov(true),
+    logY(false)
 {
     ReadFile(srcFileName, dirName);
 }
 
 
+DataMCPlot::DataMCPlot(PlotContent const &content):
+    normFactor(1.), isNormalized(false),
+    plotResiduals(true), residualsRange(-0.25, 0.28),
+    drawSystematics(false),
+    drawCutScan(false), cutScanAsimov(true),
+    logY(false)
+{
+    ReadContent(content);
+}
+
+
+DataMCPlot::DataMCPlot(PlotReader const &reader, string const &dirName /*= ""*/):
+    normFactor(1.), isNormalized(false),
+    plotResiduals(true), residualsRange(-0.25, 0.28),
+    drawSystematics(false),
+    drawCutScan(false), cutScanAsimov(true),
+    logY(false)
+{
+    ReadContent(reader.Read(dirName));
+}
+
+
 DataMCPlot::~DataMCPlot()
 {
     // Delete owned ROOT objects associated with the canvas in a reversed order with respect to
     //creation
     for (auto objIt = ownedObjects.rbegin(); objIt != ownedObjects.rend(); ++objIt)
         delete *objIt;
+    
+    
+    // The canvas can now be reused by other figures
+    legend.reset();
+    CanvasPool::Release(canvas, mainPad);
 }
 
 
@@ -52,29 +135,132 @@ shared_ptr<TH1> DataMCPlot::GetHist(string const &name) const
             return h;
     }
     
+    for (auto const &o: overlays)
+    {
+        if (name == o.first->GetName())
+            return o.first;
+    }
+    
     
     // If this point is reached, the requested histogram has not been found
     return shared_ptr<TH1>();
 }
 
 
-void DataMCPlot::NormalizeMCToData(bool isDensity)
+void DataMCPlot::DeclareOverlay(string const &pattern, bool stackOnTotal /*= false*/)
 {
-    // Normalization of histograms will be found using TH1::Integral. If the histograms represent
-    //event density, an option "width" should be given to the method
-    string const integrationOption((isDensity) ? "width" : "");
+    // Find matching histograms first so that the plot is not modified if an error occurs. The
+    //rules are shared with YieldTable
+    vector<string> stackNames;
+    vector<list<shared_ptr<TH1>>::iterator> histIts;
     
+    for (auto histIt = mcHists.begin(); histIt != mcHists.end(); ++histIt)
+    {
+        stackNames.emplace_back((*histIt)->GetName());
+        histIts.push_back(histIt);
+    }
     
-    // Calculate integrals
-    double const dataIntegral = dataHist->Integral(0, -1, integrationOption.c_str());
-    double mcIntegral = 0.;
+    vector<unsigned> const matches = StackRules::MatchOverlay(stackNames, pattern);
+    
+    
+    // Move the histograms out of the stack and restyle them as lines
+    for (unsigned const i: matches)
+    {
+        TH1 *h = histIts[i]->get();
+        h->SetLineColor(h->GetFillColor());
+        h->SetLineWidth(3);
+        h->SetFillStyle(0);
+        
+        overlays.emplace_back(*histIts[i], stackOnTotal);
+        mcHists.erase(histIts[i]);
+    }
+    
+    
+    // Update the total expectation and the central values of the band with systematical
+    //uncertainties
+    BuildTotal();
+    RecentreSystematics();
+}
+
+
+void DataMCPlot::BlindBins(function<bool(unsigned bin)> const &predicate)
+{
+    PrepareBlinding();
+    blinding.MaskIf(predicate);
+}
+
+
+void DataMCPlot::BlindBySignificance(string const &signalName, double threshold)
+{
+    shared_ptr<TH1> const signalHist = GetHist(signalName);
+    
+    if (not signalHist or signalHist == dataHist)
+    {
+        ostringstream ost;
+        ost << "Cannot blind the plot since there is no MC process \"" << signalName << "\".";
+        throw runtime_error(ost.str());
+    }
     
-    for (auto const &h: mcHists)
-        mcIntegral += h->Integral(0, -1, integrationOption.c_str());
     
+    // The background is the total expectation of the stack, with the signal removed if it is
+    //included in the stack
+    bool const signalInStack = (find(mcHists.begin(), mcHists.end(), signalHist) != mcHists.end());
+    PrepareBlinding();
     
-    // Rescale MC histograms
-    double const factor = dataIntegral / mcIntegral;
+    blinding.MaskIf([&](unsigned bin)
+    {
+        double const s = signalHist->GetBinContent(bin);
+        double const b = mcTotalHist->GetBinContent(bin) - ((signalInStack) ? s : 0.);
+        return (b > 0.) ? s / sqrt(b) > threshold : s > 0.;
+    });
+}
+
+
+void DataMCPlot::BlindRange(double min, double max)
+{
+    PrepareBlinding();
+    
+    TAxis const *axis = dataHist->GetXaxis();
+    vector<double> edges(axis->GetNbins() + 1);
+    
+    for (int bin = 1; bin <= axis->GetNbins() + 1; ++bin)
+        edges[bin - 1] = axis->GetBinLowEdge(bin);
+    
+    blinding.MaskRange(ArrayView<double>(edges.data(), edges.size()), min, max);
+}
+
+
+BinMask const &DataMCPlot::GetBlinding() const
+{
+    return blinding;
+}
+
+
+void DataMCPlot::NormalizeMCToData(bool isDensity)
+{
+    // Integrate data and the total expectation bin by bin, without copying the histograms.
+    //Blinded bins are excluded, and the sums are compensated in the same way as in
+    //StackRules::ComputeNormFactor, which is used by PlotBatch and YieldTable
+    int const numBins = dataHist->GetNbinsX();
+    double dataSum = 0., dataComp = 0., mcSum = 0., mcComp = 0.;
+    
+    for (int bin = 0; bin <= numBins + 1; ++bin)
+    {
+        if (blinding.IsMasked(bin))
+            continue;
+        
+        double const w = (isDensity) ? dataHist->GetBinWidth(bin) : 1.;
+        Summation::AddCompensated(dataSum, dataComp, dataHist->GetBinContent(bin) * w);
+        Summation::AddCompensated(mcSum, mcComp, mcTotalHist->GetBinContent(bin) * w);
+    }
+    
+    double const factor = (dataSum + dataComp) / (mcSum + mcComp);
+    
+    
+    // Rescale MC histograms. The factor is remembered so that it can be reapplied to morphed
+    //templates
+    normFactor *= factor;
+    isNormalized = true;
     mcTotalHist->Scale(factor);
     
     for (auto &h: mcHists)
@@ -97,6 +283,323 @@ void DataMCPlot::NormalizeMCToData(bool isDensity)
 }
 
 
+void DataMCPlot::BuildToyBand(vector<map<string, double>> const &nuisances,
+ unsigned numToys /*= 10000*/, uint64_t seed /*= 0*/)
+{
+    // Copy contents of the stacked histograms into plain arrays. Under- and overflow bins are not
+    //included in the band
+    int const numBins = mcTotalHist->GetNbinsX();
+    vector<vector<double>> contents;
+    vector<ArrayView<double>> views;
+    
+    for (auto const &h: mcHists)
+    {
+        contents.emplace_back(numBins);
+        
+        for (int bin = 1; bin <= numBins; ++bin)
+            contents.back()[bin - 1] = h->GetBinContent(bin);
+    }
+    
+    for (auto const &c: contents)
+        views.emplace_back(c.data(), c.size());
+    
+    ToyBand band(views);
+    
+    
+    // Translate the nuisances into values of kappa for all processes in the stack
+    for (auto const &nuisance: nuisances)
+    {
+        vector<double> kappas(mcHists.size(), 1.);
+        
+        for (auto const &effect: nuisance)
+        {
+            auto const res = find_if(mcHists.begin(), mcHists.end(),
+             [&effect](shared_ptr<TH1> const &h){return effect.first == h->GetName();});
+            
+            if (res == mcHists.end())
+            {
+                ostringstream ost;
+                ost << "Cannot build the band since there is no MC process \"" << effect.first <<
+                 "\" in the stack.";
+                throw runtime_error(ost.str());
+            }
+            
+            kappas[distance(mcHists.begin(), res)] = effect.second;
+        }
+        
+        band.AddNuisance(kappas);
+    }
+    
+    band.Compute(numToys, seed);
+    
+    
+    // Write the band into the graph. The central values follow the total expectation
+    systError.reset(new TGraphAsymmErrors(mcTotalHist.get()));
+    systError->SetName("systError");
+    
+    for (int bin = 1; bin <= numBins; ++bin)
+    {
+        double const nominal = band.GetNominal()[bin - 1];
+        systError->SetPointEYhigh(bin - 1, max(band.GetUpper()[bin - 1] - nominal, 0.));
+        systError->SetPointEYlow(bin - 1, max(nominal - band.GetLower()[bin - 1], 0.));
+    }
+    
+    systError->SetFillColor(kBlack);
+    systError->SetFillStyle(3354);
+}
+
+
+void DataMCPlot::SetDataBootstrap(unsigned numReplicas, uint64_t seed /*= 0*/)
+{
+    int const numBins = dataHist->GetNbinsX();
+    vector<double> edges, contents;
+    
+    for (int bin = 1; bin <= numBins + 1; ++bin)
+        edges.push_back(dataHist->GetBinLowEdge(bin));
+    
+    for (int bin = 0; bin <= numBins + 1; ++bin)
+        contents.push_back(dataHist->GetBinContent(bin));
+    
+    SetDataBootstrap(BootstrapHists::FromHistogram(edges,
+     ArrayView<double>(contents.data(), contents.size()), numReplicas, seed));
+}
+
+
+void DataMCPlot::SetDataBootstrap(BootstrapHists const &replicas)
+{
+    int const numBins = dataHist->GetNbinsX();
+    
+    
+    // Compare the binning. Edges are allowed to differ by rounding errors, which appear when a
+    //histogram with equal bins computes them from its range
+    vector<double> const &edges = replicas.GetEdges();
+    bool binningMatches = (int(replicas.GetNumBins()) == numBins);
+    double const tolerance = 1e-9 * (dataHist->GetXaxis()->GetXmax() -
+     dataHist->GetXaxis()->GetXmin());
+    
+    for (int bin = 1; binningMatches and bin <= numBins + 1; ++bin)
+    {
+        if (fabs(edges[bin - 1] - dataHist->GetBinLowEdge(bin)) > tolerance)
+            binningMatches = false;
+    }
+    
+    if (not binningMatches)
+    {
+        ostringstream ost;
+        ost << "Bootstrap replicas with " << replicas.GetNumBins() << " bins in the range [" <<
+         edges.front() << ", " << edges.back() << "] do not match data histogram with " <<
+         numBins << " bins in the range [" << dataHist->GetXaxis()->GetXmin() << ", " <<
+         dataHist->GetXaxis()->GetXmax() << "] or differ in bin edges.";
+        throw runtime_error(ost.str());
+    }
+    
+    dataBootstrap.reset(new BootstrapHists(replicas));
+    
+    
+    // Replace the errors of data. The histogram with residuals is cloned from the data histogram
+    //and inherits them
+    vector<double> const errors(dataBootstrap->GetErrors());
+    
+    for (int bin = 0; bin <= numBins + 1; ++bin)
+        dataHist->SetBinError(bin, errors[bin]);
+}
+
+
+vector<double> DataMCPlot::GetResidualCovariance() const
+{
+    if (not dataBootstrap)
+        throw runtime_error("Bootstrap replicas of data have not been set.");
+    
+    
+    // Residuals are (d_i - m_i) / m_i, and only data fluctuate. Hence their covariance is the one
+    //of data scaled by the inverse expectations
+    vector<double> covariance(dataBootstrap->GetCovariance());
+    unsigned const n = dataBootstrap->GetNumBins() + 2;
+    
+    for (unsigned i = 0; i < n; ++i)
+    {
+        double const mi = mcTotalHist->GetBinContent(i);
+        
+        for (unsigned j = 0; j < n; ++j)
+        {
+            double const mj = mcTotalHist->GetBinContent(j);
+            double &c = covariance[size_t(i) * n + j];
+            c = (mi == 0. or mj == 0.) ? 0. : c / (mi * mj);
+        }
+    }
+    
+    return covariance;
+}
+
+
+void DataMCPlot::AddTemplates(string const &process, string const &source,
+ ArrayView<double> const &up, ArrayView<double> const &down,
+ TemplateMorph::Interpolation interpolation /*= TemplateMorph::Interpolation::Additive*/)
+{
+    // Nominal templates must not include the normalization, which is applied on top of morphing
+    if (isNormalized)
+        throw runtime_error("Templates must be added before NormalizeMCToData is called.");
+    
+    
+    // Take the nominal templates from the current histograms when templates are added for the
+    //first time
+    if (not morph)
+    {
+        vector<vector<double>> contents;
+        vector<ArrayView<double>> views;
+        
+        for (auto const &h: mcHists)
+            morphHists.emplace_back(h);
+        
+        for (auto const &o: overlays)
+            morphHists.emplace_back(o.first);
+        
+        for (auto const &h: morphHists)
+        {
+            contents.emplace_back(h->GetNbinsX() + 2);
+            
+            for (int bin = 0; bin <= h->GetNbinsX() + 1; ++bin)
+                contents.back()[bin] = h->GetBinContent(bin);
+        }
+        
+        for (auto const &c: contents)
+            views.emplace_back(c.data(), c.size());
+        
+        morph.reset(new TemplateMorph(views));
+    }
+    
+    
+    auto const res = find_if(morphHists.begin(), morphHists.end(),
+     [&process](shared_ptr<TH1> const &h){return process == h->GetName();});
+    
+    if (res == morphHists.end())
+    {
+        ostringstream ost;
+        ost << "Cannot add templates for source \"" << source << "\" since there is no MC " <<
+         "process \"" << process << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    morph->AddTemplates(distance(morphHists.begin(), res), source, up, down, interpolation);
+}
+
+
+void DataMCPlot::ApplyNuisances(map<string, double> const &params)
+{
+    if (not morph)
+        throw runtime_error("Cannot apply nuisance parameters since no templates have been added.");
+    
+    morph->Evaluate(params);
+    
+    
+    // Copy the morphed contents into the histograms, reapplying the normalization to processes in
+    //the stack. Their errors are not changed
+    for (unsigned p = 0; p < morphHists.size(); ++p)
+    {
+        vector<double> const &contents = morph->GetMorphed(p);
+        bool const inStack = (find(mcHists.begin(), mcHists.end(), morphHists[p]) != mcHists.end());
+        double const factor = (inStack) ? normFactor : 1.;
+        
+        for (unsigned bin = 0; bin < contents.size(); ++bin)
+            morphHists[p]->SetBinContent(bin, contents[bin] * factor);
+    }
+    
+    BuildTotal();
+    RecentreSystematics();
+}
+
+
+void DataMCPlot::ReadTemplates(string const &srcFileName, string const &dirName /*= ""*/,
+ TemplateMorph::Interpolation interpolation /*= TemplateMorph::Interpolation::Additive*/)
+{
+    unique_ptr<TFile> srcFile(TFile::Open(srcFileName.c_str()));
+    
+    if (not srcFile or srcFile->IsZombie())
+    {
+        ostringstream ost;
+        ost << "Source file \"" << srcFileName << "\" is corrupted or is not a valid ROOT file.";
+        throw runtime_error(ost.str());
+    }
+    
+    unique_ptr<TDirectory> curDirectory(srcFile->GetDirectory(dirName.c_str()));
+    
+    if (not curDirectory)
+    {
+        ostringstream ost;
+        ost << "Source file \"" << srcFileName << "\" does not contain a directory \"" <<
+         dirName << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Names of all MC processes, including overlays, to split names of the templates
+    vector<string> processNames;
+    
+    for (auto const &h: mcHists)
+        processNames.emplace_back(h->GetName());
+    
+    for (auto const &o: overlays)
+        processNames.emplace_back(o.first->GetName());
+    
+    
+    // Find up variations and the matching down variations
+    TIter keyIter(curDirectory->GetListOfKeys());
+    
+    while (true)
+    {
+        TKey *key = dynamic_cast<TKey *>(keyIter.Next());
+        
+        if (not key)  // the end of the list has been reached
+            break;
+        
+        string const keyName(key->GetName());
+        
+        if (keyName.size() < 2 or keyName.compare(keyName.size() - 2, 2, "Up") != 0)
+            continue;
+        
+        string process;
+        
+        for (auto const &name: processNames)
+        {
+            if (keyName.size() > name.size() + 3 and keyName.compare(0, name.size(), name) == 0 and
+             keyName[name.size()] == '_' and name.size() > process.size())
+                process = name;
+        }
+        
+        if (process.empty())
+            continue;
+        
+        string const source(keyName.substr(process.size() + 1,
+         keyName.size() - process.size() - 3));
+        string const downName(process + "_" + source + "Down");
+        unique_ptr<TH1> up(dynamic_cast<TH1 *>(curDirectory->Get(keyName.c_str())));
+        unique_ptr<TH1> down(dynamic_cast<TH1 *>(curDirectory->Get(downName.c_str())));
+        
+        if (not up or not down)
+        {
+            ostringstream ost;
+            ost << "Failed to read templates \"" << keyName << "\" and \"" << downName <<
+             "\" from file \"" << srcFileName << "\", directory \"" << dirName << "\".";
+            throw runtime_error(ost.str());
+        }
+        
+        up->SetDirectory(nullptr);
+        down->SetDirectory(nullptr);
+        
+        vector<double> upContents, downContents;
+        
+        for (int bin = 0; bin <= up->GetNbinsX() + 1; ++bin)
+            upContents.push_back(up->GetBinContent(bin));
+        
+        for (int bin = 0; bin <= down->GetNbinsX() + 1; ++bin)
+            downContents.push_back(down->GetBinContent(bin));
+        
+        AddTemplates(process, source, ArrayView<double>(upContents.data(), upContents.size()),
+         ArrayView<double>(downContents.data(), downContents.size()), interpolation);
+    }
+}
+
+
 void DataMCPlot::RequestResiduals(bool plotResiduals_, double min /*= -0.25*/,
  double max /*= 0.28*/)
 {
@@ -114,42 +617,110 @@ void DataMCPlot::RequestSystematics(bool drawSystematics_ /*= true*/,
 }
 
 
+void DataMCPlot::RequestCutScan(bool drawCutScan_, string const &signalName /*= ""*/,
+ bool useAsimov /*= true*/)
+{
+    drawCutScan = drawCutScan_;
+    cutScanSignal = signalName;
+    cutScanAsimov = useAsimov;
+}
+
+
+void DataMCPlot::SetLogY(bool logY_ /*= true*/)
+{
+    logY = logY_;
+}
+
+
+CutScan DataMCPlot::ScanCuts(string const &signalName) const
+{
+    // Extract bin edges and contents into plain arrays. The signal is separated from the other
+    //processes, which are summed into the background
+    TAxis const *axis = mcTotalHist->GetXaxis();
+    int const numBins = axis->GetNbins();
+    vector<double> edges(numBins + 1), signal(numBins + 2, 0.), background(numBins + 2, 0.);
+    
+    for (int bin = 1; bin <= numBins + 1; ++bin)
+        edges[bin - 1] = axis->GetBinLowEdge(bin);
+    
+    bool signalFound = false;
+    
+    for (auto const &h: mcHists)
+    {
+        bool const isSignal = (signalName == h->GetName());
+        vector<double> &target = (isSignal) ? signal : background;
+        signalFound |= isSignal;
+        
+        for (int bin = 0; bin <= numBins + 1; ++bin)
+            target[bin] += h->GetBinContent(bin);
+    }
+    
+    // The signal can also be one of the overlaid processes. Other overlays are ignored
+    for (auto const &o: overlays)
+    {
+        if (signalName != o.first->GetName())
+            continue;
+        
+        signalFound = true;
+        
+        for (int bin = 0; bin <= numBins + 1; ++bin)
+            signal[bin] += o.first->GetBinContent(bin);
+    }
+    
+    if (not signalFound)
+    {
+        ostringstream ost;
+        ost << "Cannot scan cuts since there is no MC process \"" << signalName << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    return CutScan(ArrayView<double>(edges.data(), edges.size()),
+     ArrayView<double>(signal.data(), signal.size()),
+     ArrayView<double>(background.data(), background.size()));
+}
+
+
 TCanvas &DataMCPlot::Draw()
+{
+    // Create a canvas and the main pad. In batch mode they are taken from the pool if possible
+    CanvasPool::Acquire(1500, 1000 / (1. - GetBottomSpacing()), canvas, mainPad);
+    DrawInPad(*canvas);
+    
+    return *canvas;
+}
+
+
+void DataMCPlot::DrawInPad(TVirtualPad &host, bool standalone /*= true*/)
 {
     // Global decoration settings
-    gStyle->SetErrorX(0.);
-    gStyle->SetHistMinimumZero(true);
-    gStyle->SetOptStat(0);
-    gStyle->SetStripDecimals(false);
-    TGaxis::SetMaxDigits(3);
-    
-    gStyle->SetTitleFont(42);
-    gStyle->SetTitleFontSize(0.04);
-    gStyle->SetTitleFont(42, "XYZ");
-    gStyle->SetTitleXOffset(0.9);
-    gStyle->SetTitleYOffset(1.0);
-    gStyle->SetTitleSize(0.045, "XYZ");
-    gStyle->SetLabelFont(42, "XYZ");
-    gStyle->SetLabelOffset(0.007, "XYZ");
-    gStyle->SetLabelSize(0.04, "XYZ");
-    gStyle->SetNdivisions(508, "XYZ");
-    
-    
-    // Setup layout of pads within the canvas
-    // Allow space for the residuals plot if requested
-    double const bottomSpacing = (plotResiduals) ? 0.17 : 0.;
+    PlotStyle::SetGlobal();
+    
+    
+    // Setup layout of pads within the host pad
+    // Allow space for the residuals plot and the cut scan if requested
+    double const residualsSpacing = (plotResiduals) ? PlotStyle::lowerPadHeight : 0.;
+    double const cutScanSpacing = (drawCutScan) ? PlotStyle::lowerPadHeight : 0.;
+    double const bottomSpacing = GetBottomSpacing();
     
     // Margin for axis labels
-    double const margin = 0.1;
+    double const margin = PlotStyle::margin;
     
     // Width of the main pad
-    double const mainPadWidth = 0.85;
+    double const mainPadWidth = PlotStyle::mainPadWidth;
+    
     
+    // Extract the label of the x axis. Axis titles are omitted if they are shared with other
+    //figures
+    auto const pos1 = title.find_first_of(';');
+    auto const pos2 = title.find_first_of(';', pos1 + 1);
+    string const xAxisTitle((standalone) ? title.substr(pos1 + 1, pos2 - pos1 - 1) : "");
     
-    // Create a canvas and pads to draw in
-    canvas.reset(new TCanvas("canvas", "", 1500, 1000 / (1. - bottomSpacing)));
     
-    mainPad.reset(new TPad("mainPad", "", 0., bottomSpacing, mainPadWidth + margin, 1.));
+    // Create the main pad if it has not been provided by the canvas pool
+    if (not mainPad)
+        mainPad.reset(new TPad("mainPad", "", 0., 0., 1., 1.));
+    
+    mainPad->SetPad(0., bottomSpacing, mainPadWidth + margin, 1.);
     mainPad->SetTicks();
     
     // Adjust margins to host axis labels (otherwise they would be cropped)
@@ -158,11 +729,13 @@ TCanvas &DataMCPlot::Draw()
     mainPad->SetBottomMargin(margin / mainPad->GetHNDC());
     mainPad->SetTopMargin(margin / mainPad->GetHNDC());
     
+    host.cd();
     mainPad->Draw();
     
     
     // Put MC histogramss into a stack
-    THStack *mcStack = NewOwnedObject<THStack>("mcStack", title.c_str());
+    THStack *mcStack = NewOwnedObject<THStack>("mcStack",
+     ((standalone) ? title : title.substr(0, pos1)).c_str());
     
     for (auto h = mcHists.crbegin(); h != mcHists.crend(); ++h)
         mcStack->Add(h->get(), "hist");
@@ -172,13 +745,88 @@ TCanvas &DataMCPlot::Draw()
     mainPad->cd();
     mcStack->Draw();
     
-    if (dataHist)
+    
+    // Draw overlaid processes as lines. Those stacked on top of the total expectation are drawn as
+    //step graphs computed from the contents of the total and the overlay, so that no histograms
+    //are cloned
+    for (auto const &o: overlays)
+    {
+        TH1 *h = o.first.get();
+        
+        if (not o.second)
+        {
+            h->Draw("hist same");
+            continue;
+        }
+        
+        int const numBins = h->GetNbinsX();
+        TGraph *graph = NewOwnedObject<TGraph>(2 * numBins);
+        graph->SetName((string(h->GetName()) + "OnTotal").c_str());
+        
+        for (int bin = 1; bin <= numBins; ++bin)
+        {
+            double const y = mcTotalHist->GetBinContent(bin) + h->GetBinContent(bin);
+            graph->SetPoint(2 * bin - 2, h->GetXaxis()->GetBinLowEdge(bin), y);
+            graph->SetPoint(2 * bin - 1, h->GetXaxis()->GetBinUpEdge(bin), y);
+        }
+        
+        graph->SetLineColor(h->GetLineColor());
+        graph->SetLineWidth(h->GetLineWidth());
+        graph->Draw("l");
+    }
+    
+    
+    // Blinded data are drawn as a graph that only includes visible bins. The graph is also used in
+    //the legend so that the original histogram is not stored when the canvas is saved
+    TObject *dataDrawn = dataHist.get();
+    
+    if (dataHist and blinding.IsActive())
+    {
+        TGraphAsymmErrors *dataGraph = NewOwnedObject<TGraphAsymmErrors>();
+        dataGraph->SetName("dataBlinded");
+        
+        for (int bin = 1; bin <= dataHist->GetNbinsX(); ++bin)
+        {
+            if (blinding.IsMasked(bin))
+                continue;
+            
+            int const n = dataGraph->GetN();
+            dataGraph->SetPoint(n, dataHist->GetBinCenter(bin), dataHist->GetBinContent(bin));
+            dataGraph->SetPointEYhigh(n, dataHist->GetBinError(bin));
+            dataGraph->SetPointEYlow(n, dataHist->GetBinError(bin));
+        }
+        
+        dataGraph->SetMarkerStyle(dataHist->GetMarkerStyle());
+        dataGraph->SetMarkerColor(dataHist->GetMarkerColor());
+        dataGraph->SetLineColor(dataHist->GetLineColor());
+        dataGraph->Draw("p");
+        dataDrawn = dataGraph;
+    }
+    else if (dataHist)
         dataHist->Draw("p0 e1 same");
     
     
-    // Create  and draw a legend
-    legend.reset(new TLegend(0.86, 0.9 - 0.04 * (mcHists.size() + ((dataHist) ? 1 : 0)), 0.99,
-     0.9));
+    // Create  and draw a legend. It is widened if the labels do not fit into the default width
+    vector<string> legendLabels;
+    
+    if (dataHist)
+        legendLabels.emplace_back(dataHist->GetTitle());
+    
+    for (auto const &h: mcHists)
+        legendLabels.emplace_back(h->GetTitle());
+    
+    for (auto const &o: overlays)
+        legendLabels.emplace_back(o.first->GetTitle());
+    
+    if (drawSystematics and systLegendLabel != "")
+        legendLabels.emplace_back(systLegendLabel);
+    
+    // The height accounts for all entries, including the one for the band with systematical
+    //uncertainties, which is added when the band is drawn. Very long labels cannot push the
+    //legend beyond the left edge of the pad
+    double const legendWidth = TextLayoutCache::GetLegendWidth(legendLabels, 42, 0.03, host);
+    legend.reset(new TLegend(max(0., min(0.86, 0.99 - legendWidth)),
+     0.9 - 0.04 * legendLabels.size(), 0.99, 0.9));
     legend->SetName("legend");
     legend->SetFillColor(kWhite);
     legend->SetTextFont(42);
@@ -186,21 +834,46 @@ TCanvas &DataMCPlot::Draw()
     legend->SetBorderSize(0);
     
     if (dataHist)
-        legend->AddEntry(dataHist.get(), dataHist->GetTitle(), "p");
+        legend->AddEntry(dataDrawn, dataHist->GetTitle(), "p");
     
     for (auto const &h: mcHists)
         legend->AddEntry(h.get(), h->GetTitle(), "f");
     
-    canvas->cd();
-    legend->Draw();
+    for (auto const &o: overlays)
+        legend->AddEntry(o.first.get(), o.first->GetTitle(), "l");
+    
+    if (standalone)
+    {
+        host.cd();
+        legend->Draw();
+    }
+    
+    
+    // Set the range of the y axis. In the logarithmic scale the same relative margin is added in
+    //the logarithm of the range. In the linear scale the axis starts at zero even if the band
+    //with uncertainties extends below it, since negative event counts are not meaningful
+    double yMin = 0., yMax, yMinPositive;
+    FindYRange(yMax, yMinPositive);
+    
+    if (logY)
+    {
+        if (yMinPositive > yMax)
+            yMinPositive = yMax = 1.;
+        
+        yMin = 0.5 * yMinPositive;
+        yMax = yMax * pow(yMax / yMin, 0.1);
+        mainPad->SetLogy();
+    }
+    else
+        yMax *= 1.1;
     
+    mcStack->SetMinimum(yMin);
+    mcStack->SetMaximum(yMax);
     
-    // Update the maximum
     if (dataHist)
     {
-        double const histMax = 1.1 * max(mcStack->GetMaximum(), dataHist->GetMaximum());
-        mcStack->SetMaximum(histMax);
-        dataHist->SetMaximum(histMax);
+        dataHist->SetMinimum(yMin);
+        dataHist->SetMaximum(yMax);
     }
     
     
@@ -224,41 +897,33 @@ TCanvas &DataMCPlot::Draw()
         
         residualsHist->Add(mcTotalHist.get(), -1);
         residualsHist->Divide(mcTotalHist.get());
+        
+        
+        // Erase blinded bins so that they are not stored when the canvas is saved
+        for (int bin = 0; bin <= residualsHist->GetNbinsX() + 1; ++bin)
+        {
+            if (blinding.IsMasked(bin))
+            {
+                residualsHist->SetBinContent(bin, 0.);
+                residualsHist->SetBinError(bin, 0.);
+            }
+        }
                 
         
         // Create a pad to draw residuals
         TPad *residualsPad = NewOwnedObject<TPad>("residualsPad", "", 0., 0., mainPadWidth + margin,
-         bottomSpacing + margin);
-        
-        
-        // Adjust the pad's margins so that axis labels are not cropped
-        residualsPad->SetLeftMargin(margin / residualsPad->GetWNDC());
-        residualsPad->SetRightMargin(margin / residualsPad->GetWNDC());
-        residualsPad->SetBottomMargin(margin / residualsPad->GetHNDC());
-        residualsPad->SetTopMargin(0.);
-        
-        
-        // Decoration of the pad
-        residualsPad->SetTicks();
-        residualsPad->SetGrid(0, 1);
-        
-        residualsPad->SetFillStyle(0);
-        //^ Needed not to oscure the lower half of the zero label in the mainPad
+         residualsSpacing + margin);
+        PlotStyle::ConfigureLowerPad(*residualsPad, true);
         
         
         // Draw the pad
-        canvas->cd();
+        host.cd();
         residualsPad->Draw();
         
         
-        // Extract the label of the x axis of the MC stacked plot
-        auto const pos1 = title.find_first_of(';');
-        auto const pos2 = title.find_first_of(';', pos1 + 1);
-        string const xAxisTitle(title.substr(pos1 + 1, pos2 - pos1 - 1));
-        
-        
         // Reset the title of the residuals histogram. It gets axis titles only
-        residualsHist->SetTitle((string(";") + xAxisTitle + ";#frac{Data-MC}{MC}").c_str());
+        residualsHist->SetTitle((";" + xAxisTitle +
+         ((standalone) ? ";#frac{Data-MC}{MC}" : ";")).c_str());
         
         
         // Decoration of the residuals histogram
@@ -268,26 +933,9 @@ TCanvas &DataMCPlot::Draw()
         residualsHist->SetMarkerStyle(20);
         residualsHist->SetLineColor(kBlack);
         
-        TAxis *xAxis = residualsHist->GetXaxis();
-        TAxis *yAxis = residualsHist->GetYaxis();
-        
-        // Make axis label and titles of same size as in the main pad (the actual text size for the
-        //default font is linked up with the current pad's smallest dimension)
-        xAxis->SetTitleSize(mcStack->GetXaxis()->GetTitleSize() *
-         mainPad->GetHNDC() / residualsPad->GetHNDC());
-        xAxis->SetLabelSize(mcStack->GetXaxis()->GetLabelSize() *
-         mainPad->GetHNDC() / residualsPad->GetHNDC());
-        yAxis->SetTitleSize(mcStack->GetXaxis()->GetTitleSize() *
-         mainPad->GetHNDC() / residualsPad->GetHNDC());
-        yAxis->SetLabelSize(mcStack->GetXaxis()->GetLabelSize() *
-         mainPad->GetHNDC() / residualsPad->GetHNDC());
-        
-        yAxis->SetNdivisions(404);
-        yAxis->CenterTitle();
-        yAxis->SetTitleOffset(0.33);
-        yAxis->SetLabelOffset(mcStack->GetYaxis()->GetLabelOffset());
-        xAxis->SetTickLength(xAxis->GetTickLength() * (1. - 2. * margin - bottomSpacing) /
-         bottomSpacing);
+        PlotStyle::MatchLowerAxes(*residualsHist, *mcStack->GetXaxis(), *mainPad, *residualsPad,
+         (1. - 2. * margin - bottomSpacing) / residualsSpacing);
+        residualsHist->GetYaxis()->SetLabelOffset(mcStack->GetYaxis()->GetLabelOffset());
         
         
         // // Alter the y axis so that its labels do not overlap with the ones of the stacked plot.
@@ -299,7 +947,32 @@ TCanvas &DataMCPlot::Draw()
         
         // Draw the residuals histogram
         residualsPad->cd();
-        residualsHist->Draw("p0 e1");
+        
+        if (not blinding.IsActive())
+            residualsHist->Draw("p0 e1");
+        else
+        {
+            // Only draw the axes of the histogram, and represent visible bins with a graph
+            residualsHist->Draw("axis");
+            TGraphAsymmErrors *residualsGraph = NewOwnedObject<TGraphAsymmErrors>();
+            residualsGraph->SetName("residualsBlinded");
+            
+            for (int bin = 1; bin <= residualsHist->GetNbinsX(); ++bin)
+            {
+                if (blinding.IsMasked(bin))
+                    continue;
+                
+                int const n = residualsGraph->GetN();
+                residualsGraph->SetPoint(n, residualsHist->GetBinCenter(bin),
+                 residualsHist->GetBinContent(bin));
+                residualsGraph->SetPointEYhigh(n, residualsHist->GetBinError(bin));
+                residualsGraph->SetPointEYlow(n, residualsHist->GetBinError(bin));
+            }
+            
+            residualsGraph->SetMarkerStyle(20);
+            residualsGraph->SetLineColor(kBlack);
+            residualsGraph->Draw("p");
+        }
         
         
         // Remove the labels from x axis of the main histogram
@@ -335,7 +1008,61 @@ TCanvas &DataMCPlot::Draw()
     }
     
     
-    return *canvas;
+    // Draw significance curves for the cut scan if requested
+    if (drawCutScan)
+    {
+        CutScan const scan(ScanCuts(cutScanSignal));
+        vector<double> const &cuts = scan.GetCuts();
+        
+        
+        // The pad is placed directly above the residuals pad. If there are no residuals, it hosts
+        //the labels of the x axis
+        TPad *cutScanPad = NewOwnedObject<TPad>("cutScanPad", "", 0.,
+         (plotResiduals) ? residualsSpacing + margin : 0., mainPadWidth + margin,
+         bottomSpacing + margin);
+        PlotStyle::ConfigureLowerPad(*cutScanPad, not plotResiduals);
+        
+        host.cd();
+        cutScanPad->Draw();
+        
+        
+        // Create graphs for both directions of the cut
+        double maxSignif = 0.;
+        TGraph *graphs[2];
+        
+        for (auto const direction: {CutScan::Direction::Above, CutScan::Direction::Below})
+        {
+            vector<double> const &signif = (cutScanAsimov) ?
+             scan.GetAsimovSignificance(direction) : scan.GetSimpleSignificance(direction);
+            
+            TGraph *graph = NewOwnedObject<TGraph>(int(cuts.size()), cuts.data(), signif.data());
+            graph->SetLineWidth(2);
+            graph->SetLineStyle((direction == CutScan::Direction::Above) ? 1 : 2);
+            graphs[int(direction)] = graph;
+            
+            for (auto const &z: signif)
+                maxSignif = max(maxSignif, z);
+        }
+        
+        
+        // Draw a frame with the same range in x as in the main pad
+        string const frameTitle(";" + xAxisTitle + ((cutScanAsimov) ? ";Z_{A}" : ";S/#sqrt{B}"));
+        
+        cutScanPad->cd();
+        TH1 *frame = cutScanPad->DrawFrame(cuts.front(), 0., cuts.back(),
+         (maxSignif > 0.) ? 1.2 * maxSignif : 1., frameTitle.c_str());
+        
+        PlotStyle::MatchLowerAxes(*frame, *mcStack->GetXaxis(), *mainPad, *cutScanPad,
+         (1. - 2. * margin - bottomSpacing) / cutScanSpacing);
+        
+        if (plotResiduals)
+            frame->GetXaxis()->SetLabelOffset(999.);
+        
+        for (auto const &graph: graphs)
+            graph->Draw("l");
+        
+        mcStack->GetXaxis()->SetLabelOffset(999.);
+    }
 }
 
 
@@ -349,10 +1076,7 @@ void DataMCPlot::AddCMSLabel(string const &additionalText /*= ""*/)
     label << "#scale[1.2]{#font[62]{CMS}} #font[52]{" << additionalText << "}";
     
     TLatex *cmsLabel = NewOwnedObject<TLatex>(0.16, 0.91, label.str().c_str());
-    cmsLabel->SetNDC();
-    cmsLabel->SetTextFont(42);
-    cmsLabel->SetTextSize(0.04);
-    cmsLabel->SetTextAlign(11);
+    PlotStyle::ConfigureLabel(*cmsLabel, 11);
     
     canvas->cd();
     cmsLabel->Draw();
@@ -366,10 +1090,7 @@ void DataMCPlot::AddEnergyLabel(string const &text)
     
     
     TLatex *energyLabel = NewOwnedObject<TLatex>(0.85, 0.91, text.c_str());
-    energyLabel->SetNDC();
-    energyLabel->SetTextFont(42);
-    energyLabel->SetTextSize(0.04);
-    energyLabel->SetTextAlign(31);
+    PlotStyle::ConfigureLabel(*energyLabel, 31);
     
     canvas->cd();
     energyLabel->Draw();
@@ -490,18 +1211,9 @@ void DataMCPlot::ReadFile(std::string const &srcFileName, std::string const &dir
     }
     
     
-    // Create a histogram with total MC expectation
-    auto histIt = mcHists.cbegin();
-    mcTotalHist.reset(dynamic_cast<TH1 *>((*histIt)->Clone("mcTotalHist")));
-    
-    for (++histIt; histIt != mcHists.cend(); ++histIt)
-        mcTotalHist->Add(histIt->get());
-    
-    
     // Remove association of histograms with the source file so that the histogram are not deleted
     //when the file is closed
     dataHist->SetDirectory(nullptr);
-    mcTotalHist->SetDirectory(nullptr);
     
     for (auto &h: mcHists)
         h->SetDirectory(nullptr);
@@ -511,6 +1223,194 @@ void DataMCPlot::ReadFile(std::string const &srcFileName, std::string const &dir
     unique_ptr<TH1> systUp(dynamic_cast<TH1 *>(curDirectory->Get("syst_up")));
     unique_ptr<TH1> systDown(dynamic_cast<TH1 *>(curDirectory->Get("syst_down")));
     
+    BuildTotalAndSystematics(systUp.get(), systDown.get());
+}
+
+
+void DataMCPlot::ReadContent(PlotContent const &content)
+{
+    content.Validate("the provided plot content");
+    title = content.title;
+    
+    
+    // Create histograms. The data histogram is drawn with markers, and MC histograms are filled
+    dataHist.reset(CreateHist(content, content.data));
+    dataHist->SetMarkerStyle(20);
+    
+    unsigned iProcess = 0;
+    
+    for (auto const &p: content.processes)
+    {
+        TH1 *h = CreateHist(content, p);
+        h->SetFillColor((p.colour >= 0) ? p.colour :
+         defaultColours[iProcess % (sizeof(defaultColours) / sizeof(defaultColours[0]))]);
+        mcHists.emplace_back(h);
+        ++iProcess;
+    }
+    
+    
+    // Build the total expectation and the band with systematical uncertainties
+    unique_ptr<TH1> systUp, systDown;
+    
+    if (content.HasSystematics())
+    {
+        systUp.reset(CreateHist(content, content.systUp));
+        systDown.reset(CreateHist(content, content.systDown));
+    }
+    
+    BuildTotalAndSystematics(systUp.get(), systDown.get());
+}
+
+
+void DataMCPlot::FindYRange(double &yMax, double &yMinPositive) const
+{
+    yMax = 0.;
+    yMinPositive = numeric_limits<double>::infinity();
+    
+    auto update = [&](double low, double high)
+    {
+        yMax = max(yMax, high);
+        
+        if (low > 0.)
+            yMinPositive = min(yMinPositive, low);
+        else if (high > 0.)
+            yMinPositive = min(yMinPositive, high);
+    };
+    
+    
+    // All bins are visited once. In each bin, the stack is accumulated from the bottom layer, which
+    //is the last histogram since the stack is filled in the reversed order. Thus every partial sum
+    //is a boundary between drawn layers
+    int const numBins = mcTotalHist->GetNbinsX();
+    bool const useBand = (drawSystematics and systError and systError->GetN() == numBins);
+    
+    for (int bin = 1; bin <= numBins; ++bin)
+    {
+        double stacked = 0.;
+        
+        for (auto h = mcHists.crbegin(); h != mcHists.crend(); ++h)
+        {
+            stacked += (*h)->GetBinContent(bin);
+            update(stacked, stacked);
+        }
+        
+        double const total = mcTotalHist->GetBinContent(bin);
+        
+        for (auto const &o: overlays)
+        {
+            double const y = o.first->GetBinContent(bin) + ((o.second) ? total : 0.);
+            update(y, y);
+        }
+        
+        if (dataHist and not blinding.IsMasked(bin))
+        {
+            double const y = dataHist->GetBinContent(bin), err = dataHist->GetBinError(bin);
+            update((y - err > 0.) ? y - err : y, y + err);
+        }
+        
+        if (useBand)
+        {
+            double const y = systError->GetY()[bin - 1];
+            update(y - systError->GetErrorYlow(bin - 1), y + systError->GetErrorYhigh(bin - 1));
+        }
+    }
+}
+
+
+double DataMCPlot::GetBottomSpacing() const
+{
+    return ((plotResiduals) ? PlotStyle::lowerPadHeight : 0.) +
+     ((drawCutScan) ? PlotStyle::lowerPadHeight : 0.);
+}
+
+
+void DataMCPlot::PrepareBlinding()
+{
+    unsigned const numBins = dataHist->GetNbinsX();
+    
+    if (blinding.GetNumBins() == numBins)
+        return;
+    
+    if (blinding.IsActive())
+    {
+        ostringstream ost;
+        ost << "Mask for " << blinding.GetNumBins() << " bins cannot be applied to a plot with " <<
+         numBins << " bins.";
+        throw runtime_error(ost.str());
+    }
+    
+    blinding = BinMask(numBins);
+}
+
+
+void DataMCPlot::RecentreSystematics()
+{
+    if (not systError)
+        return;
+    
+    for (int i = 0; i < systError->GetN(); ++i)
+    {
+        double x, y;
+        systError->GetPoint(i, x, y);
+        
+        double const errHigh = systError->GetErrorYhigh(i);
+        double const errLow = systError->GetErrorYlow(i);
+        systError->SetPoint(i, x, mcTotalHist->GetBinContent(i + 1));
+        systError->SetPointEYhigh(i, errHigh);
+        systError->SetPointEYlow(i, errLow);
+    }
+}
+
+
+void DataMCPlot::BuildTotal()
+{
+    // The total is summed with compensation so that it is nearly independent of the order of
+    //processes even if their contents differ by many orders of magnitude. The first histogram is
+    //cloned to reproduce the binning and the type
+    mcTotalHist.reset(dynamic_cast<TH1 *>(mcHists.front()->Clone("mcTotalHist")));
+    mcTotalHist->SetDirectory(nullptr);
+    
+    int const numBins = mcTotalHist->GetNbinsX();
+    vector<vector<double>> contents, sumw2;
+    vector<ArrayView<double>> contentViews, sumw2Views;
+    
+    for (auto const &h: mcHists)
+    {
+        contents.emplace_back(numBins + 2);
+        sumw2.emplace_back(numBins + 2);
+        
+        for (int bin = 0; bin <= numBins + 1; ++bin)
+        {
+            contents.back()[bin] = h->GetBinContent(bin);
+            sumw2.back()[bin] = pow(h->GetBinError(bin), 2);
+        }
+    }
+    
+    for (unsigned i = 0; i < contents.size(); ++i)
+    {
+        contentViews.emplace_back(contents[i].data(), contents[i].size());
+        sumw2Views.emplace_back(sumw2[i].data(), sumw2[i].size());
+    }
+    
+    vector<double> totalContents, totalSumw2;
+    Summation::SumArrays(contentViews, totalContents);
+    Summation::SumArrays(sumw2Views, totalSumw2);
+    
+    for (int bin = 0; bin <= numBins + 1; ++bin)
+    {
+        mcTotalHist->SetBinContent(bin, totalContents[bin]);
+        mcTotalHist->SetBinError(bin, sqrt(totalSumw2[bin]));
+    }
+}
+
+
+void DataMCPlot::BuildTotalAndSystematics(TH1 const *systUp, TH1 const *systDown)
+{
+    // Create a histogram with total MC expectation
+    BuildTotal();
+    
+    
+    // Create the band with systematical uncertainties if the variations are provided
     if (systUp and systDown)
     {
         systError.reset(new TGraphAsymmErrors(mcTotalHist.get()));
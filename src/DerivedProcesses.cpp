@@ -0,0 +1,723 @@
+#include <DerivedProcesses.hpp>
+
+#include <fnmatch.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+
+using namespace std;
+
+
+unsigned const DerivedProcesses::blockSize = 256;
+
+
+DerivedProcesses::DerivedProcesses():
+    reader(nullptr)
+{}
+
+
+DerivedProcesses::DerivedProcesses(PlotReader const &reader_):
+    reader(&reader_)
+{}
+
+
+void DerivedProcesses::Apply(PlotContent &content, string const &dirName /*= ""*/)
+{
+    unsigned const numBins = content.GetNumBins() + 2;
+    string const baseName = dirName.substr(dirName.find_last_of('/') + 1);
+    
+    
+    // Resolve the leaves into lists of input histograms. A histogram referenced by several leaves
+    //is included only once so that the propagation of uncertainties accounts for the correlation
+    vector<pair<ArrayView<double>, ArrayView<double>>> inputs;
+    map<pair<string, string>, unsigned> inputIndices;
+    vector<vector<unsigned>> leafInputs(leaves.size());
+    
+    for (unsigned l = 0; l < leaves.size(); ++l)
+    {
+        Leaf const &leaf = leaves[l];
+        string resolvedDir(leaf.dirName);
+        
+        for (auto const &placeholder: {make_pair(string("$dir"), dirName),
+         make_pair(string("$base"), baseName)})
+        {
+            size_t pos;
+            
+            while ((pos = resolvedDir.find(placeholder.first)) != string::npos)
+                resolvedDir.replace(pos, placeholder.first.size(), placeholder.second);
+        }
+        
+        if (resolvedDir == dirName)
+            resolvedDir.clear();
+        
+        PlotContent const &source = (resolvedDir.empty()) ? content : GetExternal(resolvedDir);
+        vector<PlotContent::Hist const *> hists;
+        
+        if (leaf.kind == LeafKind::Hist)
+        {
+            PlotContent::Hist const *h = source.FindHist(leaf.name);
+            
+            if (not h)
+            {
+                ostringstream ost;
+                ost << "Histogram \"" << leaf.name << "\" referenced by a derived process is " <<
+                 "not found in directory \"" << ((resolvedDir.empty()) ? dirName : resolvedDir) <<
+                 "\".";
+                throw runtime_error(ost.str());
+            }
+            
+            hists.push_back(h);
+        }
+        else
+        {
+            for (auto const &p: source.processes)
+            {
+                bool const match = (fnmatch(leaf.name.c_str(), p.name.c_str(), 0) == 0);
+                
+                if (match == (leaf.kind == LeafKind::Sum))
+                    hists.push_back(&p);
+            }
+        }
+        
+        for (auto const &h: hists)
+        {
+            if (h->contents.GetSize() != numBins)
+            {
+                ostringstream ost;
+                ost << "Binning of histogram \"" << h->name << "\" in directory \"" <<
+                 resolvedDir << "\" does not match the plot in directory \"" << dirName << "\".";
+                throw runtime_error(ost.str());
+            }
+            
+            auto const res = inputIndices.insert({{resolvedDir, h->name}, unsigned(inputs.size())});
+            
+            if (res.second)
+            {
+                // If sums of squared weights are not given, the contents are Poisson counts
+                inputs.emplace_back(h->contents,
+                 (h->sumw2.IsEmpty()) ? h->contents : h->sumw2);
+            }
+            
+            leafInputs[l].push_back(res.first->second);
+        }
+    }
+    
+    
+    // Find nodes that contribute to each definition, in decreasing order of their indices, and
+    //the inputs that they read. Since operands precede nodes that use them, a single backward pass
+    //from the node of the definition is enough, and the order of the list is suitable for the
+    //propagation of derivatives. The forward pass evaluates the union of these nodes
+    vector<bool> live(nodes.size(), false);
+    vector<vector<unsigned>> defNodes(definitions.size()), defInputs(definitions.size());
+    vector<bool> reached(nodes.size()), inputReached(inputs.size());
+    
+    for (unsigned d = 0; d < definitions.size(); ++d)
+    {
+        unsigned const root = definitions[d].node;
+        fill(reached.begin(), reached.begin() + root + 1, false);
+        fill(inputReached.begin(), inputReached.end(), false);
+        reached[root] = true;
+        
+        for (unsigned i = root + 1; i-- > 0;)
+        {
+            if (not reached[i])
+                continue;
+            
+            defNodes[d].push_back(i);
+            live[i] = true;
+            Node const &node = nodes[i];
+            
+            if (node.first >= 0)
+                reached[node.first] = true;
+            
+            if (node.second >= 0)
+                reached[node.second] = true;
+            
+            if (node.op == Op::Leaf)
+            {
+                for (unsigned const input: leafInputs[node.leaf])
+                {
+                    if (not inputReached[input])
+                    {
+                        inputReached[input] = true;
+                        defInputs[d].push_back(input);
+                    }
+                }
+            }
+        }
+    }
+    
+    
+    // Evaluate all definitions for one block of bins at a time. Values and derivatives of all nodes
+    //for a block are kept in small buffers, so that no full-size intermediate histograms are
+    //created
+    vector<vector<double>> results(definitions.size(), vector<double>(numBins));
+    vector<vector<double>> variances(definitions.size(), vector<double>(numBins));
+    vector<double> values(nodes.size() * blockSize), grads(nodes.size() * blockSize);
+    vector<double> inputGrads(inputs.size() * blockSize);
+    
+    for (unsigned start = 0; start < numBins; start += blockSize)
+    {
+        unsigned const n = min(blockSize, numBins - start);
+        
+        for (unsigned i = 0; i < nodes.size(); ++i)
+        {
+            if (not live[i])
+                continue;
+            
+            Node const &node = nodes[i];
+            double *const v = values.data() + size_t(i) * blockSize;
+            double const *const a = values.data() + size_t(max(node.first, 0)) * blockSize;
+            double const *const b = values.data() + size_t(max(node.second, 0)) * blockSize;
+            
+            switch (node.op)
+            {
+                case Op::Constant:
+                    fill(v, v + n, node.value);
+                    break;
+                
+                case Op::Leaf:
+                    fill(v, v + n, 0.);
+                    
+                    for (unsigned const input: leafInputs[node.leaf])
+                    {
+                        double const *const c = inputs[input].first.GetData() + start;
+                        
+                        for (unsigned k = 0; k < n; ++k)
+                            v[k] += c[k];
+                    }
+                    
+                    break;
+                
+                case Op::Add:
+                    for (unsigned k = 0; k < n; ++k)
+                        v[k] = a[k] + b[k];
+                    break;
+                
+                case Op::Subtract:
+                    for (unsigned k = 0; k < n; ++k)
+                        v[k] = a[k] - b[k];
+                    break;
+                
+                case Op::Multiply:
+                    for (unsigned k = 0; k < n; ++k)
+                        v[k] = a[k] * b[k];
+                    break;
+                
+                case Op::Divide:
+                    for (unsigned k = 0; k < n; ++k)
+                        v[k] = (b[k] == 0.) ? 0. : a[k] / b[k];
+                    break;
+                
+                case Op::Negate:
+                    for (unsigned k = 0; k < n; ++k)
+                        v[k] = -a[k];
+                    break;
+                
+                case Op::Min:
+                    for (unsigned k = 0; k < n; ++k)
+                        v[k] = min(a[k], b[k]);
+                    break;
+                
+                case Op::Max:
+                    for (unsigned k = 0; k < n; ++k)
+                        v[k] = max(a[k], b[k]);
+                    break;
+            }
+        }
+        
+        
+        // For each definition, propagate derivatives from its node back to the input histograms
+        for (unsigned d = 0; d < definitions.size(); ++d)
+        {
+            unsigned const root = definitions[d].node;
+            copy(values.begin() + size_t(root) * blockSize,
+             values.begin() + size_t(root) * blockSize + n, results[d].begin() + start);
+            
+            // Only buffers of the nodes and inputs reached from this definition are touched
+            for (unsigned const i: defNodes[d])
+                fill(grads.begin() + size_t(i) * blockSize,
+                 grads.begin() + size_t(i) * blockSize + n, (i == root) ? 1. : 0.);
+            
+            for (unsigned const input: defInputs[d])
+                fill(inputGrads.begin() + size_t(input) * blockSize,
+                 inputGrads.begin() + size_t(input) * blockSize + n, 0.);
+            
+            for (unsigned const i: defNodes[d])
+            {
+                Node const &node = nodes[i];
+                double const *const g = grads.data() + size_t(i) * blockSize;
+                double const *const a = values.data() + size_t(max(node.first, 0)) * blockSize;
+                double const *const b = values.data() + size_t(max(node.second, 0)) * blockSize;
+                double *const ga = grads.data() + size_t(max(node.first, 0)) * blockSize;
+                double *const gb = grads.data() + size_t(max(node.second, 0)) * blockSize;
+                
+                switch (node.op)
+                {
+                    case Op::Constant:
+                        break;
+                    
+                    case Op::Leaf:
+                        for (unsigned const input: leafInputs[node.leaf])
+                        {
+                            double *const gi = inputGrads.data() + size_t(input) * blockSize;
+                            
+                            for (unsigned k = 0; k < n; ++k)
+                                gi[k] += g[k];
+                        }
+                        
+                        break;
+                    
+                    case Op::Add:
+                        for (unsigned k = 0; k < n; ++k)
+                        {
+                            ga[k] += g[k];
+                            gb[k] += g[k];
+                        }
+                        
+                        break;
+                    
+                    case Op::Subtract:
+                        for (unsigned k = 0; k < n; ++k)
+                        {
+                            ga[k] += g[k];
+                            gb[k] -= g[k];
+                        }
+                        
+                        break;
+                    
+                    case Op::Multiply:
+                        for (unsigned k = 0; k < n; ++k)
+                        {
+                            ga[k] += g[k] * b[k];
+                            gb[k] += g[k] * a[k];
+                        }
+                        
+                        break;
+                    
+                    case Op::Divide:
+                        for (unsigned k = 0; k < n; ++k)
+                        {
+                            if (b[k] == 0.)
+                                continue;
+                            
+                            ga[k] += g[k] / b[k];
+                            gb[k] -= g[k] * a[k] / (b[k] * b[k]);
+                        }
+                        
+                        break;
+                    
+                    case Op::Negate:
+                        for (unsigned k = 0; k < n; ++k)
+                            ga[k] -= g[k];
+                        break;
+                    
+                    case Op::Min:
+                    case Op::Max:
+                        for (unsigned k = 0; k < n; ++k)
+                        {
+                            bool const takeFirst = (node.op == Op::Min) ? (a[k] <= b[k]) :
+                             (a[k] >= b[k]);
+                            ((takeFirst) ? ga : gb)[k] += g[k];
+                        }
+                        
+                        break;
+                }
+            }
+            
+            for (unsigned const input: defInputs[d])
+            {
+                double const *const gi = inputGrads.data() + size_t(input) * blockSize;
+                double const *const var = inputs[input].second.GetData() + start;
+                
+                for (unsigned k = 0; k < n; ++k)
+                    variances[d][start + k] += gi[k] * gi[k] * var[k];
+            }
+        }
+    }
+    
+    
+    // Put the derived processes into the plot
+    for (unsigned d = 0; d < definitions.size(); ++d)
+    {
+        Definition const &def = definitions[d];
+        auto res = find_if(content.processes.begin(), content.processes.end(),
+         [&def](PlotContent::Hist const &h){return h.name == def.name;});
+        
+        if (res == content.processes.end())
+        {
+            content.processes.emplace_back();
+            res = content.processes.end() - 1;
+            res->name = res->title = def.name;
+        }
+        
+        res->contents = content.Adopt(move(results[d]));
+        res->sumw2 = content.Adopt(move(variances[d]));
+        
+        if (not def.title.empty())
+            res->title = def.title;
+        
+        if (def.colour >= 0)
+            res->colour = def.colour;
+    }
+}
+
+
+void DerivedProcesses::ClearCache()
+{
+    externals.clear();
+}
+
+
+void DerivedProcesses::Define(string const &name, string const &expression,
+ string const &title /*= ""*/, int colour /*= -1*/)
+{
+    for (auto const &d: definitions)
+    {
+        if (d.name == name)
+        {
+            ostringstream ost;
+            ost << "Derived process \"" << name << "\" is defined more than once.";
+            throw runtime_error(ost.str());
+        }
+    }
+    
+    size_t pos = 0;
+    unsigned const node = ParseExpression(expression, pos);
+    
+    while (pos < expression.size() and isspace(static_cast<unsigned char>(expression[pos])))
+        ++pos;
+    
+    if (pos != expression.size())
+        throw ParseError(expression, pos, "unexpected character");
+    
+    Definition def;
+    def.name = name;
+    def.title = title;
+    def.colour = colour;
+    def.node = node;
+    definitions.emplace_back(def);
+}
+
+
+unsigned DerivedProcesses::GetNumNodes() const
+{
+    return nodes.size();
+}
+
+
+unsigned DerivedProcesses::AddNode(Op op, int first /*= -1*/, int second /*= -1*/,
+ double value /*= 0.*/, unsigned leaf /*= 0*/)
+{
+    // Fold operations on constants
+    bool const firstConst = (first >= 0 and nodes[first].op == Op::Constant);
+    bool const secondConst = (second >= 0 and nodes[second].op == Op::Constant);
+    
+    if (firstConst and (second < 0 or secondConst))
+    {
+        double const a = nodes[first].value, b = (second >= 0) ? nodes[second].value : 0.;
+        double result = 0.;
+        
+        switch (op)
+        {
+            case Op::Add:
+                result = a + b;
+                break;
+            
+            case Op::Subtract:
+                result = a - b;
+                break;
+            
+            case Op::Multiply:
+                result = a * b;
+                break;
+            
+            case Op::Divide:
+                result = (b == 0.) ? 0. : a / b;
+                break;
+            
+            case Op::Negate:
+                result = -a;
+                break;
+            
+            case Op::Min:
+                result = min(a, b);
+                break;
+            
+            case Op::Max:
+                result = max(a, b);
+                break;
+            
+            default:
+                break;
+        }
+        
+        return AddNode(Op::Constant, -1, -1, result);
+    }
+    
+    
+    // Reuse an identical node if it exists. Constants are compared by their bit patterns
+    uint64_t valueBits;
+    memcpy(&valueBits, &value, sizeof(valueBits));
+    auto const res = nodeIndices.insert({make_tuple(int(op), first, second, valueBits, leaf),
+     unsigned(nodes.size())});
+    
+    if (res.second)
+    {
+        Node node;
+        node.op = op;
+        node.first = first;
+        node.second = second;
+        node.value = value;
+        node.leaf = leaf;
+        nodes.emplace_back(node);
+    }
+    
+    return res.first->second;
+}
+
+
+unsigned DerivedProcesses::AddLeaf(LeafKind kind, string const &reference)
+{
+    Leaf leaf;
+    leaf.kind = kind;
+    size_t const slash = reference.find_last_of('/');
+    
+    if (slash == string::npos)
+        leaf.name = reference;
+    else
+    {
+        leaf.dirName = reference.substr(0, slash);
+        leaf.name = reference.substr(slash + 1);
+    }
+    
+    auto const res = find_if(leaves.begin(), leaves.end(), [&leaf](Leaf const &l)
+    {
+        return (l.kind == leaf.kind and l.dirName == leaf.dirName and l.name == leaf.name);
+    });
+    unsigned const index = res - leaves.begin();
+    
+    if (res == leaves.end())
+        leaves.emplace_back(leaf);
+    
+    return AddNode(Op::Leaf, -1, -1, 0., index);
+}
+
+
+PlotContent const &DerivedProcesses::GetExternal(string const &dirName)
+{
+    auto const res = externals.find(dirName);
+    
+    if (res != externals.end())
+        return res->second;
+    
+    if (not reader)
+    {
+        ostringstream ost;
+        ost << "Directory \"" << dirName << "\" referenced by a derived process cannot be read " <<
+         "since no reader has been provided.";
+        throw runtime_error(ost.str());
+    }
+    
+    return externals.emplace(dirName, reader->Read(dirName)).first->second;
+}
+
+
+unsigned DerivedProcesses::ParseExpression(string const &text, size_t &pos)
+{
+    unsigned node = ParseTerm(text, pos);
+    
+    while (true)
+    {
+        while (pos < text.size() and isspace(static_cast<unsigned char>(text[pos])))
+            ++pos;
+        
+        if (pos == text.size() or (text[pos] != '+' and text[pos] != '-'))
+            return node;
+        
+        Op const op = (text[pos] == '+') ? Op::Add : Op::Subtract;
+        ++pos;
+        node = AddNode(op, node, ParseTerm(text, pos));
+    }
+}
+
+
+unsigned DerivedProcesses::ParseTerm(string const &text, size_t &pos)
+{
+    unsigned node = ParseUnary(text, pos);
+    
+    while (true)
+    {
+        while (pos < text.size() and isspace(static_cast<unsigned char>(text[pos])))
+            ++pos;
+        
+        if (pos == text.size() or (text[pos] != '*' and text[pos] != '/'))
+            return node;
+        
+        Op const op = (text[pos] == '*') ? Op::Multiply : Op::Divide;
+        ++pos;
+        node = AddNode(op, node, ParseUnary(text, pos));
+    }
+}
+
+
+unsigned DerivedProcesses::ParseUnary(string const &text, size_t &pos)
+{
+    while (pos < text.size() and isspace(static_cast<unsigned char>(text[pos])))
+        ++pos;
+    
+    if (pos < text.size() and text[pos] == '-')
+    {
+        ++pos;
+        return AddNode(Op::Negate, ParseUnary(text, pos));
+    }
+    
+    if (pos < text.size() and text[pos] == '+')
+    {
+        ++pos;
+        return ParseUnary(text, pos);
+    }
+    
+    return ParsePrimary(text, pos);
+}
+
+
+unsigned DerivedProcesses::ParsePrimary(string const &text, size_t &pos)
+{
+    if (pos == text.size())
+        throw ParseError(text, pos, "operand expected");
+    
+    char const c = text[pos];
+    
+    
+    // Number
+    if (isdigit(static_cast<unsigned char>(c)) or c == '.')
+    {
+        char *end;
+        double const value = strtod(text.c_str() + pos, &end);
+        
+        if (end == text.c_str() + pos)
+            throw ParseError(text, pos, "invalid number");
+        
+        pos = end - text.c_str();
+        return AddNode(Op::Constant, -1, -1, value);
+    }
+    
+    
+    // Expression in parentheses
+    if (c == '(')
+    {
+        ++pos;
+        unsigned const node = ParseExpression(text, pos);
+        
+        while (pos < text.size() and isspace(static_cast<unsigned char>(text[pos])))
+            ++pos;
+        
+        if (pos == text.size() or text[pos] != ')')
+            throw ParseError(text, pos, "\")\" expected");
+        
+        ++pos;
+        return node;
+    }
+    
+    
+    // Reference to a histogram in braces
+    if (c == '{')
+        return AddLeaf(LeafKind::Hist, ParseReference(text, pos));
+    
+    
+    // An identifier is a function if it is followed by a parenthesis, and a name otherwise
+    size_t const identStart = pos;
+    string const ident(ParseReference(text, pos));
+    size_t next = pos;
+    
+    while (next < text.size() and isspace(static_cast<unsigned char>(text[next])))
+        ++next;
+    
+    if (next == text.size() or text[next] != '(')
+    {
+        for (auto const &d: definitions)
+        {
+            if (d.name == ident)
+                return d.node;
+        }
+        
+        return AddLeaf(LeafKind::Hist, ident);
+    }
+    
+    pos = next + 1;
+    unsigned node;
+    
+    if (ident == "sum" or ident == "sumexcept")
+    {
+        while (pos < text.size() and isspace(static_cast<unsigned char>(text[pos])))
+            ++pos;
+        
+        node = AddLeaf((ident == "sum") ? LeafKind::Sum : LeafKind::SumExcept,
+         ParseReference(text, pos));
+    }
+    else if (ident == "min" or ident == "max")
+    {
+        unsigned const first = ParseExpression(text, pos);
+        
+        while (pos < text.size() and isspace(static_cast<unsigned char>(text[pos])))
+            ++pos;
+        
+        if (pos == text.size() or text[pos] != ',')
+            throw ParseError(text, pos, "\",\" expected");
+        
+        ++pos;
+        node = AddNode((ident == "min") ? Op::Min : Op::Max, first, ParseExpression(text, pos));
+    }
+    else
+        throw ParseError(text, identStart, "unknown function \"" + ident + "\"");
+    
+    while (pos < text.size() and isspace(static_cast<unsigned char>(text[pos])))
+        ++pos;
+    
+    if (pos == text.size() or text[pos] != ')')
+        throw ParseError(text, pos, "\")\" expected");
+    
+    ++pos;
+    return node;
+}
+
+
+string DerivedProcesses::ParseReference(string const &text, size_t &pos)
+{
+    if (pos < text.size() and text[pos] == '{')
+    {
+        size_t const end = text.find('}', pos);
+        
+        if (end == string::npos)
+            throw ParseError(text, pos, "unterminated \"{\"");
+        
+        string const reference(text.substr(pos + 1, end - pos - 1));
+        pos = end + 1;
+        return reference;
+    }
+    
+    size_t const start = pos;
+    
+    while (pos < text.size() and
+     (isalnum(static_cast<unsigned char>(text[pos])) or text[pos] == '_' or text[pos] == '.'))
+        ++pos;
+    
+    if (pos == start or isdigit(static_cast<unsigned char>(text[start])))
+        throw ParseError(text, start, "name expected");
+    
+    return text.substr(start, pos - start);
+}
+
+
+runtime_error DerivedProcesses::ParseError(string const &text, size_t pos, string const &reason)
+{
+    ostringstream ost;
+    ost << "Failed to parse expression \"" << text << "\" at position " << pos << ": " << reason <<
+     ".";
+    return runtime_error(ost.str());
+}
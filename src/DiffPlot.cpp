@@ -0,0 +1,276 @@
+#include <DiffPlot.hpp>
+
+#include <CampaignDiff.hpp>
+#include <CanvasPool.hpp>
+#include <PlotStyle.hpp>
+#include <RootFileReader.hpp>
+#include <Summation.hpp>
+#include <TextLayoutCache.hpp>
+
+#include <TFile.h>
+#include <TH1.h>
+#include <TLegend.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/algorithm/string/replace.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+DiffPlot::DiffPlot(PlotContent const &ref, PlotContent const &target):
+    title(ref.title),
+    edges(ref.edges.begin(), ref.edges.end()),
+    refTotals(BuildTotals(ref)), targetTotals(BuildTotals(target)),
+    refLabel("Reference"), targetLabel("Target")
+{
+    if (target.GetNumBins() != ref.GetNumBins() or
+     not equal(edges.begin(), edges.end(), target.edges.begin()))
+    {
+        ostringstream ost;
+        ost << "Cannot overlay plots \"" << ref.title << "\" and \"" << target.title <<
+         "\" since they have different binning.";
+        throw runtime_error(ost.str());
+    }
+}
+
+
+DiffPlot::~DiffPlot()
+{
+    // Delete owned ROOT objects associated with the canvas in a reversed order with respect to
+    //creation
+    for (auto objIt = ownedObjects.rbegin(); objIt != ownedObjects.rend(); ++objIt)
+        delete *objIt;
+    
+    
+    // The canvas can now be reused by other figures
+    legend.reset();
+    CanvasPool::Release(canvas, mainPad);
+}
+
+
+TCanvas &DiffPlot::Draw()
+{
+    PlotStyle::SetGlobal();
+    
+    
+    // Setup layout of pads within the canvas following DataMCPlot
+    double const bottomSpacing = PlotStyle::lowerPadHeight;
+    double const margin = PlotStyle::margin;
+    double const mainPadWidth = PlotStyle::mainPadWidth;
+    
+    CanvasPool::Acquire(1500, 1000 / (1. - bottomSpacing), canvas, mainPad);
+    mainPad->SetPad(0., bottomSpacing, mainPadWidth + margin, 1.);
+    mainPad->SetTicks();
+    mainPad->SetLeftMargin(margin / mainPad->GetWNDC());
+    mainPad->SetRightMargin(margin / mainPad->GetWNDC());
+    mainPad->SetBottomMargin(margin / mainPad->GetHNDC());
+    mainPad->SetTopMargin(margin / mainPad->GetHNDC());
+    
+    canvas->cd();
+    mainPad->Draw();
+    
+    
+    // Histograms of the reference production are drawn as a filled area and open markers, and
+    //those of the target production as a line and filled markers
+    TH1D *refMC = BuildHist("refMC", refTotals.mc);
+    refMC->SetFillColor(kGray);
+    refMC->SetLineColor(kGray + 1);
+    
+    TH1D *targetMC = BuildHist("targetMC", targetTotals.mc);
+    targetMC->SetLineColor(kRed + 1);
+    targetMC->SetLineWidth(2);
+    
+    TH1D *refData = BuildHist("refData", refTotals.data);
+    refData->SetMarkerStyle(24);
+    
+    TH1D *targetData = BuildHist("targetData", targetTotals.data);
+    targetData->SetMarkerStyle(20);
+    targetData->SetMarkerColor(kRed + 1);
+    targetData->SetLineColor(kRed + 1);
+    
+    double yMax = 0.;
+    
+    for (TH1D const *h: {refMC, targetMC, refData, targetData})
+        yMax = max(yMax, h->GetMaximum());
+    
+    refMC->SetMinimum(0.);
+    refMC->SetMaximum(1.1 * yMax);
+    refMC->SetTitle(title.c_str());
+    
+    mainPad->cd();
+    refMC->Draw("hist");
+    targetMC->Draw("hist same");
+    refData->Draw("p0 e1 same");
+    targetData->Draw("p0 e1 same");
+    
+    
+    // Create and draw a legend
+    vector<string> const labels{refLabel + " MC", targetLabel + " MC", refLabel + " data",
+     targetLabel + " data"};
+    double const legendWidth = TextLayoutCache::GetLegendWidth(labels, 42, 0.03, *canvas);
+    legend.reset(new TLegend(min(0.86, 0.99 - legendWidth), 0.9 - 0.04 * 4, 0.99, 0.9));
+    legend->SetName("legend");
+    legend->SetFillColor(kWhite);
+    legend->SetTextFont(42);
+    legend->SetTextSize(0.03);
+    legend->SetBorderSize(0);
+    
+    legend->AddEntry(refMC, labels[0].c_str(), "f");
+    legend->AddEntry(targetMC, labels[1].c_str(), "l");
+    legend->AddEntry(refData, labels[2].c_str(), "p");
+    legend->AddEntry(targetData, labels[3].c_str(), "p");
+    
+    canvas->cd();
+    legend->Draw();
+    
+    
+    // Ratios target/reference. Bins with zero reference contents are left empty
+    TH1D *mcRatio = dynamic_cast<TH1D *>(targetMC->Clone("mcRatio"));
+    ownedObjects.emplace_back(mcRatio);
+    mcRatio->Divide(refMC);
+    
+    TH1D *dataRatio = dynamic_cast<TH1D *>(targetData->Clone("dataRatio"));
+    ownedObjects.emplace_back(dataRatio);
+    dataRatio->Divide(refData);
+    
+    double maxDeviation = 0.;
+    
+    for (TH1D const *h: {mcRatio, dataRatio})
+    {
+        for (int bin = 1; bin <= h->GetNbinsX(); ++bin)
+        {
+            if (h->GetBinContent(bin) != 0.)
+                maxDeviation = max(maxDeviation, fabs(h->GetBinContent(bin) - 1.));
+        }
+    }
+    
+    maxDeviation = max(1.2 * maxDeviation, 1e-3);
+    
+    
+    // Create a pad to draw the ratios
+    TPad *residualsPad = NewOwnedObject<TPad>("residualsPad", "", 0., 0., mainPadWidth + margin,
+     bottomSpacing + margin);
+    PlotStyle::ConfigureLowerPad(*residualsPad, true);
+    
+    canvas->cd();
+    residualsPad->Draw();
+    
+    
+    // Extract the label of the x axis of the main frame
+    auto const pos1 = title.find_first_of(';');
+    auto const pos2 = title.find_first_of(';', pos1 + 1);
+    string const xAxisTitle((pos1 == string::npos) ? "" :
+     title.substr(pos1 + 1, pos2 - pos1 - 1));
+    
+    residualsPad->cd();
+    TH1 *ratioFrame = residualsPad->DrawFrame(edges.front(), 1. - maxDeviation, edges.back(),
+     1. + maxDeviation, (";" + xAxisTitle + ";" + targetLabel + "/" + refLabel).c_str());
+    PlotStyle::MatchLowerAxes(*ratioFrame, *refMC->GetXaxis(), *mainPad, *residualsPad,
+     (1. - 2. * margin - bottomSpacing) / bottomSpacing);
+    ratioFrame->GetYaxis()->SetLabelOffset(refMC->GetYaxis()->GetLabelOffset());
+    
+    mcRatio->Draw("hist same");
+    dataRatio->Draw("p0 same");
+    
+    
+    // Remove the labels from x axis of the main frame
+    refMC->GetXaxis()->SetLabelOffset(999.);
+    
+    
+    return *canvas;
+}
+
+
+void DiffPlot::Print(string const &fileName)
+{
+    if (not canvas)
+        Draw();
+    
+    
+    // If the output is not a ROOT file, simply call TCanvas::Print
+    if (not boost::ends_with(fileName, ".root"))
+    {
+        canvas->Print(fileName.c_str());
+        return;
+    }
+    
+    
+    TFile outFile(fileName.c_str(), "recreate");
+    outFile.cd();
+    canvas->Write();
+    legend->Write();
+    outFile.Close();
+}
+
+
+unsigned DiffPlot::PrintChanged(CampaignDiff const &diff, string const &outDirectory,
+ string const &extension /*= "pdf"*/, unsigned maxPlots /*= 0*/)
+{
+    RootFileReader const refReader(diff.GetRefFileName());
+    RootFileReader const targetReader(diff.GetTargetFileName());
+    unsigned numPlots = 0;
+    
+    for (auto const &entry: diff.GetEntries())
+    {
+        if (maxPlots > 0 and numPlots == maxPlots)
+            break;
+        
+        if (entry.status != CampaignDiff::Status::Changed)
+            continue;
+        
+        DiffPlot plot(refReader.Read(entry.dirName), targetReader.Read(entry.dirName));
+        string const name((entry.dirName.empty()) ? "top" :
+         boost::replace_all_copy(entry.dirName, "/", "_"));
+        plot.Print(outDirectory + "/" + name + "." + extension);
+        ++numPlots;
+    }
+    
+    return numPlots;
+}
+
+
+void DiffPlot::SetLabels(string const &refLabel_, string const &targetLabel_)
+{
+    refLabel = refLabel_;
+    targetLabel = targetLabel_;
+}
+
+
+DiffPlot::Totals DiffPlot::BuildTotals(PlotContent const &content)
+{
+    Totals totals;
+    unsigned const numBins = content.GetNumBins();
+    
+    vector<ArrayView<double>> views;
+    
+    for (auto const &p: content.processes)
+        views.emplace_back(p.contents.Slice(1, numBins));
+    
+    if (views.empty())
+        totals.mc.assign(numBins, 0.);
+    else
+        Summation::SumArrays(views, totals.mc);
+    
+    totals.data.assign(content.data.contents.begin() + 1,
+     content.data.contents.begin() + 1 + numBins);
+    
+    return totals;
+}
+
+
+TH1D *DiffPlot::BuildHist(string const &name, vector<double> const &contents)
+{
+    TH1D *hist = NewOwnedObject<TH1D>(name.c_str(), "", int(edges.size() - 1), edges.data());
+    hist->SetDirectory(nullptr);
+    
+    for (unsigned i = 0; i < contents.size(); ++i)
+        hist->SetBinContent(i + 1, contents[i]);
+    
+    return hist;
+}
@@ -0,0 +1,349 @@
+#include <EfficiencyPlot.hpp>
+
+#include <CanvasPool.hpp>
+#include <PlotStyle.hpp>
+#include <TextLayoutCache.hpp>
+
+#include <TFile.h>
+#include <TGraphAsymmErrors.h>
+#include <TH1.h>
+#include <TLatex.h>
+#include <TLegend.h>
+#include <TObjString.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+EfficiencyPlot::EfficiencyPlot(string const &srcFileName, string const &dirName /*= ""*/):
+    plotResiduals(true), residualsRange(0.8, 1.2),
+    dataLabel("Data"), mcLabel("Simulation")
+{
+    ReadFile(srcFileName, dirName);
+}
+
+
+EfficiencyPlot::~EfficiencyPlot()
+{
+    // Delete owned ROOT objects associated with the canvas in a reversed order with respect to
+    //creation
+    for (auto objIt = ownedObjects.rbegin(); objIt != ownedObjects.rend(); ++objIt)
+        delete *objIt;
+    
+    
+    // The canvas can now be reused by other figures
+    legend.reset();
+    CanvasPool::Release(canvas, mainPad);
+}
+
+
+void EfficiencyPlot::AddCMSLabel(string const &additionalText /*= ""*/)
+{
+    if (not canvas)
+        throw logic_error("Cannot add CMS label before the figure is drawn.");
+    
+    
+    ostringstream label;
+    label << "#scale[1.2]{#font[62]{CMS}} #font[52]{" << additionalText << "}";
+    
+    TLatex *cmsLabel = NewOwnedObject<TLatex>(0.16, 0.91, label.str().c_str());
+    PlotStyle::ConfigureLabel(*cmsLabel, 11);
+    
+    canvas->cd();
+    cmsLabel->Draw();
+}
+
+
+void EfficiencyPlot::AddEnergyLabel(string const &text)
+{
+    if (not canvas)
+        throw logic_error("Cannot add energy label before the figure is drawn.");
+    
+    
+    TLatex *energyLabel = NewOwnedObject<TLatex>(0.85, 0.91, text.c_str());
+    PlotStyle::ConfigureLabel(*energyLabel, 31);
+    
+    canvas->cd();
+    energyLabel->Draw();
+}
+
+
+TCanvas &EfficiencyPlot::Draw()
+{
+    PlotStyle::SetGlobal();
+    
+    
+    // Setup layout of pads within the canvas following DataMCPlot
+    double const bottomSpacing = (plotResiduals) ? PlotStyle::lowerPadHeight : 0.;
+    double const margin = PlotStyle::margin;
+    double const mainPadWidth = PlotStyle::mainPadWidth;
+    
+    CanvasPool::Acquire(1500, 1000 / (1. - bottomSpacing), canvas, mainPad);
+    mainPad->SetPad(0., bottomSpacing, mainPadWidth + margin, 1.);
+    mainPad->SetTicks();
+    mainPad->SetLeftMargin(margin / mainPad->GetWNDC());
+    mainPad->SetRightMargin(margin / mainPad->GetWNDC());
+    mainPad->SetBottomMargin(margin / mainPad->GetHNDC());
+    mainPad->SetTopMargin(margin / mainPad->GetHNDC());
+    
+    canvas->cd();
+    mainPad->Draw();
+    
+    
+    // Compute efficiencies for data and MC. The MC is drawn as a band, data as points
+    TGraphAsymmErrors *dataGraph = BuildGraph(dataCounts, false);
+    dataGraph->SetName("dataEff");
+    dataGraph->SetMarkerStyle(20);
+    
+    TGraphAsymmErrors *mcGraph = BuildGraph(mcCounts, true);
+    mcGraph->SetName("mcEff");
+    mcGraph->SetFillColor(kAzure + 1);
+    mcGraph->SetLineColor(kAzure + 1);
+    
+    mainPad->cd();
+    TH1 *frame = mainPad->DrawFrame(edges.front(), 0., edges.back(), 1.1, title.c_str());
+    mcGraph->Draw("2");
+    dataGraph->Draw("p");
+    
+    
+    // Create and draw a legend
+    double const legendWidth = TextLayoutCache::GetLegendWidth({dataLabel, mcLabel}, 42, 0.03,
+     *canvas);
+    legend.reset(new TLegend(min(0.86, 0.99 - legendWidth), 0.9 - 0.04 * 2, 0.99, 0.9));
+    legend->SetName("legend");
+    legend->SetFillColor(kWhite);
+    legend->SetTextFont(42);
+    legend->SetTextSize(0.03);
+    legend->SetBorderSize(0);
+    
+    legend->AddEntry(dataGraph, dataLabel.c_str(), "p");
+    legend->AddEntry(mcGraph, mcLabel.c_str(), "f");
+    
+    canvas->cd();
+    legend->Draw();
+    
+    
+    // Plot the data/MC ratio if needed
+    if (plotResiduals)
+    {
+        // Uncertainties of data and MC are added in quadrature. Bins with zero efficiency in MC
+        //are skipped
+        TGraphAsymmErrors *ratioGraph = NewOwnedObject<TGraphAsymmErrors>();
+        ratioGraph->SetName("ratio");
+        
+        for (int i = 0; i < dataGraph->GetN(); ++i)
+        {
+            double x, effData, effMC;
+            dataGraph->GetPoint(i, x, effData);
+            mcGraph->GetPoint(i, x, effMC);
+            
+            if (effMC <= 0. or dataCounts.total[i] <= 0.)
+                continue;
+            
+            double const ratio = effData / effMC;
+            int const n = ratioGraph->GetN();
+            ratioGraph->SetPoint(n, x, ratio);
+            ratioGraph->SetPointEYhigh(n, hypot(dataGraph->GetErrorYhigh(i),
+             ratio * mcGraph->GetErrorYlow(i)) / effMC);
+            ratioGraph->SetPointEYlow(n, hypot(dataGraph->GetErrorYlow(i),
+             ratio * mcGraph->GetErrorYhigh(i)) / effMC);
+        }
+        
+        ratioGraph->SetMarkerStyle(20);
+        ratioGraph->SetLineColor(kBlack);
+        
+        
+        // Create a pad to draw the ratio
+        TPad *residualsPad = NewOwnedObject<TPad>("residualsPad", "", 0., 0., mainPadWidth + margin,
+         bottomSpacing + margin);
+        PlotStyle::ConfigureLowerPad(*residualsPad, true);
+        
+        canvas->cd();
+        residualsPad->Draw();
+        
+        
+        // Extract the label of the x axis of the main frame
+        auto const pos1 = title.find_first_of(';');
+        auto const pos2 = title.find_first_of(';', pos1 + 1);
+        string const xAxisTitle(title.substr(pos1 + 1, pos2 - pos1 - 1));
+        
+        residualsPad->cd();
+        TH1 *ratioFrame = residualsPad->DrawFrame(edges.front(), residualsRange.first,
+         edges.back(), residualsRange.second, (";" + xAxisTitle + ";Data/MC").c_str());
+        PlotStyle::MatchLowerAxes(*ratioFrame, *frame->GetXaxis(), *mainPad, *residualsPad,
+         (1. - 2. * margin - bottomSpacing) / bottomSpacing);
+        ratioFrame->GetYaxis()->SetLabelOffset(frame->GetYaxis()->GetLabelOffset());
+        
+        ratioGraph->Draw("p");
+        
+        
+        // Remove the labels from x axis of the main frame
+        frame->GetXaxis()->SetLabelOffset(999.);
+    }
+    
+    
+    return *canvas;
+}
+
+
+unique_ptr<TLegend> const &EfficiencyPlot::GetLegend()
+{
+    return legend;
+}
+
+
+unique_ptr<TPad> const &EfficiencyPlot::GetMainPad()
+{
+    return mainPad;
+}
+
+
+string const &EfficiencyPlot::GetTitle() const
+{
+    return title;
+}
+
+
+void EfficiencyPlot::Print(string const &fileName)
+{
+    // If the output is not a ROOT file, simply call TCanvas::Print
+    if (not boost::ends_with(fileName, ".root"))
+    {
+        canvas->Print(fileName.c_str());
+        return;
+    }
+    
+    
+    TFile outFile(fileName.c_str(), "recreate");
+    outFile.cd();
+    canvas->Write();
+    legend->Write();
+    outFile.Close();
+}
+
+
+void EfficiencyPlot::RequestResiduals(bool plotResiduals_, double min /*= 0.8*/,
+ double max /*= 1.2*/)
+{
+    plotResiduals = plotResiduals_;
+    residualsRange.first = min;
+    residualsRange.second = max;
+}
+
+
+void EfficiencyPlot::SetIntervals(BinomialIntervals::Method method,
+ double confLevel /*= 0.682689492137086*/)
+{
+    intervals = BinomialIntervals(method, confLevel);
+}
+
+
+void EfficiencyPlot::SetLegendLabels(string const &dataLabel_, string const &mcLabel_)
+{
+    dataLabel = dataLabel_;
+    mcLabel = mcLabel_;
+}
+
+
+TGraphAsymmErrors *EfficiencyPlot::BuildGraph(Counts const &counts, bool fullBinWidth)
+{
+    // All bins are processed in a single batch
+    vector<double> eff, lower, upper;
+    intervals.Compute(ArrayView<double>(counts.passed.data(), counts.passed.size()),
+     ArrayView<double>(counts.total.data(), counts.total.size()), eff, lower, upper);
+    
+    unsigned const numBins = eff.size();
+    TGraphAsymmErrors *graph = NewOwnedObject<TGraphAsymmErrors>(int(numBins));
+    
+    for (unsigned i = 0; i < numBins; ++i)
+    {
+        double const centre = 0.5 * (edges[i] + edges[i + 1]);
+        double const halfWidth = (fullBinWidth) ? 0.5 * (edges[i + 1] - edges[i]) : 0.;
+        
+        graph->SetPoint(i, centre, eff[i]);
+        graph->SetPointEXlow(i, halfWidth);
+        graph->SetPointEXhigh(i, halfWidth);
+        graph->SetPointEYlow(i, eff[i] - lower[i]);
+        graph->SetPointEYhigh(i, upper[i] - eff[i]);
+    }
+    
+    return graph;
+}
+
+
+void EfficiencyPlot::ReadFile(string const &srcFileName, string const &dirName)
+{
+    // Try to open the source file
+    unique_ptr<TFile> srcFile(TFile::Open(srcFileName.c_str()));
+    
+    if (not srcFile or srcFile->IsZombie())
+    {
+        ostringstream ost;
+        ost << "Source file \"" << srcFileName << "\" is corrupted or is not a valid ROOT file.";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Open the desired directory in the source file
+    unique_ptr<TDirectory> curDirectory(srcFile->GetDirectory(dirName.c_str()));
+    
+    if (not curDirectory)
+    {
+        ostringstream ost;
+        ost << "Source file \"" << srcFileName << "\" does not contain a directory \"" <<
+         dirName << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Read histogram title
+    unique_ptr<TObjString> titleStored(dynamic_cast<TObjString *>(curDirectory->Get("title")));
+    
+    if (titleStored)
+        title = titleStored->GetString().Data();
+    
+    
+    // Read the four histograms and copy their contents into plain arrays. Under- and overflow
+    //bins are not plotted
+    vector<pair<string, vector<double> *>> const targets{{"data_passed", &dataCounts.passed},
+     {"data_total", &dataCounts.total}, {"mc_passed", &mcCounts.passed},
+     {"mc_total", &mcCounts.total}};
+    
+    for (auto const &t: targets)
+    {
+        unique_ptr<TH1> hist(dynamic_cast<TH1 *>(curDirectory->Get(t.first.c_str())));
+        
+        if (not hist)
+        {
+            ostringstream ost;
+            ost << "Failed to find histogram \"" << t.first << "\" in file \"" << srcFileName <<
+             "\", directory \"" << dirName << "\".";
+            throw runtime_error(ost.str());
+        }
+        
+        int const numBins = hist->GetNbinsX();
+        
+        if (edges.empty())
+        {
+            for (int bin = 1; bin <= numBins + 1; ++bin)
+                edges.push_back(hist->GetXaxis()->GetBinLowEdge(bin));
+        }
+        else if (int(edges.size()) != numBins + 1)
+        {
+            ostringstream ost;
+            ost << "Histogram \"" << t.first << "\" in file \"" << srcFileName <<
+             "\", directory \"" << dirName << "\" has a different binning.";
+            throw runtime_error(ost.str());
+        }
+        
+        for (int bin = 1; bin <= numBins; ++bin)
+            t.second->push_back(hist->GetBinContent(bin));
+    }
+}
@@ -0,0 +1,344 @@
+#include <HistCache.hpp>
+
+#include <MappedFile.hpp>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Alignment of arrays in the cache file, in bytes
+    size_t const arrayAlignment = 64;
+    
+    /// Magic string that identifies the format
+    char const cacheMagic[8] = {'H', 'P', 'U', 'C', 'A', 'C', 'H', '1'};
+    
+    /// Value used to detect a mismatch in byte order
+    uint32_t const byteOrderMark = 0x01020304;
+    
+    
+    /// Appends zero bytes to the buffer until its size is a multiple of the given alignment
+    void Pad(vector<char> &buffer, size_t alignment)
+    {
+        buffer.resize((buffer.size() + alignment - 1) / alignment * alignment, 0);
+    }
+    
+    
+    /// Appends an aligned array to the buffer and returns its offset
+    uint64_t AppendArray(vector<char> &buffer, ArrayView<double> const &array)
+    {
+        Pad(buffer, arrayAlignment);
+        uint64_t const offset = buffer.size();
+        buffer.insert(buffer.end(), reinterpret_cast<char const *>(array.GetData()),
+         reinterpret_cast<char const *>(array.GetData() + array.GetSize()));
+        return offset;
+    }
+}
+
+
+HistCache::HistCache(string const &fileName):
+    file(new MappedFile(fileName))
+{
+    Header header;
+    
+    if (file->GetSize() < sizeof(header))
+    {
+        ostringstream ost;
+        ost << "File \"" << fileName << "\" is not a valid histogram cache.";
+        throw runtime_error(ost.str());
+    }
+    
+    memcpy(&header, file->GetData(), sizeof(header));
+    
+    if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 or
+     header.byteOrderMark != byteOrderMark or header.fileSize != file->GetSize() or
+     header.indexOffset + header.numDirs * sizeof(DirEntry) > file->GetSize() or
+     header.indexOffset % alignof(DirEntry) != 0)
+    {
+        ostringstream ost;
+        ost << "File \"" << fileName << "\" is not a valid histogram cache, is truncated, or " <<
+         "was created on a machine with a different byte order.";
+        throw runtime_error(ost.str());
+    }
+    
+    index = reinterpret_cast<DirEntry const *>(file->GetData() + header.indexOffset);
+    numDirs = header.numDirs;
+}
+
+
+void HistCache::Create(string const &cacheFileName, PlotReader const &source,
+ vector<string> const &dirNames)
+{
+    map<string, PlotContent> contents;
+    
+    for (auto const &dirName: dirNames)
+        contents[dirName] = source.Read(dirName);
+    
+    Write(cacheFileName, contents);
+}
+
+
+void HistCache::Write(string const &cacheFileName, map<string, PlotContent> const &contents)
+{
+    // The file is assembled in memory. The header and the index are filled at the end when all
+    //offsets are known
+    vector<char> buffer(sizeof(Header));
+    Pad(buffer, arrayAlignment);
+    uint64_t const indexOffset = buffer.size();
+    buffer.resize(buffer.size() + contents.size() * sizeof(DirEntry));
+    
+    vector<DirEntry> dirEntries;
+    vector<vector<HistEntry>> histEntries;
+    vector<pair<string const *, uint64_t *>> strings;
+    
+    
+    for (auto const &c: contents)
+    {
+        PlotContent const &content = c.second;
+        dirEntries.emplace_back();
+        histEntries.emplace_back();
+        DirEntry &dirEntry = dirEntries.back();
+        
+        dirEntry.numBins = content.GetNumBins();
+        dirEntry.edgesOffset = AppendArray(buffer, content.edges);
+        
+        
+        // Collect all histograms with their roles
+        vector<pair<PlotContent::Hist const *, uint32_t>> hists{{&content.data, 0}};
+        
+        for (auto const &p: content.processes)
+            hists.emplace_back(&p, 1);
+        
+        if (content.HasSystematics())
+        {
+            hists.emplace_back(&content.systUp, 2);
+            hists.emplace_back(&content.systDown, 3);
+        }
+        
+        dirEntry.numHists = hists.size();
+        
+        for (auto const &h: hists)
+        {
+            HistEntry histEntry;
+            histEntry.role = h.second;
+            histEntry.colour = h.first->colour;
+            histEntry.contentsOffset = AppendArray(buffer, h.first->contents);
+            histEntry.sumw2Offset = (h.first->sumw2.IsEmpty()) ? 0 :
+             AppendArray(buffer, h.first->sumw2);
+            histEntry.nameLength = h.first->name.length();
+            histEntry.titleLength = h.first->title.length();
+            histEntries.back().emplace_back(histEntry);
+        }
+        
+        
+        // Descriptors of histograms are placed after the arrays
+        Pad(buffer, alignof(HistEntry));
+        dirEntry.histsOffset = buffer.size();
+        buffer.resize(buffer.size() + hists.size() * sizeof(HistEntry));
+        
+        dirEntry.nameLength = c.first.length();
+        dirEntry.titleLength = content.title.length();
+    }
+    
+    
+    // Append the table of strings. Pointers to entries are only taken now since the vectors of
+    //entries are not modified anymore
+    unsigned iDir = 0;
+    
+    for (auto const &c: contents)
+    {
+        strings.emplace_back(&c.first, &dirEntries[iDir].nameOffset);
+        strings.emplace_back(&c.second.title, &dirEntries[iDir].titleOffset);
+        
+        unsigned iHist = 0;
+        vector<PlotContent::Hist const *> hists{&c.second.data};
+        
+        for (auto const &p: c.second.processes)
+            hists.push_back(&p);
+        
+        if (c.second.HasSystematics())
+        {
+            hists.push_back(&c.second.systUp);
+            hists.push_back(&c.second.systDown);
+        }
+        
+        for (auto const &h: hists)
+        {
+            strings.emplace_back(&h->name, &histEntries[iDir][iHist].nameOffset);
+            strings.emplace_back(&h->title, &histEntries[iDir][iHist].titleOffset);
+            ++iHist;
+        }
+        
+        ++iDir;
+    }
+    
+    for (auto const &s: strings)
+    {
+        *s.second = buffer.size();
+        buffer.insert(buffer.end(), s.first->begin(), s.first->end());
+    }
+    
+    
+    // Fill the header and the descriptors
+    Header header;
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.byteOrderMark = byteOrderMark;
+    header.numDirs = contents.size();
+    header.indexOffset = indexOffset;
+    header.fileSize = buffer.size();
+    memcpy(buffer.data(), &header, sizeof(header));
+    
+    for (unsigned i = 0; i < dirEntries.size(); ++i)
+    {
+        memcpy(buffer.data() + indexOffset + i * sizeof(DirEntry), &dirEntries[i],
+         sizeof(DirEntry));
+        
+        if (not histEntries[i].empty())
+            memcpy(buffer.data() + dirEntries[i].histsOffset, histEntries[i].data(),
+             histEntries[i].size() * sizeof(HistEntry));
+    }
+    
+    
+    // Write the file under a temporary name and move it to the final location. The name is unique
+    //for every call, so that concurrent writers of the same file, in this or other processes, do
+    //not overwrite each other's temporary files
+    static atomic<unsigned long> tmpCounter(0);
+    ostringstream tmpFileName;
+    tmpFileName << cacheFileName << ".tmp" << getpid() << "." << tmpCounter++;
+    
+    {
+        ofstream outFile(tmpFileName.str(), ios::binary);
+        outFile.write(buffer.data(), buffer.size());
+        
+        if (not outFile)
+        {
+            ostringstream ost;
+            ost << "Failed to write histogram cache \"" << tmpFileName.str() << "\".";
+            throw runtime_error(ost.str());
+        }
+    }
+    
+    if (rename(tmpFileName.str().c_str(), cacheFileName.c_str()) != 0)
+    {
+        remove(tmpFileName.str().c_str());
+        ostringstream ost;
+        ost << "Failed to move histogram cache to \"" << cacheFileName << "\".";
+        throw runtime_error(ost.str());
+    }
+}
+
+
+PlotContent HistCache::Read(string const &dirName /*= ""*/) const
+{
+    // Find the directory with a binary search in the sorted index
+    DirEntry const *const dirEntry = lower_bound(index, index + numDirs, dirName,
+     [this](DirEntry const &entry, string const &name)
+    {
+        return (name.compare(0, string::npos, file->GetData() + entry.nameOffset,
+         entry.nameLength) > 0);
+    });
+    
+    if (dirEntry == index + numDirs or
+     GetString(dirEntry->nameOffset, dirEntry->nameLength) != dirName)
+    {
+        ostringstream ost;
+        ost << "Histogram cache \"" << file->GetFileName() << "\" does not contain a " <<
+         "directory \"" << dirName << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Set up views of the arrays in the mapped memory
+    PlotContent content;
+    content.KeepAlive(file);
+    
+    unsigned const numBins = dirEntry->numBins;
+    content.title = GetString(dirEntry->titleOffset, dirEntry->titleLength);
+    content.edges = GetArray(dirEntry->edgesOffset, numBins + 1);
+    
+    if (dirEntry->histsOffset + dirEntry->numHists * sizeof(HistEntry) > file->GetSize())
+    {
+        ostringstream ost;
+        ost << "Histogram cache \"" << file->GetFileName() << "\" is corrupted.";
+        throw runtime_error(ost.str());
+    }
+    
+    HistEntry const *const histEntries =
+     reinterpret_cast<HistEntry const *>(file->GetData() + dirEntry->histsOffset);
+    
+    for (unsigned i = 0; i < dirEntry->numHists; ++i)
+    {
+        HistEntry const &entry = histEntries[i];
+        PlotContent::Hist *target;
+        
+        if (entry.role == 0)
+            target = &content.data;
+        else if (entry.role == 2)
+            target = &content.systUp;
+        else if (entry.role == 3)
+            target = &content.systDown;
+        else
+        {
+            content.processes.emplace_back();
+            target = &content.processes.back();
+        }
+        
+        target->name = GetString(entry.nameOffset, entry.nameLength);
+        target->title = GetString(entry.titleOffset, entry.titleLength);
+        target->colour = entry.colour;
+        target->contents = GetArray(entry.contentsOffset, numBins + 2);
+        
+        if (entry.sumw2Offset != 0)
+            target->sumw2 = GetArray(entry.sumw2Offset, numBins + 2);
+    }
+    
+    return content;
+}
+
+
+vector<string> HistCache::GetDirNames() const
+{
+    vector<string> names;
+    
+    for (unsigned i = 0; i < numDirs; ++i)
+        names.emplace_back(GetString(index[i].nameOffset, index[i].nameLength));
+    
+    return names;
+}
+
+
+string HistCache::GetString(uint64_t offset, uint64_t length) const
+{
+    if (offset + length > file->GetSize())
+    {
+        ostringstream ost;
+        ost << "Histogram cache \"" << file->GetFileName() << "\" is corrupted.";
+        throw runtime_error(ost.str());
+    }
+    
+    return string(file->GetData() + offset, length);
+}
+
+
+ArrayView<double> HistCache::GetArray(uint64_t offset, uint64_t size) const
+{
+    if (offset + size * sizeof(double) > file->GetSize() or offset % arrayAlignment != 0)
+    {
+        ostringstream ost;
+        ost << "Histogram cache \"" << file->GetFileName() << "\" is corrupted.";
+        throw runtime_error(ost.str());
+    }
+    
+    return ArrayView<double>(reinterpret_cast<double const *>(file->GetData() + offset), size);
+}
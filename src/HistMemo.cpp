@@ -0,0 +1,241 @@
+#include <HistMemo.hpp>
+
+#include <HistCache.hpp>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Checks if the character can be a part of an identifier or a number
+    bool IsWordChar(char c)
+    {
+        return (isalnum(static_cast<unsigned char>(c)) or c == '_' or c == '.');
+    }
+    
+    
+    /**
+     * \brief Canonicalises an expression
+     * 
+     * Whitespace is dropped unless it separates two characters that can form an identifier or a
+     * number, in which case a single space is kept. Quoted strings are copied verbatim.
+     */
+    string CanonicaliseExpression(string const &expression)
+    {
+        string result;
+        bool pendingSpace = false;
+        char quote = '\0';
+        
+        for (char const c: expression)
+        {
+            if (quote != '\0')
+            {
+                result += c;
+                
+                if (c == quote)
+                    quote = '\0';
+                
+                continue;
+            }
+            
+            if (isspace(static_cast<unsigned char>(c)))
+            {
+                pendingSpace = true;
+                continue;
+            }
+            
+            if (pendingSpace and not result.empty() and IsWordChar(result.back()) and
+             IsWordChar(c))
+                result += ' ';
+            
+            pendingSpace = false;
+            result += c;
+            
+            if (c == '"' or c == '\'')
+                quote = c;
+        }
+        
+        return result;
+    }
+    
+    
+    /// Computes the 64-bit FNV-1a hash of a string
+    uint64_t HashString(string const &s)
+    {
+        uint64_t h = 0xCBF29CE484222325ull;
+        
+        for (char const c: s)
+        {
+            h ^= static_cast<unsigned char>(c);
+            h *= 0x100000001B3ull;
+        }
+        
+        return h;
+    }
+    
+    
+    /// Writes a field with a length prefix, which makes the concatenation unambiguous
+    void WriteField(ostream &out, char const *label, string const &value)
+    {
+        out << label << ' ' << value.length() << ':' << value << '\n';
+    }
+}
+
+
+HistMemo::HistMemo(string const &cacheDir_):
+    cacheDir(cacheDir_), numHits(0), numMisses(0)
+{
+    if (mkdir(cacheDir.c_str(), 0755) != 0 and errno != EEXIST)
+    {
+        ostringstream ost;
+        ost << "Failed to create cache directory \"" << cacheDir << "\": " << strerror(errno) <<
+         ".";
+        throw runtime_error(ost.str());
+    }
+}
+
+
+bool HistMemo::Contains(Request const &request) const
+{
+    PlotContent content;
+    return TryRead(Describe(request), content);
+}
+
+
+string HistMemo::Describe(Request const &request)
+{
+    // Identities of input files. They are sorted so that the order in which the files are given
+    //does not matter
+    map<string, string> files;
+    
+    for (auto const &path: request.inputFiles)
+    {
+        struct stat fileStat;
+        char *const realPath = realpath(path.c_str(), nullptr);
+        
+        if (not realPath or stat(realPath, &fileStat) != 0)
+        {
+            free(realPath);
+            ostringstream ost;
+            ost << "Input file \"" << path << "\" is not accessible: " << strerror(errno) << ".";
+            throw runtime_error(ost.str());
+        }
+        
+        ostringstream identity;
+        identity << fileStat.st_size << ' ' << fileStat.st_mtim.tv_sec << '.' <<
+         setw(9) << setfill('0') << fileStat.st_mtim.tv_nsec;
+        files[realPath] = identity.str();
+        free(realPath);
+    }
+    
+    
+    // Compose the description. Bin edges are written as their bit patterns to avoid any loss in
+    //formatting
+    ostringstream description;
+    description << "HistMemo 1\n";
+    
+    for (auto const &f: files)
+    {
+        WriteField(description, "file", f.first);
+        WriteField(description, "identity", f.second);
+    }
+    
+    WriteField(description, "selection", CanonicaliseExpression(request.selection));
+    WriteField(description, "variable", CanonicaliseExpression(request.variable));
+    WriteField(description, "weight", CanonicaliseExpression(request.weight));
+    
+    description << "edges " << request.edges.size() << ':' << hex << setfill('0');
+    
+    for (double const edge: request.edges)
+    {
+        uint64_t bits;
+        memcpy(&bits, &edge, sizeof(bits));
+        description << ' ' << setw(16) << bits;
+    }
+    
+    description << dec << '\n';
+    WriteField(description, "version", request.version);
+    
+    return description.str();
+}
+
+
+PlotContent HistMemo::Get(Request const &request, Producer const &producer)
+{
+    string const description(Describe(request));
+    PlotContent content;
+    
+    if (TryRead(description, content))
+    {
+        ++numHits;
+        return content;
+    }
+    
+    
+    // Run the producer and store its outcome. The cache file is replaced atomically, so
+    //concurrent readers see either the old or the new entry
+    ++numMisses;
+    content = producer();
+    HistCache::Write(GetEntryFileName(description), {{description, content}});
+    
+    return content;
+}
+
+
+unsigned HistMemo::GetNumHits() const
+{
+    return numHits;
+}
+
+
+unsigned HistMemo::GetNumMisses() const
+{
+    return numMisses;
+}
+
+
+string HistMemo::GetEntryFileName(string const &description) const
+{
+    ostringstream fileName;
+    fileName << cacheDir << '/' << hex << setw(16) << setfill('0') << HashString(description) <<
+     ".hpucache";
+    return fileName.str();
+}
+
+
+bool HistMemo::TryRead(string const &description, PlotContent &content) const
+{
+    string const fileName(GetEntryFileName(description));
+    
+    if (access(fileName.c_str(), R_OK) != 0)
+        return false;
+    
+    
+    // A file with a different description, which means a hash collision, or a corrupted file is
+    //treated as a miss
+    try
+    {
+        HistCache const cache(fileName);
+        content = cache.Read(description);
+        return true;
+    }
+    catch (runtime_error const &)
+    {
+        return false;
+    }
+}
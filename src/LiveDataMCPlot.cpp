@@ -0,0 +1,72 @@
+#include <LiveDataMCPlot.hpp>
+
+
+using namespace std;
+
+
+LiveDataMCPlot::LiveDataMCPlot(string const &segmentName, double minInterval_ /*= 1.*/):
+    feed(segmentName),
+    minInterval(chrono::duration_cast<chrono::steady_clock::duration>(
+     chrono::duration<double>(minInterval_))),
+    lastGeneration(0)
+{}
+
+
+DataMCPlot *LiveDataMCPlot::GetPlot()
+{
+    return plot.get();
+}
+
+
+void LiveDataMCPlot::SetConfigurator(function<void(DataMCPlot &)> const &configurator_)
+{
+    configurator = configurator_;
+}
+
+
+void LiveDataMCPlot::SetDecorator(function<void(DataMCPlot &)> const &decorator_)
+{
+    decorator = decorator_;
+}
+
+
+bool LiveDataMCPlot::Update(vector<string> const &outFileNames /*= {}*/)
+{
+    auto const now = chrono::steady_clock::now();
+    
+    if (plot and (feed.GetGeneration() == lastGeneration or now - lastRedraw < minInterval))
+        return false;
+    
+    
+    // Histograms are filled directly from the published buffer. If the producer has overwritten
+    //it in the meantime, the plot is created anew
+    unique_ptr<DataMCPlot> newPlot;
+    uint64_t sequence;
+    
+    do
+    {
+        PlotContent const content(feed.View(sequence));
+        newPlot.reset(new DataMCPlot(content));
+    }
+    while (not feed.IsValid(sequence));
+    
+    
+    // The old plot must be deleted before the new one is drawn because they use canvases with the
+    //same name
+    plot = move(newPlot);
+    
+    if (configurator)
+        configurator(*plot);
+    
+    plot->Draw();
+    
+    if (decorator)
+        decorator(*plot);
+    
+    for (auto const &fileName: outFileNames)
+        plot->Print(fileName);
+    
+    lastGeneration = sequence / 2;
+    lastRedraw = now;
+    return true;
+}
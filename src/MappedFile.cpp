@@ -0,0 +1,89 @@
+#include <MappedFile.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+MappedFile::MappedFile(string const &fileName_):
+    fileName(fileName_),
+    data(nullptr), size(0)
+{
+    int const fd = open(fileName.c_str(), O_RDONLY);
+    
+    if (fd < 0)
+    {
+        ostringstream ost;
+        ost << "Failed to open file \"" << fileName << "\": " << strerror(errno) << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    struct stat fileStat;
+    
+    if (fstat(fd, &fileStat) != 0)
+    {
+        close(fd);
+        ostringstream ost;
+        ost << "Failed to determine size of file \"" << fileName << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    size = fileStat.st_size;
+    
+    
+    // An empty file cannot be mapped. Leave the data pointer null in this case
+    if (size > 0)
+    {
+        void *const mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        
+        if (mapping == MAP_FAILED)
+        {
+            close(fd);
+            ostringstream ost;
+            ost << "Failed to map file \"" << fileName << "\" into memory: " << strerror(errno) <<
+             ".";
+            throw runtime_error(ost.str());
+        }
+        
+        data = static_cast<char const *>(mapping);
+    }
+    
+    
+    // The mapping remains valid after the file descriptor is closed
+    close(fd);
+}
+
+
+MappedFile::~MappedFile()
+{
+    if (data)
+        munmap(const_cast<char *>(data), size);
+}
+
+
+char const *MappedFile::GetData() const
+{
+    return data;
+}
+
+
+string const &MappedFile::GetFileName() const
+{
+    return fileName;
+}
+
+
+size_t MappedFile::GetSize() const
+{
+    return size;
+}
@@ -0,0 +1,530 @@
+#include <NpzReader.hpp>
+
+#include <MappedFile.hpp>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Reads a little-endian integer of the given type from the buffer, checking its boundaries
+    template<typename T>
+    T Load(MappedFile const &file, size_t offset)
+    {
+        if (offset + sizeof(T) > file.GetSize())
+        {
+            ostringstream ost;
+            ost << "File \"" << file.GetFileName() << "\" is truncated or corrupted.";
+            throw runtime_error(ost.str());
+        }
+        
+        T value;
+        memcpy(&value, file.GetData() + offset, sizeof(T));
+        return value;
+    }
+}
+
+
+NpzReader::NpzReader(string const &fileName):
+    file(new MappedFile(fileName))
+{
+    ReadCentralDirectory();
+}
+
+
+PlotContent NpzReader::Read(string const &dirName /*= ""*/) const
+{
+    PlotContent content;
+    content.KeepAlive(file);
+    
+    string const prefix((dirName.empty()) ? "" : dirName + "/");
+    
+    ostringstream source;
+    source << "file \"" << file->GetFileName() << "\", directory \"" << dirName << "\"";
+    
+    
+    // Select members that belong to the requested directory. Nested directories are skipped
+    vector<Member const *> dirMembers;
+    
+    for (auto const &m: members)
+    {
+        if (boost::starts_with(m.name, prefix) and
+         m.name.find('/', prefix.length()) == string::npos)
+            dirMembers.push_back(&m);
+    }
+    
+    
+    // Bin edges must be read first since they define the expected lengths of other arrays
+    for (auto const &m: dirMembers)
+    {
+        if (m->name.substr(prefix.length()) != "edges")
+            continue;
+        
+        NpyArray const edges(ParseArray(*m));
+        
+        if (edges.shape.size() != 1 or edges.shape[0] < 2)
+        {
+            ostringstream ost;
+            ost << "Array with bin edges in " << source.str() << " has a wrong shape.";
+            throw runtime_error(ost.str());
+        }
+        
+        content.edges = ReadContents(*m, edges.shape[0] - 2, content);
+        //^ ReadContents treats the array of edges as an array of bin contents with under- and
+        //overflow bins included, and thus no padding is applied
+    }
+    
+    if (content.edges.IsEmpty())
+    {
+        ostringstream ost;
+        ost << "Failed to find bin edges in " << source.str() << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Read the rest of the arrays
+    unsigned const numBins = content.GetNumBins();
+    
+    for (auto const &m: dirMembers)
+    {
+        string const name(m->name.substr(prefix.length()));
+        
+        if (name == "edges")
+            continue;
+        
+        if (name == "title")
+        {
+            content.title = ReadString(*m);
+            continue;
+        }
+        
+        
+        PlotContent::Hist *hist;
+        
+        if (name == "data")
+            hist = &content.data;
+        else if (name == "syst_up")
+            hist = &content.systUp;
+        else if (name == "syst_down")
+            hist = &content.systDown;
+        else
+        {
+            content.processes.emplace_back();
+            hist = &content.processes.back();
+        }
+        
+        hist->name = hist->title = name;
+        hist->contents = ReadContents(*m, numBins, content);
+    }
+    
+    
+    content.data.title = "Data";
+    content.Validate(source.str());
+    return content;
+}
+
+
+vector<string> NpzReader::GetArrayNames() const
+{
+    vector<string> names;
+    
+    for (auto const &m: members)
+        names.push_back(m.name);
+    
+    return names;
+}
+
+
+void NpzReader::ReadCentralDirectory()
+{
+    MappedFile const &f = *file;
+    size_t const eocdSize = 22;
+    
+    if (f.GetSize() < eocdSize)
+    {
+        ostringstream ost;
+        ost << "File \"" << f.GetFileName() << "\" is not a valid .npz archive.";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Locate the end of central directory record. It is followed by a comment of variable length
+    size_t eocdPos = f.GetSize() - eocdSize;
+    
+    while (Load<uint32_t>(f, eocdPos) != 0x06054b50)
+    {
+        if (eocdPos == 0 or f.GetSize() - eocdPos > eocdSize + 0xFFFF)
+        {
+            ostringstream ost;
+            ost << "File \"" << f.GetFileName() << "\" is not a valid .npz archive.";
+            throw runtime_error(ost.str());
+        }
+        
+        --eocdPos;
+    }
+    
+    uint64_t numEntries = Load<uint16_t>(f, eocdPos + 10);
+    uint64_t cdOffset = Load<uint32_t>(f, eocdPos + 16);
+    
+    
+    // If the archive is in zip64 format, the actual values are stored in an extended record, which
+    //is pointed to by a locator placed right before the standard record
+    if (eocdPos >= 20 and Load<uint32_t>(f, eocdPos - 20) == 0x07064b50)
+    {
+        uint64_t const zip64EocdPos = Load<uint64_t>(f, eocdPos - 20 + 8);
+        
+        if (Load<uint32_t>(f, zip64EocdPos) == 0x06064b50)
+        {
+            numEntries = Load<uint64_t>(f, zip64EocdPos + 32);
+            cdOffset = Load<uint64_t>(f, zip64EocdPos + 48);
+        }
+    }
+    
+    
+    // Read entries of the central directory
+    size_t pos = cdOffset;
+    
+    for (uint64_t iEntry = 0; iEntry < numEntries; ++iEntry)
+    {
+        if (Load<uint32_t>(f, pos) != 0x02014b50)
+        {
+            ostringstream ost;
+            ost << "Central directory of archive \"" << f.GetFileName() << "\" is corrupted.";
+            throw runtime_error(ost.str());
+        }
+        
+        unsigned const method = Load<uint16_t>(f, pos + 10);
+        uint64_t compressedSize = Load<uint32_t>(f, pos + 20);
+        uint64_t size = Load<uint32_t>(f, pos + 24);
+        unsigned const nameLength = Load<uint16_t>(f, pos + 28);
+        unsigned const extraLength = Load<uint16_t>(f, pos + 30);
+        unsigned const commentLength = Load<uint16_t>(f, pos + 32);
+        uint64_t localHeaderOffset = Load<uint32_t>(f, pos + 42);
+        
+        Load<char>(f, pos + 46 + nameLength - 1);  // check boundaries before constructing the name
+        string name(f.GetData() + pos + 46, nameLength);
+        
+        
+        // Values that do not fit into 32 bits are stored in the zip64 extra field. NumPy forces
+        //this format for all members
+        size_t extraPos = pos + 46 + nameLength;
+        size_t const extraEnd = extraPos + extraLength;
+        
+        while (extraPos + 4 <= extraEnd)
+        {
+            unsigned const headerId = Load<uint16_t>(f, extraPos);
+            unsigned const dataSize = Load<uint16_t>(f, extraPos + 2);
+            
+            if (headerId == 0x0001)
+            {
+                size_t fieldPos = extraPos + 4;
+                
+                if (size == 0xFFFFFFFF)
+                {
+                    size = Load<uint64_t>(f, fieldPos);
+                    fieldPos += 8;
+                }
+                
+                if (compressedSize == 0xFFFFFFFF)
+                {
+                    compressedSize = Load<uint64_t>(f, fieldPos);
+                    fieldPos += 8;
+                }
+                
+                if (localHeaderOffset == 0xFFFFFFFF)
+                    localHeaderOffset = Load<uint64_t>(f, fieldPos);
+            }
+            
+            extraPos += 4 + dataSize;
+        }
+        
+        pos += 46 + nameLength + extraLength + commentLength;
+        
+        
+        if (method != 0)
+        {
+            ostringstream ost;
+            ost << "Member \"" << name << "\" of archive \"" << f.GetFileName() <<
+             "\" is compressed. Only uncompressed archives (as produced by numpy.savez) are " <<
+             "supported.";
+            throw runtime_error(ost.str());
+        }
+        
+        
+        // Skip members that are not arrays
+        if (not boost::ends_with(name, ".npy"))
+            continue;
+        
+        name.resize(name.length() - 4);
+        
+        
+        // Data follow the local header, whose extra field might differ from the one in the
+        //central directory
+        Member member;
+        member.name = name;
+        member.offset = localHeaderOffset + 30 + Load<uint16_t>(f, localHeaderOffset + 26) +
+         Load<uint16_t>(f, localHeaderOffset + 28);
+        member.size = size;
+        
+        if (member.offset + member.size > f.GetSize())
+        {
+            ostringstream ost;
+            ost << "Member \"" << name << "\" of archive \"" << f.GetFileName() <<
+             "\" is truncated.";
+            throw runtime_error(ost.str());
+        }
+        
+        members.emplace_back(member);
+    }
+}
+
+
+NpzReader::NpyArray NpzReader::ParseArray(Member const &member) const
+{
+    // Check the magic string and read the length of the header, which depends on the version of
+    //the format
+    char const *const start = file->GetData() + member.offset;
+    
+    if (member.size < 10 or memcmp(start, "\x93NUMPY", 6) != 0)
+    {
+        ostringstream ost;
+        ost << "Member \"" << member.name << "\" of archive \"" << file->GetFileName() <<
+         "\" is not in .npy format.";
+        throw runtime_error(ost.str());
+    }
+    
+    unsigned const majorVersion = start[6];
+    size_t headerStart, headerLength;
+    
+    if (majorVersion == 1)
+    {
+        headerStart = 10;
+        headerLength = Load<uint16_t>(*file, member.offset + 8);
+    }
+    else
+    {
+        headerStart = 12;
+        headerLength = Load<uint32_t>(*file, member.offset + 8);
+    }
+    
+    if (headerStart + headerLength > member.size)
+    {
+        ostringstream ost;
+        ost << "Member \"" << member.name << "\" of archive \"" << file->GetFileName() <<
+         "\" is truncated.";
+        throw runtime_error(ost.str());
+    }
+    
+    string const header(start + headerStart, headerLength);
+    
+    
+    // The header is a Python dictionary literal of the form
+    //  {'descr': '<f8', 'fortran_order': False, 'shape': (12,), }
+    NpyArray array;
+    array.data = start + headerStart + headerLength;
+    
+    auto const descrPos = header.find("'descr'");
+    auto const descrStart = header.find('\'', header.find(':', descrPos)) + 1;
+    auto const descrEnd = header.find('\'', descrStart);
+    auto const shapeStart = header.find('(', header.find("'shape'"));
+    auto const shapeEnd = header.find(')', shapeStart);
+    
+    if (descrPos == string::npos or descrEnd == string::npos or shapeStart == string::npos or
+     shapeEnd == string::npos or descrEnd - descrStart < 3)
+    {
+        ostringstream ost;
+        ost << "Failed to parse header of array \"" << member.name << "\" in archive \"" <<
+         file->GetFileName() << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    string const descr(header.substr(descrStart, descrEnd - descrStart));
+    
+    if (descr[0] == '>')
+    {
+        ostringstream ost;
+        ost << "Array \"" << member.name << "\" in archive \"" << file->GetFileName() <<
+         "\" has big-endian type \"" << descr << "\", which is not supported.";
+        throw runtime_error(ost.str());
+    }
+    
+    array.kind = descr[1];
+    array.itemSize = stoul(descr.substr(2));
+    
+    if (array.kind == 'U')
+        array.itemSize *= 4;
+    
+    
+    istringstream shapeStream(header.substr(shapeStart + 1, shapeEnd - shapeStart - 1));
+    size_t dimension;
+    char separator;
+    
+    while (shapeStream >> dimension)
+    {
+        array.shape.push_back(dimension);
+        shapeStream >> separator;
+    }
+    
+    
+    // Make sure that the declared shape fits into the member
+    size_t numElements = 1;
+    
+    for (auto const &d: array.shape)
+        numElements *= d;
+    
+    if (headerStart + headerLength + numElements * array.itemSize > member.size)
+    {
+        ostringstream ost;
+        ost << "Member \"" << member.name << "\" of archive \"" << file->GetFileName() <<
+         "\" is truncated.";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    return array;
+}
+
+
+ArrayView<double> NpzReader::ReadContents(Member const &member, unsigned numBins,
+ PlotContent &content) const
+{
+    NpyArray const array(ParseArray(member));
+    
+    if (array.shape.size() != 1 or (array.shape[0] != numBins and array.shape[0] != numBins + 2))
+    {
+        ostringstream ost;
+        ost << "Array \"" << member.name << "\" in archive \"" << file->GetFileName() <<
+         "\" has a shape incompatible with " << numBins << " bins.";
+        throw runtime_error(ost.str());
+    }
+    
+    size_t const length = array.shape[0];
+    
+    
+    // View the array in place if possible
+    if (array.kind == 'f' and array.itemSize == sizeof(double) and length == numBins + 2 and
+     reinterpret_cast<uintptr_t>(array.data) % alignof(double) == 0)
+        return ArrayView<double>(reinterpret_cast<double const *>(array.data), length);
+    
+    
+    // Otherwise convert the array. Under- and overflow bins are added if missing
+    vector<double> buffer(numBins + 2, 0.);
+    double *const dst = buffer.data() + ((length == numBins) ? 1 : 0);
+    
+    for (size_t i = 0; i < length; ++i)
+    {
+        char const *const src = array.data + i * array.itemSize;
+        
+        if (array.kind == 'f' and array.itemSize == 8)
+        {
+            double value;
+            memcpy(&value, src, 8);
+            dst[i] = value;
+        }
+        else if (array.kind == 'f' and array.itemSize == 4)
+        {
+            float value;
+            memcpy(&value, src, 4);
+            dst[i] = value;
+        }
+        else if (array.kind == 'i' and array.itemSize == 8)
+        {
+            int64_t value;
+            memcpy(&value, src, 8);
+            dst[i] = value;
+        }
+        else if (array.kind == 'i' and array.itemSize == 4)
+        {
+            int32_t value;
+            memcpy(&value, src, 4);
+            dst[i] = value;
+        }
+        else if (array.kind == 'u' and array.itemSize == 8)
+        {
+            uint64_t value;
+            memcpy(&value, src, 8);
+            dst[i] = value;
+        }
+        else if (array.kind == 'u' and array.itemSize == 4)
+        {
+            uint32_t value;
+            memcpy(&value, src, 4);
+            dst[i] = value;
+        }
+        else
+        {
+            ostringstream ost;
+            ost << "Array \"" << member.name << "\" in archive \"" << file->GetFileName() <<
+             "\" has an unsupported type.";
+            throw runtime_error(ost.str());
+        }
+    }
+    
+    return content.Adopt(move(buffer));
+}
+
+
+string NpzReader::ReadString(Member const &member) const
+{
+    NpyArray const array(ParseArray(member));
+    
+    if (array.shape.size() != 0 or (array.kind != 'U' and array.kind != 'S'))
+    {
+        ostringstream ost;
+        ost << "Array \"" << member.name << "\" in archive \"" << file->GetFileName() <<
+         "\" is not a scalar string.";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    string result;
+    
+    if (array.kind == 'S')
+    {
+        result.assign(array.data, array.itemSize);
+        result.resize(strnlen(result.c_str(), array.itemSize));
+        return result;
+    }
+    
+    
+    // Unicode strings are stored in UTF-32. Convert them into UTF-8
+    for (unsigned i = 0; i < array.itemSize / 4; ++i)
+    {
+        uint32_t c;
+        memcpy(&c, array.data + 4 * i, 4);
+        
+        if (c == 0)
+            break;
+        
+        if (c < 0x80)
+            result += char(c);
+        else if (c < 0x800)
+        {
+            result += char(0xC0 | (c >> 6));
+            result += char(0x80 | (c & 0x3F));
+        }
+        else if (c < 0x10000)
+        {
+            result += char(0xE0 | (c >> 12));
+            result += char(0x80 | ((c >> 6) & 0x3F));
+            result += char(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            result += char(0xF0 | (c >> 18));
+            result += char(0x80 | ((c >> 12) & 0x3F));
+            result += char(0x80 | ((c >> 6) & 0x3F));
+            result += char(0x80 | (c & 0x3F));
+        }
+    }
+    
+    return result;
+}
@@ -0,0 +1,51 @@
+#include <Parallel.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+
+using namespace std;
+
+
+void Parallel::Run(unsigned numTasks, unsigned numThreads, Task const &task)
+{
+    if (numThreads == 0)
+        numThreads = max(thread::hardware_concurrency(), 1u);
+    
+    numThreads = min(numThreads, numTasks);
+    atomic<unsigned> nextTask(0);
+    vector<exception_ptr> errors(max(numThreads, 1u));
+    
+    auto worker = [&](unsigned t)
+    {
+        try
+        {
+            for (unsigned i = nextTask++; i < numTasks; i = nextTask++)
+                task(i);
+        }
+        catch (...)
+        {
+            errors[t] = current_exception();
+            nextTask = numTasks;
+        }
+    };
+    
+    vector<thread> threads;
+    
+    for (unsigned t = 1; t < numThreads; ++t)
+        threads.emplace_back(worker, t);
+    
+    worker(0);
+    
+    for (auto &th: threads)
+        th.join();
+    
+    for (auto const &error: errors)
+    {
+        if (error)
+            rethrow_exception(error);
+    }
+}
@@ -0,0 +1,353 @@
+#include <PlotBatch.hpp>
+
+#include <StackRules.hpp>
+#include <Summation.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Copies an array into a buffer, or fills the buffer with the default value if it is empty
+    void CopyRow(ArrayView<double> const &src, double *dst, unsigned size, double defaultValue)
+    {
+        if (src.IsEmpty())
+        {
+            for (unsigned i = 0; i < size; ++i)
+                dst[i] = defaultValue;
+        }
+        else
+        {
+            for (unsigned i = 0; i < size; ++i)
+                dst[i] = src[i];
+        }
+    }
+}
+
+
+PlotBatch::PlotBatch(vector<PlotContent> const &plots_):
+    plots(plots_)
+{
+    if (plots.empty())
+        throw runtime_error("Cannot create an empty batch of plots.");
+    
+    PlotContent const &first = plots.front();
+    numPlots = plots.size();
+    numProcesses = first.processes.size();
+    numBins = first.GetNumBins();
+    
+    
+    // Check compatibility of all plots
+    for (auto const &p: plots)
+    {
+        p.Validate("plot \"" + p.title + "\" included in a batch");
+        bool compatible = (p.GetNumBins() == numBins and p.processes.size() == numProcesses);
+        
+        for (unsigned i = 0; compatible and i < numBins + 1; ++i)
+            compatible = (p.edges[i] == first.edges[i]);
+        
+        for (unsigned i = 0; compatible and i < numProcesses; ++i)
+            compatible = (p.processes[i].name == first.processes[i].name);
+        
+        if (not compatible)
+        {
+            ostringstream ost;
+            ost << "Plot \"" << p.title << "\" has a binning or a list of processes different " <<
+             "from plot \"" << first.title << "\" and cannot be included in the same batch.";
+            throw runtime_error(ost.str());
+        }
+    }
+    
+    
+    // Bin widths. Under- and overflow bins are given widths of the adjacent bins. No bins are
+    //blinded initially
+    unsigned const stride = numBins + 2;
+    widths = StackRules::GetWidths(first.edges);
+    masks.assign(numPlots, BinMask(numBins));
+    
+    
+    // Pack all contents. Missing sums of squared weights are replaced by contents, as for Poisson
+    //counts
+    mcContents.resize(size_t(numPlots) * numProcesses * stride);
+    mcSumw2.resize(mcContents.size());
+    dataContents.resize(size_t(numPlots) * stride);
+    dataVar.resize(dataContents.size());
+    systUp.resize(dataContents.size());
+    systDown.resize(dataContents.size());
+    
+    for (unsigned p = 0; p < numPlots; ++p)
+    {
+        PlotContent const &plot = plots[p];
+        
+        for (unsigned i = 0; i < numProcesses; ++i)
+        {
+            PlotContent::Hist const &h = plot.processes[i];
+            size_t const offset = (size_t(p) * numProcesses + i) * stride;
+            CopyRow(h.contents, mcContents.data() + offset, stride, 0.);
+            
+            if (h.sumw2.IsEmpty())
+                CopyRow(h.contents, mcSumw2.data() + offset, stride, 0.);
+            else
+                CopyRow(h.sumw2, mcSumw2.data() + offset, stride, 0.);
+        }
+        
+        size_t const offset = size_t(p) * stride;
+        CopyRow(plot.data.contents, dataContents.data() + offset, stride, 0.);
+        CopyRow((plot.data.sumw2.IsEmpty()) ? plot.data.contents : plot.data.sumw2,
+         dataVar.data() + offset, stride, 0.);
+        CopyRow(plot.systUp.contents, systUp.data() + offset, stride, 0.);
+        CopyRow(plot.systDown.contents, systDown.data() + offset, stride, 0.);
+    }
+}
+
+
+void PlotBatch::Compute(bool normalize, bool isDensity /*= false*/)
+{
+    unsigned const stride = numBins + 2;
+    size_t const matrixSize = size_t(numPlots) * stride;
+    
+    
+    // Totals and their sums of squared weights, summed with compensation (see Summation). Inputs
+    //are never modified, so that the method can be called several times
+    totals.resize(matrixSize);
+    totalSumw2.resize(matrixSize);
+    vector<ArrayView<double>> contentViews(numProcesses), sumw2Views(numProcesses);
+    vector<double> buffer;
+    
+    for (unsigned p = 0; p < numPlots; ++p)
+    {
+        for (unsigned i = 0; i < numProcesses; ++i)
+        {
+            size_t const offset = (size_t(p) * numProcesses + i) * stride;
+            contentViews[i] = ArrayView<double>(mcContents.data() + offset, stride);
+            sumw2Views[i] = ArrayView<double>(mcSumw2.data() + offset, stride);
+        }
+        
+        Summation::SumArrays(contentViews, buffer);
+        copy(buffer.begin(), buffer.end(), totals.begin() + size_t(p) * stride);
+        Summation::SumArrays(sumw2Views, buffer);
+        copy(buffer.begin(), buffer.end(), totalSumw2.begin() + size_t(p) * stride);
+    }
+    
+    
+    // Normalization factors from integrals of data and totals, computed in the same way as in
+    //DataMCPlot. Blinded bins are excluded
+    normFactors.assign(numPlots, 1.);
+    
+    if (normalize)
+    {
+        ArrayView<double> const weights = (isDensity) ?
+         ArrayView<double>(widths.data(), widths.size()) : ArrayView<double>();
+        
+        for (unsigned p = 0; p < numPlots; ++p)
+            normFactors[p] = StackRules::ComputeNormFactor(GetRow(dataContents, p),
+             GetRow(totals, p), masks[p], weights);
+    }
+    
+    
+    // Rescaled copies of all MC quantities, produced in a single pass over the tensor
+    unsigned const rowsPerPlot = numProcesses * stride;
+    scaledContents.resize(mcContents.size());
+    scaledSumw2.resize(mcSumw2.size());
+    scaledSystUp.resize(matrixSize);
+    scaledSystDown.resize(matrixSize);
+    
+    for (unsigned p = 0; p < numPlots; ++p)
+    {
+        double const f = normFactors[p], f2 = f * f;
+        size_t offset = size_t(p) * rowsPerPlot;
+        
+        for (unsigned i = 0; i < rowsPerPlot; ++i)
+        {
+            scaledContents[offset + i] = mcContents[offset + i] * f;
+            scaledSumw2[offset + i] = mcSumw2[offset + i] * f2;
+        }
+        
+        offset = size_t(p) * stride;
+        
+        for (unsigned b = 0; b < stride; ++b)
+        {
+            totals[offset + b] *= f;
+            totalSumw2[offset + b] *= f2;
+            scaledSystUp[offset + b] = systUp[offset + b] * f;
+            scaledSystDown[offset + b] = systDown[offset + b] * f;
+        }
+    }
+    
+    
+    // Residuals, relative bands, and chi2
+    residuals.assign(matrixSize, 0.);
+    residualErrors.assign(matrixSize, 0.);
+    relBandUp.assign(matrixSize, 0.);
+    relBandDown.assign(matrixSize, 0.);
+    chi2.assign(numPlots, 0.);
+    ndf.assign(numPlots, 0);
+    
+    for (unsigned p = 0; p < numPlots; ++p)
+    {
+        size_t const offset = size_t(p) * stride;
+        BinMask const &mask = masks[p];
+        double sum = 0.;
+        unsigned numTerms = 0;
+        
+        for (unsigned b = 0; b < stride; ++b)
+        {
+            double const t = totals[offset + b];
+            
+            if (t <= 0.)
+                continue;
+            
+            relBandUp[offset + b] = fabs(scaledSystUp[offset + b]) / t;
+            relBandDown[offset + b] = fabs(scaledSystDown[offset + b]) / t;
+            
+            
+            // Data in blinded bins must not enter any of the results
+            if (mask.IsMasked(b))
+                continue;
+            
+            double const d = dataContents[offset + b];
+            residuals[offset + b] = (d - t) / t;
+            residualErrors[offset + b] = sqrt(dataVar[offset + b]) / t;
+            
+            double const var = dataVar[offset + b] + totalSumw2[offset + b];
+            
+            if (b > 0 and b <= numBins and var > 0.)
+            {
+                sum += (d - t) * (d - t) / var;
+                ++numTerms;
+            }
+        }
+        
+        chi2[p] = sum;
+        ndf[p] = (normalize and numTerms > 0) ? numTerms - 1 : numTerms;
+    }
+}
+
+
+double PlotBatch::GetChi2(unsigned plot) const
+{
+    return chi2.at(plot);
+}
+
+
+PlotContent PlotBatch::GetContent(unsigned plot) const
+{
+    // Makes sure that the batch has been computed
+    GetRow(scaledSystUp, plot);
+    
+    PlotContent content(plots[plot]);
+    unsigned const stride = numBins + 2;
+    
+    for (unsigned i = 0; i < numProcesses; ++i)
+    {
+        size_t const offset = (size_t(plot) * numProcesses + i) * stride;
+        content.processes[i].contents = ArrayView<double>(scaledContents.data() + offset, stride);
+        content.processes[i].sumw2 = ArrayView<double>(scaledSumw2.data() + offset, stride);
+    }
+    
+    if (content.HasSystematics())
+    {
+        content.systUp.contents = GetRow(scaledSystUp, plot);
+        content.systDown.contents = GetRow(scaledSystDown, plot);
+    }
+    
+    return content;
+}
+
+
+void PlotBatch::SetBlinding(unsigned plot, BinMask const &mask)
+{
+    if (plot >= numPlots)
+    {
+        ostringstream ost;
+        ost << "Cannot blind plot with index " << plot << " in a batch of " << numPlots <<
+         " plots.";
+        throw runtime_error(ost.str());
+    }
+    
+    if (not mask.IsActive())
+        masks[plot] = BinMask(numBins);
+    else if (mask.GetNumBins() != numBins)
+    {
+        ostringstream ost;
+        ost << "Mask for " << mask.GetNumBins() << " bins cannot be applied to plot \"" <<
+         plots[plot].title << "\" with " << numBins << " bins.";
+        throw runtime_error(ost.str());
+    }
+    else
+        masks[plot] = mask;
+}
+
+
+unsigned PlotBatch::GetNdf(unsigned plot) const
+{
+    return ndf.at(plot);
+}
+
+
+double PlotBatch::GetNormFactor(unsigned plot) const
+{
+    return normFactors.at(plot);
+}
+
+
+unsigned PlotBatch::GetNumBins() const
+{
+    return numBins;
+}
+
+
+unsigned PlotBatch::GetNumPlots() const
+{
+    return numPlots;
+}
+
+
+ArrayView<double> PlotBatch::GetRelBandDown(unsigned plot) const
+{
+    return GetRow(relBandDown, plot);
+}
+
+
+ArrayView<double> PlotBatch::GetRelBandUp(unsigned plot) const
+{
+    return GetRow(relBandUp, plot);
+}
+
+
+ArrayView<double> PlotBatch::GetResiduals(unsigned plot) const
+{
+    return GetRow(residuals, plot);
+}
+
+
+ArrayView<double> PlotBatch::GetResidualErrors(unsigned plot) const
+{
+    return GetRow(residualErrors, plot);
+}
+
+
+ArrayView<double> PlotBatch::GetTotal(unsigned plot) const
+{
+    return GetRow(totals, plot);
+}
+
+
+ArrayView<double> PlotBatch::GetRow(vector<double> const &matrix, unsigned row) const
+{
+    if (row >= numPlots or matrix.empty())
+    {
+        ostringstream ost;
+        ost << "Plot with index " << row << " is not available in a batch of " << numPlots <<
+         " plots, or the batch has not been computed.";
+        throw runtime_error(ost.str());
+    }
+    
+    return ArrayView<double>(matrix.data() + size_t(row) * (numBins + 2), numBins + 2);
+}
@@ -0,0 +1,105 @@
+#include <PlotContent.hpp>
+
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+PlotContent::Hist::Hist():
+    colour(-1)
+{}
+
+
+unsigned PlotContent::GetNumBins() const
+{
+    return (edges.GetSize() > 0) ? edges.GetSize() - 1 : 0;
+}
+
+
+bool PlotContent::HasSystematics() const
+{
+    return (not systUp.contents.IsEmpty() and not systDown.contents.IsEmpty());
+}
+
+
+PlotContent::Hist const *PlotContent::FindHist(string const &name) const
+{
+    if (name == data.name)
+        return &data;
+    
+    for (auto const &p: processes)
+    {
+        if (p.name == name)
+            return &p;
+    }
+    
+    
+    // If this point is reached, the requested histogram has not been found
+    return nullptr;
+}
+
+
+ArrayView<double> PlotContent::Adopt(vector<double> &&buffer)
+{
+    shared_ptr<vector<double>> owner(new vector<double>(move(buffer)));
+    owners.emplace_back(owner);
+    return ArrayView<double>(owner->data(), owner->size());
+}
+
+
+void PlotContent::KeepAlive(shared_ptr<void const> const &owner)
+{
+    owners.emplace_back(owner);
+}
+
+
+void PlotContent::Validate(string const &source) const
+{
+    if (edges.GetSize() < 2)
+    {
+        ostringstream ost;
+        ost << "Binning is not defined in " << source << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    if (data.contents.IsEmpty())
+    {
+        ostringstream ost;
+        ost << "Failed to find data histogram in " << source << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    if (processes.size() == 0)
+    {
+        ostringstream ost;
+        ost << "Failed to find any MC histograms in " << source << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Make sure that all histograms are compatible with the binning
+    unsigned const expectedSize = GetNumBins() + 2;
+    vector<Hist const *> hists{&data, &systUp, &systDown};
+    
+    for (auto const &p: processes)
+        hists.push_back(&p);
+    
+    for (auto const &h: hists)
+    {
+        bool const optional = (h == &systUp or h == &systDown);
+        
+        if ((optional and h->contents.IsEmpty()) or h->contents.GetSize() == expectedSize)
+        {
+            if (h->sumw2.IsEmpty() or h->sumw2.GetSize() == expectedSize)
+                continue;
+        }
+        
+        ostringstream ost;
+        ost << "Histogram \"" << h->name << "\" in " << source << " has " <<
+         h->contents.GetSize() << " bins while " << expectedSize <<
+         " are expected (including under- and overflow bins).";
+        throw runtime_error(ost.str());
+    }
+}
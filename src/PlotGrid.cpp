@@ -0,0 +1,205 @@
+#include <PlotGrid.hpp>
+
+#include <CanvasPool.hpp>
+#include <PlotStyle.hpp>
+
+#include <TFile.h>
+#include <TLatex.h>
+#include <TLegend.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Fraction of the canvas width occupied by the column with the legend
+    double const legendColumn = 0.12;
+    
+    /// Fractions of the canvas size reserved for shared axis titles and labels at its edges
+    double const leftEdge = 0.03, bottomEdge = 0.04, topEdge = 0.04;
+}
+
+
+PlotGrid::PlotGrid(unsigned numColumns_, unsigned numRows_, unsigned panelWidth_ /*= 600*/,
+ unsigned panelHeight_ /*= 500*/):
+    numColumns(numColumns_), numRows(numRows_),
+    panelWidth(panelWidth_), panelHeight(panelHeight_)
+{
+    if (numColumns == 0 or numRows == 0)
+        throw runtime_error("A grid of plots must contain at least one panel.");
+}
+
+
+PlotGrid::~PlotGrid()
+{
+    // Figures are deleted first as their pads are nested in the panels
+    plots.clear();
+    
+    for (auto objIt = ownedObjects.rbegin(); objIt != ownedObjects.rend(); ++objIt)
+        delete *objIt;
+    
+    CanvasPool::Release(canvas, gridPad);
+}
+
+
+void PlotGrid::AddPlot(unique_ptr<DataMCPlot> &&plot)
+{
+    if (plots.size() == numColumns * numRows)
+    {
+        ostringstream ost;
+        ost << "Cannot add a plot to a grid with " << numColumns << " x " << numRows <<
+         " panels since all of them are taken.";
+        throw runtime_error(ost.str());
+    }
+    
+    plots.emplace_back(move(plot));
+}
+
+
+void PlotGrid::AddCMSLabel(string const &additionalText /*= ""*/)
+{
+    if (not canvas)
+        throw logic_error("Cannot add CMS label before the grid is drawn.");
+    
+    
+    ostringstream label;
+    label << "#scale[1.2]{#font[62]{CMS}} #font[52]{" << additionalText << "}";
+    
+    TLatex *cmsLabel = NewOwnedObject<TLatex>(leftEdge, 1. - 0.5 * topEdge, label.str().c_str());
+    PlotStyle::ConfigureLabel(*cmsLabel, 12);
+    
+    canvas->cd();
+    cmsLabel->Draw();
+}
+
+
+void PlotGrid::AddEnergyLabel(string const &text)
+{
+    if (not canvas)
+        throw logic_error("Cannot add energy label before the grid is drawn.");
+    
+    
+    TLatex *energyLabel = NewOwnedObject<TLatex>(1. - legendColumn, 1. - 0.5 * topEdge,
+     text.c_str());
+    PlotStyle::ConfigureLabel(*energyLabel, 32);
+    
+    canvas->cd();
+    energyLabel->Draw();
+}
+
+
+TCanvas &PlotGrid::Draw()
+{
+    if (plots.empty())
+        throw logic_error("Cannot draw a grid without plots.");
+    
+    
+    // Create the canvas. The pad obtained from the pool hosts the panels
+    unsigned const width = numColumns * panelWidth / (1. - legendColumn - leftEdge);
+    unsigned const height = numRows * panelHeight / (1. - topEdge - bottomEdge);
+    CanvasPool::Acquire(width, height, canvas, gridPad);
+    
+    gridPad->SetPad(leftEdge, bottomEdge, 1. - legendColumn, 1. - topEdge);
+    gridPad->SetMargin(0., 0., 0., 0.);
+    gridPad->SetFillStyle(0);
+    
+    canvas->cd();
+    gridPad->Draw();
+    
+    
+    // Draw each figure in its own panel
+    for (unsigned i = 0; i < plots.size(); ++i)
+    {
+        unsigned const column = i % numColumns, row = i / numColumns;
+        ostringstream name;
+        name << "panel" << i;
+        
+        TPad *panel = NewOwnedObject<TPad>(name.str().c_str(), "", double(column) / numColumns,
+         1. - double(row + 1) / numRows, double(column + 1) / numColumns,
+         1. - double(row) / numRows);
+        panel->SetFillStyle(0);
+        
+        gridPad->cd();
+        panel->Draw();
+        plots[i]->DrawInPad(*panel, false);
+        
+        
+        // Write the plain title of the figure in the corner of the panel
+        string const &title = plots[i]->GetTitle();
+        string const panelTitle(title.substr(0, title.find_first_of(';')));
+        
+        if (not panelTitle.empty())
+        {
+            TLatex *label = NewOwnedObject<TLatex>(PlotStyle::margin + 0.02, 0.96,
+             panelTitle.c_str());
+            PlotStyle::ConfigureLabel(*label, 13);
+            
+            panel->cd();
+            label->Draw();
+        }
+    }
+    
+    
+    // Shared axis titles are taken from the first figure
+    string const &title = plots.front()->GetTitle();
+    auto const pos1 = title.find_first_of(';');
+    auto const pos2 = title.find_first_of(';', pos1 + 1);
+    string const xAxisTitle(title.substr(pos1 + 1, pos2 - pos1 - 1));
+    string const yAxisTitle((pos2 == string::npos) ? "" : title.substr(pos2 + 1));
+    
+    TLatex *xLabel = NewOwnedObject<TLatex>(1. - legendColumn, 0.5 * bottomEdge,
+     xAxisTitle.c_str());
+    PlotStyle::ConfigureLabel(*xLabel, 32);
+    
+    TLatex *yLabel = NewOwnedObject<TLatex>(0.5 * leftEdge, 1. - topEdge, yAxisTitle.c_str());
+    PlotStyle::ConfigureLabel(*yLabel, 33);
+    yLabel->SetTextAngle(90.);
+    
+    canvas->cd();
+    xLabel->Draw();
+    yLabel->Draw();
+    
+    
+    // Move the legend of the first figure into its column
+    TLegend &legend = *plots.front()->GetLegend();
+    double const legendHeight = legend.GetY2NDC() - legend.GetY1NDC();
+    legend.SetX1NDC(1. - legendColumn + 0.01);
+    legend.SetX2NDC(0.99);
+    legend.SetY2NDC(1. - topEdge);
+    legend.SetY1NDC(1. - topEdge - legendHeight);
+    
+    legend.Draw();
+    
+    
+    return *canvas;
+}
+
+
+vector<unique_ptr<DataMCPlot>> const &PlotGrid::GetPlots() const
+{
+    return plots;
+}
+
+
+void PlotGrid::Print(string const &fileName)
+{
+    // If the output is not a ROOT file, simply call TCanvas::Print
+    if (not boost::ends_with(fileName, ".root"))
+    {
+        canvas->Print(fileName.c_str());
+        return;
+    }
+    
+    
+    TFile outFile(fileName.c_str(), "recreate");
+    outFile.cd();
+    canvas->Write();
+    plots.front()->GetLegend()->Write();
+    outFile.Close();
+}
@@ -0,0 +1,36 @@
+#include <PlotReader.hpp>
+
+#include <ArrowReader.hpp>
+#include <NpzReader.hpp>
+#include <RootFileReader.hpp>
+#include <UhiReader.hpp>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+unique_ptr<PlotReader> PlotReader::Open(string const &fileName)
+{
+    if (boost::iends_with(fileName, ".npz"))
+        return unique_ptr<PlotReader>(new NpzReader(fileName));
+    
+    if (boost::iends_with(fileName, ".arrow") or boost::iends_with(fileName, ".feather") or
+     boost::iends_with(fileName, ".ipc"))
+        return unique_ptr<PlotReader>(new ArrowReader(fileName));
+    
+    if (boost::iends_with(fileName, ".json"))
+        return unique_ptr<PlotReader>(new UhiReader(fileName));
+    
+    if (boost::iends_with(fileName, ".root"))
+        return unique_ptr<PlotReader>(new RootFileReader(fileName));
+    
+    
+    ostringstream ost;
+    ost << "Cannot deduce format of file \"" << fileName << "\" from its extension.";
+    throw runtime_error(ost.str());
+}
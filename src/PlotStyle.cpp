@@ -0,0 +1,80 @@
+#include <PlotStyle.hpp>
+
+#include <TAxis.h>
+#include <TGaxis.h>
+#include <TH1.h>
+#include <TLatex.h>
+#include <TPad.h>
+#include <TStyle.h>
+
+
+double const PlotStyle::margin = 0.1;
+double const PlotStyle::mainPadWidth = 0.85;
+double const PlotStyle::lowerPadHeight = 0.17;
+
+
+void PlotStyle::ConfigureLabel(TLatex &label, short align)
+{
+    label.SetNDC();
+    label.SetTextFont(42);
+    label.SetTextSize(0.04);
+    label.SetTextAlign(align);
+}
+
+
+void PlotStyle::ConfigureLowerPad(TPad &pad, bool hostsXLabels)
+{
+    // Adjust the pad's margins so that axis labels are not cropped
+    pad.SetLeftMargin(margin / pad.GetWNDC());
+    pad.SetRightMargin(margin / pad.GetWNDC());
+    pad.SetBottomMargin((hostsXLabels) ? margin / pad.GetHNDC() : 0.);
+    pad.SetTopMargin(0.);
+    
+    
+    // Decoration of the pad
+    pad.SetTicks();
+    pad.SetGrid(0, 1);
+    
+    pad.SetFillStyle(0);
+    //^ Needed not to oscure the lower half of the zero label in the main pad
+}
+
+
+void PlotStyle::MatchLowerAxes(TH1 &hist, TAxis const &mainXAxis, TPad const &mainPad,
+ TPad const &lowerPad, double frameHeightRatio)
+{
+    TAxis *xAxis = hist.GetXaxis();
+    TAxis *yAxis = hist.GetYaxis();
+    double const scale = mainPad.GetHNDC() / lowerPad.GetHNDC();
+    
+    xAxis->SetTitleSize(mainXAxis.GetTitleSize() * scale);
+    xAxis->SetLabelSize(mainXAxis.GetLabelSize() * scale);
+    yAxis->SetTitleSize(mainXAxis.GetTitleSize() * scale);
+    yAxis->SetLabelSize(mainXAxis.GetLabelSize() * scale);
+    
+    yAxis->SetNdivisions(404);
+    yAxis->CenterTitle();
+    yAxis->SetTitleOffset(0.33);
+    xAxis->SetTickLength(xAxis->GetTickLength() * frameHeightRatio);
+}
+
+
+void PlotStyle::SetGlobal()
+{
+    gStyle->SetErrorX(0.);
+    gStyle->SetHistMinimumZero(true);
+    gStyle->SetOptStat(0);
+    gStyle->SetStripDecimals(false);
+    TGaxis::SetMaxDigits(3);
+    
+    gStyle->SetTitleFont(42);
+    gStyle->SetTitleFontSize(0.04);
+    gStyle->SetTitleFont(42, "XYZ");
+    gStyle->SetTitleXOffset(0.9);
+    gStyle->SetTitleYOffset(1.0);
+    gStyle->SetTitleSize(0.045, "XYZ");
+    gStyle->SetLabelFont(42, "XYZ");
+    gStyle->SetLabelOffset(0.007, "XYZ");
+    gStyle->SetLabelSize(0.04, "XYZ");
+    gStyle->SetNdivisions(508, "XYZ");
+}
@@ -0,0 +1,925 @@
+#include <RootFileReader.hpp>
+
+#include <MappedFile.hpp>
+#include <Parallel.hpp>
+
+#include <zlib.h>
+
+#ifdef HEP_PLOT_UTILS_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /**
+     * \class BufferReader
+     * \brief Sequential reader of big-endian data in ROOT's serialisation format
+     * 
+     * All reads are checked against the boundaries of the buffer.
+     */
+    class BufferReader
+    {
+    public:
+        /// Constructor
+        BufferReader(char const *buffer_, size_t size_, size_t pos_ = 0):
+            buffer(buffer_), size(size_), pos(pos_)
+        {}
+        
+    public:
+        /// Returns the current position
+        size_t GetPos() const
+        {
+            return pos;
+        }
+        
+        /// Moves to the given position
+        void SetPos(size_t pos_)
+        {
+            pos = pos_;
+        }
+        
+        /// Skips the given number of bytes
+        void Skip(size_t n)
+        {
+            Require(n);
+            pos += n;
+        }
+        
+        /// Reads an unsigned integer of the given size
+        template<typename T>
+        T Read()
+        {
+            Require(sizeof(T));
+            uint64_t value = 0;
+            
+            for (unsigned i = 0; i < sizeof(T); ++i)
+                value = (value << 8) | uint8_t(buffer[pos + i]);
+            
+            pos += sizeof(T);
+            return T(value);
+        }
+        
+        /// Reads a double-precision number
+        double ReadDouble()
+        {
+            uint64_t const bits = Read<uint64_t>();
+            double value;
+            memcpy(&value, &bits, 8);
+            return value;
+        }
+        
+        /// Reads a single-precision number
+        float ReadFloat()
+        {
+            uint32_t const bits = Read<uint32_t>();
+            float value;
+            memcpy(&value, &bits, 4);
+            return value;
+        }
+        
+        /// Reads a TString
+        string ReadString()
+        {
+            uint32_t length = Read<uint8_t>();
+            
+            if (length == 255)
+                length = Read<uint32_t>();
+            
+            Require(length);
+            string const result(buffer + pos, length);
+            pos += length;
+            return result;
+        }
+        
+        /**
+         * \brief Reads the byte count and version of a streamed object
+         * 
+         * Returns the position of the end of the object, or zero if the byte count is absent.
+         */
+        size_t ReadVersion(int16_t &version)
+        {
+            uint32_t const byteCount = Read<uint32_t>();
+            
+            if (byteCount & 0x40000000)
+            {
+                size_t const end = pos + (byteCount & ~0x40000000u);
+                version = Read<int16_t>();
+                return end;
+            }
+            
+            
+            // There is no byte count, the first two bytes encode the version
+            pos -= 4;
+            version = Read<int16_t>();
+            return 0;
+        }
+        
+        /// Reads a TObject base and skips it
+        void SkipTObject()
+        {
+            Skip(2 + 4);  // version and unique ID
+            uint32_t const bits = Read<uint32_t>();
+            
+            if (bits & (1 << 4))  // kIsReferenced
+                Skip(2);
+        }
+        
+        /// Skips an object that has a byte count
+        void SkipVersioned()
+        {
+            int16_t version;
+            size_t const end = ReadVersion(version);
+            
+            if (end == 0)
+                throw runtime_error("Cannot skip an object streamed without byte count.");
+            
+            SetPos(end);
+        }
+        
+        /// Reads an array of numbers prefixed with its length and converts it to doubles
+        template<typename T>
+        vector<double> ReadArray()
+        {
+            int32_t const length = Read<int32_t>();
+            
+            if (length < 0)
+                throw runtime_error("Negative length of an array in ROOT file.");
+            
+            Require(length * sizeof(T));
+            vector<double> result(length);
+            
+            for (auto &v: result)
+                v = ReadNumber<T>();
+            
+            return result;
+        }
+        
+    private:
+        /// Throws an exception if fewer than the given number of bytes remain
+        void Require(size_t n) const
+        {
+            if (pos + n > size or pos + n < pos)
+                throw runtime_error("Unexpected end of buffer while reading ROOT file.");
+        }
+        
+        /// Reads a number of the given type
+        template<typename T>
+        T ReadNumber();
+        
+    private:
+        /// Buffer with data
+        char const *buffer;
+        
+        /// Size of the buffer
+        size_t size;
+        
+        /// Current position
+        size_t pos;
+    };
+    
+    
+    template<>
+    double BufferReader::ReadNumber<double>()
+    {
+        return ReadDouble();
+    }
+    
+    
+    template<>
+    float BufferReader::ReadNumber<float>()
+    {
+        return ReadFloat();
+    }
+    
+    
+    template<>
+    int32_t BufferReader::ReadNumber<int32_t>()
+    {
+        return Read<int32_t>();
+    }
+    
+    
+    template<>
+    int16_t BufferReader::ReadNumber<int16_t>()
+    {
+        return Read<int16_t>();
+    }
+    
+    
+    template<>
+    int8_t BufferReader::ReadNumber<int8_t>()
+    {
+        return Read<int8_t>();
+    }
+    
+    
+    /**
+     * \brief Computes a 64-bit checksum of a buffer
+     * 
+     * The buffer is processed in 8-byte words, each mixed into the state with a multiplication
+     * and a rotation, which is several times faster than bytewise hashes such as FNV-1a. The
+     * checksum is not cryptographic but is well suited to detect accidental changes.
+     */
+    uint64_t ComputeChecksum(char const *data, size_t size)
+    {
+        uint64_t const prime = 0x9E3779B97F4A7C15ull;
+        uint64_t h = 0xCBF29CE484222325ull;
+        size_t pos = 0;
+        
+        for (; pos + 8 <= size; pos += 8)
+        {
+            uint64_t word;
+            memcpy(&word, data + pos, 8);
+            h = (h ^ (word * prime)) * 0xFF51AFD7ED558CCDull;
+            h = (h << 29) | (h >> 35);
+        }
+        
+        uint64_t tail = 0;
+        memcpy(&tail, data + pos, size - pos);
+        h = (h ^ (tail * prime)) * 0xFF51AFD7ED558CCDull;
+        
+        
+        // The size is mixed in to distinguish trailing zeros from padding of the last word. It is
+        //followed by an avalanche so that all bits of the state affect all bits of the result
+        h = (h ^ size) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        
+        return h;
+    }
+    
+    
+    /**
+     * \brief Decompresses a block in LZ4 format
+     * 
+     * Returns the number of bytes written. Throws an exception if the input is malformed.
+     */
+    size_t DecompressLZ4(char const *src, size_t srcSize, char *dst, size_t dstSize)
+    {
+        size_t ip = 0, op = 0;
+        
+        while (ip < srcSize)
+        {
+            unsigned const token = uint8_t(src[ip++]);
+            
+            
+            // Copy literals
+            size_t literalLength = token >> 4;
+            
+            if (literalLength == 15)
+            {
+                unsigned b;
+                
+                do
+                {
+                    if (ip >= srcSize)
+                        throw runtime_error("Malformed LZ4 block in ROOT file.");
+                    
+                    b = uint8_t(src[ip++]);
+                    literalLength += b;
+                }
+                while (b == 255);
+            }
+            
+            if (ip + literalLength > srcSize or op + literalLength > dstSize)
+                throw runtime_error("Malformed LZ4 block in ROOT file.");
+            
+            memcpy(dst + op, src + ip, literalLength);
+            ip += literalLength;
+            op += literalLength;
+            
+            
+            // The last sequence contains only literals
+            if (ip >= srcSize)
+                break;
+            
+            
+            // Copy the match, which might overlap with the output being written
+            if (ip + 2 > srcSize)
+                throw runtime_error("Malformed LZ4 block in ROOT file.");
+            
+            size_t const offset = uint8_t(src[ip]) | (uint8_t(src[ip + 1]) << 8);
+            ip += 2;
+            
+            size_t matchLength = token & 0x0F;
+            
+            if (matchLength == 15)
+            {
+                unsigned b;
+                
+                do
+                {
+                    if (ip >= srcSize)
+                        throw runtime_error("Malformed LZ4 block in ROOT file.");
+                    
+                    b = uint8_t(src[ip++]);
+                    matchLength += b;
+                }
+                while (b == 255);
+            }
+            
+            matchLength += 4;
+            
+            if (offset == 0 or offset > op or op + matchLength > dstSize)
+                throw runtime_error("Malformed LZ4 block in ROOT file.");
+            
+            for (size_t i = 0; i < matchLength; ++i, ++op)
+                dst[op] = dst[op - offset];
+        }
+        
+        return op;
+    }
+    
+}
+
+
+RootFileReader::RootFileReader(string const &fileName):
+    file(new MappedFile(fileName))
+{
+    // Parse the file header. Files larger than 2 GB use 64-bit pointers
+    if (file->GetSize() < 64 or memcmp(file->GetData(), "root", 4) != 0)
+    {
+        ostringstream ost;
+        ost << "File \"" << fileName << "\" is not a valid ROOT file.";
+        throw runtime_error(ost.str());
+    }
+    
+    BufferReader header(file->GetData(), file->GetSize(), 4);
+    int32_t const version = header.Read<int32_t>();
+    bool const isLarge = (version >= 1000000);
+    
+    uint32_t const begin = header.Read<uint32_t>();
+    header.Skip((isLarge) ? 8 + 8 : 4 + 4);  // fEND, fSeekFree
+    header.Skip(4 + 4);  // fNbytesFree, nfree
+    uint32_t const numBytesName = header.Read<uint32_t>();
+    
+    
+    // The record of the top-level directory follows the key of the file and its name and title
+    topDirPos = begin + numBytesName;
+}
+
+
+PlotContent RootFileReader::Read(string const &dirName /*= ""*/) const
+{
+    PlotContent content;
+    
+    ostringstream source;
+    source << "file \"" << file->GetFileName() << "\", directory \"" << dirName << "\"";
+    
+    vector<Key> const keys(FindDirectory(dirName));
+    
+    
+    // Deserialise the histograms. Their contents are adopted by the plot content
+    bool edgesSet = false;
+    
+    for (auto const &key: keys)
+    {
+        if (key.name == "title" and key.className == "TObjString")
+        {
+            content.title = ReadObjString(key);
+            continue;
+        }
+        
+        if (not IsHist(key.className))
+            continue;
+        
+        
+        PlotContent::Hist *target;
+        
+        if (key.name == "data")
+            target = &content.data;
+        else if (key.name == "syst_up")
+            target = &content.systUp;
+        else if (key.name == "syst_down")
+            target = &content.systDown;
+        else
+        {
+            content.processes.emplace_back();
+            target = &content.processes.back();
+        }
+        
+        Hist hist(ReadHist(key));
+        
+        if (not edgesSet)
+        {
+            content.edges = content.Adopt(move(hist.edges));
+            edgesSet = true;
+        }
+        
+        target->name = key.name;
+        target->title = hist.title;
+        target->colour = hist.fillColour;
+        target->contents = content.Adopt(move(hist.contents));
+        
+        if (not hist.sumw2.empty())
+            target->sumw2 = content.Adopt(move(hist.sumw2));
+    }
+    
+    
+    content.Validate(source.str());
+    return content;
+}
+
+
+vector<string> RootFileReader::GetKeyNames(string const &dirName /*= ""*/) const
+{
+    vector<string> names;
+    
+    for (auto const &key: FindDirectory(dirName))
+        names.push_back(key.name);
+    
+    return names;
+}
+
+
+bool RootFileReader::HasDirectory(string const &dirName) const
+{
+    vector<Key> keys;
+    return LookUpDirectory(dirName, keys);
+}
+
+
+vector<RootFileReader::ObjectDigest> RootFileReader::GetDigests(string const &dirName /*= ""*/)
+ const
+{
+    vector<ObjectDigest> digests;
+    
+    for (auto const &key: FindDirectory(dirName))
+    {
+        ObjectDigest digest;
+        digest.name = key.name;
+        digest.className = key.className;
+        digest.storedSize = key.numBytes - key.keyLength;
+        digest.objLength = key.objLength;
+        digest.checksum = 0;
+        
+        if (not IsDirectory(key.className))
+        {
+            size_t const start = key.seekKey + key.keyLength;
+            
+            if (start + digest.storedSize > file->GetSize())
+            {
+                ostringstream ost;
+                ost << "Object \"" << key.name << "\" in file \"" << file->GetFileName() <<
+                 "\" is truncated.";
+                throw runtime_error(ost.str());
+            }
+            
+            digest.checksum = ComputeChecksum(file->GetData() + start, digest.storedSize);
+        }
+        
+        digests.emplace_back(move(digest));
+    }
+    
+    return digests;
+}
+
+
+vector<RootFileReader::PlotInfo> RootFileReader::FindPlots(string const &dirName /*= ""*/,
+ unsigned numThreads /*= 0*/) const
+{
+    string path(dirName);
+    
+    while (not path.empty() and path.back() == '/')
+        path.pop_back();
+    
+    
+    // Examine the starting directory and list its subdirectories, which are the roots of the
+    //branches processed in parallel
+    vector<Key> const keys(FindDirectory(path));
+    vector<PlotInfo> plots;
+    CollectPlots(path, keys, plots, false);
+    
+    vector<Key> branches;
+    
+    for (auto const &key: keys)
+    {
+        if (IsDirectory(key.className))
+            branches.emplace_back(key);
+    }
+    
+    
+    // Each branch is traversed serially into its own list. The lists are concatenated in the
+    //order of the branches so that the result does not depend on the scheduling
+    vector<vector<PlotInfo>> branchPlots(branches.size());
+    
+    Parallel::Run(branches.size(), numThreads, [&](unsigned i)
+    {
+        Key const &key = branches[i];
+        CollectPlots((path.empty()) ? key.name : path + "/" + key.name,
+         ReadDirectory(key.seekKey + key.keyLength), branchPlots[i]);
+    });
+    
+    for (auto &b: branchPlots)
+        move(b.begin(), b.end(), back_inserter(plots));
+    
+    return plots;
+}
+
+
+vector<PlotContent> RootFileReader::ReadAll(vector<string> const &dirNames,
+ unsigned numThreads /*= 0*/) const
+{
+    vector<PlotContent> plots(dirNames.size());
+    
+    Parallel::Run(dirNames.size(), numThreads, [&](unsigned i)
+    {
+        plots[i] = Read(dirNames[i]);
+    });
+    
+    return plots;
+}
+
+
+bool RootFileReader::IsDirectory(string const &className)
+{
+    return (className == "TDirectory" or className == "TDirectoryFile");
+}
+
+
+vector<RootFileReader::Key> RootFileReader::ReadDirectory(uint64_t recordPos) const
+{
+    // Read the directory record to find the list of keys
+    BufferReader record(file->GetData(), file->GetSize(), recordPos);
+    int16_t const dirVersion = record.Read<int16_t>();
+    record.Skip(4 + 4 + 4 + 4);  // fDatimeC, fDatimeM, fNbytesKeys, fNbytesName
+    
+    uint64_t seekKeys;
+    
+    if (dirVersion > 1000)
+    {
+        record.Skip(8 + 8);  // fSeekDir, fSeekParent
+        seekKeys = record.Read<uint64_t>();
+    }
+    else
+    {
+        record.Skip(4 + 4);
+        seekKeys = record.Read<uint32_t>();
+    }
+    
+    
+    // The list of keys starts with a key of its own, which is skipped
+    BufferReader keysReader(file->GetData(), file->GetSize(), seekKeys + 4 + 2 + 4 + 4);
+    uint16_t const listKeyLength = keysReader.Read<uint16_t>();
+    keysReader.SetPos(seekKeys + listKeyLength);
+    int32_t const numKeys = keysReader.Read<int32_t>();
+    
+    vector<Key> keys;
+    map<string, size_t> indices;
+    
+    for (int32_t i = 0; i < numKeys; ++i)
+    {
+        Key key;
+        key.numBytes = keysReader.Read<uint32_t>();
+        int16_t const keyVersion = keysReader.Read<int16_t>();
+        key.objLength = keysReader.Read<uint32_t>();
+        keysReader.Skip(4);  // fDatime
+        key.keyLength = keysReader.Read<uint16_t>();
+        key.cycle = keysReader.Read<int16_t>();
+        
+        if (keyVersion > 1000)
+        {
+            key.seekKey = keysReader.Read<uint64_t>();
+            keysReader.Skip(8);  // fSeekPdir
+        }
+        else
+        {
+            key.seekKey = keysReader.Read<uint32_t>();
+            keysReader.Skip(4);
+        }
+        
+        key.className = keysReader.ReadString();
+        key.name = keysReader.ReadString();
+        key.title = keysReader.ReadString();
+        
+        
+        // Keep only the highest cycle, preserving the order of the first occurrence
+        auto const res = indices.insert({key.name, keys.size()});
+        
+        if (res.second)
+            keys.emplace_back(key);
+        else if (keys[res.first->second].cycle < key.cycle)
+            keys[res.first->second] = key;
+    }
+    
+    return keys;
+}
+
+
+vector<RootFileReader::Key> RootFileReader::FindDirectory(string const &dirName) const
+{
+    vector<Key> keys;
+    
+    if (not LookUpDirectory(dirName, keys))
+    {
+        ostringstream ost;
+        ost << "Source file \"" << file->GetFileName() << "\" does not contain a directory \"" <<
+         dirName << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    return keys;
+}
+
+
+bool RootFileReader::LookUpDirectory(string const &dirName, vector<Key> &keys) const
+{
+    keys = ReadDirectory(topDirPos);
+    size_t start = 0;
+    
+    while (start < dirName.length())
+    {
+        size_t end = dirName.find('/', start);
+        
+        if (end == string::npos)
+            end = dirName.length();
+        
+        string const name(dirName.substr(start, end - start));
+        start = end + 1;
+        
+        if (name.empty())
+            continue;
+        
+        
+        // The record of a subdirectory is stored uncompressed in place of the object
+        auto const keyIt = find_if(keys.begin(), keys.end(), [&name](Key const &key)
+        {
+            return (key.name == name and IsDirectory(key.className));
+        });
+        
+        if (keyIt == keys.end())
+            return false;
+        
+        keys = ReadDirectory(keyIt->seekKey + keyIt->keyLength);
+    }
+    
+    return true;
+}
+
+
+void RootFileReader::CollectPlots(string const &dirName, vector<Key> const &keys,
+ vector<PlotInfo> &plots, bool recursive /*= true*/) const
+{
+    // Classify histograms following the conventions of Read
+    Key const *dataKey = nullptr;
+    unsigned numProcesses = 0;
+    bool hasSystUp = false, hasSystDown = false;
+    
+    for (auto const &key: keys)
+    {
+        if (not IsHist(key.className))
+            continue;
+        
+        if (key.name == "data")
+            dataKey = &key;
+        else if (key.name == "syst_up")
+            hasSystUp = true;
+        else if (key.name == "syst_down")
+            hasSystDown = true;
+        else
+            ++numProcesses;
+    }
+    
+    if (dataKey)
+    {
+        PlotInfo info;
+        info.dirName = dirName;
+        info.numProcesses = numProcesses;
+        info.numBins = ReadHist(*dataKey).edges.size() - 1;
+        info.hasSystematics = (hasSystUp and hasSystDown);
+        plots.emplace_back(info);
+    }
+    
+    
+    if (not recursive)
+        return;
+    
+    for (auto const &key: keys)
+    {
+        if (IsDirectory(key.className))
+            CollectPlots((dirName.empty()) ? key.name : dirName + "/" + key.name,
+             ReadDirectory(key.seekKey + key.keyLength), plots);
+    }
+}
+
+
+bool RootFileReader::IsHist(string const &className)
+{
+    return (className == "TH1D" or className == "TH1F" or className == "TH1I" or
+     className == "TH1S" or className == "TH1C");
+}
+
+
+vector<char> RootFileReader::ReadObject(Key const &key) const
+{
+    vector<char> result(key.objLength);
+    size_t const compressedSize = key.numBytes - key.keyLength;
+    size_t const start = key.seekKey + key.keyLength;
+    
+    if (start + compressedSize > file->GetSize())
+    {
+        ostringstream ost;
+        ost << "Object \"" << key.name << "\" in file \"" << file->GetFileName() <<
+         "\" is truncated.";
+        throw runtime_error(ost.str());
+    }
+    
+    char const *src = file->GetData() + start;
+    
+    
+    // Objects that are not compressed are copied as is
+    if (compressedSize == key.objLength)
+    {
+        memcpy(result.data(), src, key.objLength);
+        return result;
+    }
+    
+    
+    // A compressed object consists of one or more blocks, each with a 9-byte header that
+    //specifies the algorithm and compressed and uncompressed sizes
+    char const *const srcEnd = src + compressedSize;
+    size_t produced = 0;
+    
+    while (produced < key.objLength)
+    {
+        if (src + 9 > srcEnd)
+        {
+            ostringstream ost;
+            ost << "Compressed object \"" << key.name << "\" in file \"" <<
+             file->GetFileName() << "\" is truncated.";
+            throw runtime_error(ost.str());
+        }
+        
+        string const algorithm(src, 2);
+        size_t const blockSize = uint8_t(src[3]) | (uint8_t(src[4]) << 8) |
+         (uint8_t(src[5]) << 16);
+        size_t const blockObjSize = uint8_t(src[6]) | (uint8_t(src[7]) << 8) |
+         (uint8_t(src[8]) << 16);
+        src += 9;
+        
+        if (src + blockSize > srcEnd or produced + blockObjSize > key.objLength)
+        {
+            ostringstream ost;
+            ost << "Compressed object \"" << key.name << "\" in file \"" <<
+             file->GetFileName() << "\" is corrupted.";
+            throw runtime_error(ost.str());
+        }
+        
+        char *const dst = result.data() + produced;
+        bool success;
+        
+        if (algorithm == "ZL")
+        {
+            uLongf dstSize = blockObjSize;
+            success = (uncompress(reinterpret_cast<Bytef *>(dst), &dstSize,
+             reinterpret_cast<Bytef const *>(src), blockSize) == Z_OK and
+             dstSize == blockObjSize);
+        }
+        else if (algorithm == "L4")
+        {
+            // The LZ4 block is preceded by an 8-byte checksum, which is not verified
+            success = (blockSize >= 8 and
+             DecompressLZ4(src + 8, blockSize - 8, dst, blockObjSize) == blockObjSize);
+        }
+#ifdef HEP_PLOT_UTILS_ZSTD
+        else if (algorithm == "ZS")
+        {
+            size_t const res = ZSTD_decompress(dst, blockObjSize, src, blockSize);
+            success = (not ZSTD_isError(res) and res == blockObjSize);
+        }
+#endif
+        else
+        {
+            ostringstream ost;
+            ost << "Object \"" << key.name << "\" in file \"" << file->GetFileName() <<
+             "\" is compressed with unsupported algorithm \"" << algorithm << "\".";
+            throw runtime_error(ost.str());
+        }
+        
+        if (not success)
+        {
+            ostringstream ost;
+            ost << "Failed to decompress object \"" << key.name << "\" in file \"" <<
+             file->GetFileName() << "\".";
+            throw runtime_error(ost.str());
+        }
+        
+        src += blockSize;
+        produced += blockObjSize;
+    }
+    
+    return result;
+}
+
+
+RootFileReader::Hist RootFileReader::ReadHist(Key const &key) const
+{
+    vector<char> const buffer(ReadObject(key));
+    BufferReader reader(buffer.data(), buffer.size());
+    Hist hist;
+    int16_t version;
+    
+    
+    // The object starts with the version of the concrete class, which is followed by TH1
+    reader.ReadVersion(version);
+    size_t const th1End = reader.ReadVersion(version);
+    
+    if (th1End == 0 or version < 5)
+    {
+        ostringstream ost;
+        ost << "Histogram \"" << key.name << "\" in file \"" << file->GetFileName() <<
+         "\" is written with an unsupported version of TH1.";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // TNamed provides the title
+    size_t const namedEnd = reader.ReadVersion(version);
+    reader.SkipTObject();
+    reader.ReadString();  // fName
+    hist.title = reader.ReadString();
+    reader.SetPos(namedEnd);
+    
+    
+    // From the attributes only the fill colour is needed
+    reader.SkipVersioned();  // TAttLine
+    size_t const attFillEnd = reader.ReadVersion(version);
+    hist.fillColour = reader.Read<int16_t>();
+    reader.SetPos(attFillEnd);
+    reader.SkipVersioned();  // TAttMarker
+    
+    int32_t const numCells = reader.Read<int32_t>();
+    
+    
+    // Read the binning from the x axis and skip other axes
+    size_t const axisEnd = reader.ReadVersion(version);
+    reader.SkipVersioned();  // TNamed
+    reader.SkipVersioned();  // TAttAxis
+    int32_t const numBins = reader.Read<int32_t>();
+    double const xMin = reader.ReadDouble();
+    double const xMax = reader.ReadDouble();
+    hist.edges = reader.ReadArray<double>();
+    reader.SetPos(axisEnd);
+    
+    if (hist.edges.empty())
+    {
+        for (int32_t i = 0; i <= numBins; ++i)
+            hist.edges.push_back(xMin + (xMax - xMin) * i / numBins);
+    }
+    
+    reader.SkipVersioned();  // fYaxis
+    reader.SkipVersioned();  // fZaxis
+    
+    
+    // Skip fBarOffset, fBarWidth, and statistics up to fNormFactor, as well as the contours
+    reader.Skip(2 + 2 + 8 * 8);
+    reader.ReadArray<double>();
+    hist.sumw2 = reader.ReadArray<double>();
+    reader.SetPos(th1End);
+    
+    
+    // Bin contents are stored in the array base of the concrete class
+    if (key.className == "TH1D")
+        hist.contents = reader.ReadArray<double>();
+    else if (key.className == "TH1F")
+        hist.contents = reader.ReadArray<float>();
+    else if (key.className == "TH1I")
+        hist.contents = reader.ReadArray<int32_t>();
+    else if (key.className == "TH1S")
+        hist.contents = reader.ReadArray<int16_t>();
+    else
+        hist.contents = reader.ReadArray<int8_t>();
+    
+    if (int32_t(hist.contents.size()) != numCells or int32_t(hist.edges.size()) != numBins + 1)
+    {
+        ostringstream ost;
+        ost << "Histogram \"" << key.name << "\" in file \"" << file->GetFileName() <<
+         "\" is inconsistent.";
+        throw runtime_error(ost.str());
+    }
+    
+    return hist;
+}
+
+
+string RootFileReader::ReadObjString(Key const &key) const
+{
+    vector<char> const buffer(ReadObject(key));
+    BufferReader reader(buffer.data(), buffer.size());
+    int16_t version;
+    
+    reader.ReadVersion(version);
+    reader.SkipTObject();
+    return reader.ReadString();
+}
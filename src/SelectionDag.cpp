@@ -0,0 +1,412 @@
+#include <SelectionDag.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+EventBatch::EventBatch(size_t numEvents_):
+    numEvents(numEvents_)
+{}
+
+
+void EventBatch::AddColumn(string const &name, ArrayView<double> const &values)
+{
+    if (values.GetSize() != numEvents)
+    {
+        ostringstream ost;
+        ost << "Column \"" << name << "\" contains " << values.GetSize() << " values while the " <<
+         "batch contains " << numEvents << " events.";
+        throw runtime_error(ost.str());
+    }
+    
+    columns[name] = values;
+}
+
+
+ArrayView<double> const &EventBatch::GetColumn(string const &name) const
+{
+    auto const res = columns.find(name);
+    
+    if (res == columns.end())
+    {
+        ostringstream ost;
+        ost << "Batch of events does not contain a column \"" << name << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    return res->second;
+}
+
+
+size_t EventBatch::GetNumEvents() const
+{
+    return numEvents;
+}
+
+
+SelectionDag::SelectionDag():
+    numCutEvaluations(0), numBootstrapReplicas(0), bootstrapSeed(0)
+{}
+
+
+void SelectionDag::AddPlot(string const &name, vector<string> const &cutNames,
+ string const &variable, vector<double> const &edges, string const &title /*= ""*/,
+ string const &weight /*= ""*/)
+{
+    if (edges.size() < 2 or not is_sorted(edges.begin(), edges.end()))
+    {
+        ostringstream ost;
+        ost << "Invalid binning given for plot \"" << name << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Walk down the tree of selections along the chain of cuts, creating missing nodes
+    int node = -1;
+    
+    for (auto const &cutName: cutNames)
+    {
+        auto const cutRes = cutIndices.find(cutName);
+        
+        if (cutRes == cutIndices.end())
+        {
+            ostringstream ost;
+            ost << "Cut \"" << cutName << "\" requested for plot \"" << name <<
+             "\" has not been defined.";
+            throw runtime_error(ost.str());
+        }
+        
+        auto const res = nodeIndices.insert({{node, cutRes->second}, unsigned(nodes.size())});
+        
+        if (res.second)
+        {
+            Node newNode;
+            newNode.parent = node;
+            newNode.cut = cutRes->second;
+            nodes.emplace_back(newNode);
+        }
+        
+        node = res.first->second;
+    }
+    
+    
+    Plot plot;
+    plot.name = name;
+    plot.title = title;
+    plot.node = node;
+    plot.variable = variable;
+    plot.weight = weight;
+    plot.edges = edges;
+    
+    if (numBootstrapReplicas > 0)
+        plot.bootstrap.reset(new BootstrapHists(edges, numBootstrapReplicas, bootstrapSeed));
+    
+    plots.emplace_back(move(plot));
+}
+
+
+void SelectionDag::DefineCut(string const &name, string const &column, ValueCut const &cut)
+{
+    Cut c;
+    c.column = column;
+    c.valueCut = cut;
+    
+    if (not cutIndices.insert({name, cuts.size()}).second)
+    {
+        ostringstream ost;
+        ost << "Cut \"" << name << "\" is defined more than once.";
+        throw runtime_error(ost.str());
+    }
+    
+    cuts.emplace_back(c);
+}
+
+
+void SelectionDag::DefineCut(string const &name, EventCut const &cut)
+{
+    Cut c;
+    c.eventCut = cut;
+    
+    if (not cutIndices.insert({name, cuts.size()}).second)
+    {
+        ostringstream ost;
+        ost << "Cut \"" << name << "\" is defined more than once.";
+        throw runtime_error(ost.str());
+    }
+    
+    cuts.emplace_back(c);
+}
+
+
+void SelectionDag::DefineColumn(string const &name, Expression const &expression)
+{
+    derivedColumns.emplace_back(name, expression);
+}
+
+
+void SelectionDag::EnableBootstrap(unsigned numReplicas, string const &eventIdColumn_,
+ uint64_t seed /*= 0*/)
+{
+    if (find(samples.begin(), samples.end(), "data") != samples.end())
+        throw runtime_error("Bootstrap must be enabled before data are filled.");
+    
+    if (numReplicas < 2)
+        throw runtime_error("Bootstrap requires at least two replicas.");
+    
+    numBootstrapReplicas = numReplicas;
+    eventIdColumn = eventIdColumn_;
+    bootstrapSeed = seed;
+    
+    for (auto &plot: plots)
+        plot.bootstrap.reset(new BootstrapHists(plot.edges, numReplicas, seed));
+}
+
+
+void SelectionDag::Fill(EventBatch const &batch, string const &sample)
+{
+    size_t const numEvents = batch.GetNumEvents();
+    unsigned const sampleIndex = GetSampleIndex(sample);
+    
+    
+    // Evaluate derived columns for all events and add them to a copy of the batch. Later
+    //definitions can use the earlier ones
+    EventBatch extendedBatch(batch);
+    derivedBuffers.resize(derivedColumns.size());
+    
+    for (unsigned i = 0; i < derivedColumns.size(); ++i)
+    {
+        vector<double> &buffer = derivedBuffers[i];
+        buffer.resize(numEvents);
+        Expression const &expression = derivedColumns[i].second;
+        
+        for (size_t event = 0; event < numEvents; ++event)
+            buffer[event] = expression(extendedBatch, event);
+        
+        extendedBatch.AddColumn(derivedColumns[i].first,
+         ArrayView<double>(buffer.data(), buffer.size()));
+    }
+    
+    
+    // Evaluate the nodes of the selection tree. Since parents precede their children, each node
+    //only loops over the events that have passed its parent
+    vector<uint32_t> allEvents(numEvents);
+    iota(allEvents.begin(), allEvents.end(), 0);
+    selected.resize(nodes.size());
+    
+    for (unsigned i = 0; i < nodes.size(); ++i)
+    {
+        vector<uint32_t> const &input = (nodes[i].parent < 0) ? allEvents :
+         selected[nodes[i].parent];
+        vector<uint32_t> &output = selected[i];
+        output.clear();
+        Cut const &cut = cuts[nodes[i].cut];
+        
+        if (cut.column.empty())
+        {
+            for (uint32_t const event: input)
+            {
+                if (cut.eventCut(extendedBatch, event))
+                    output.push_back(event);
+            }
+        }
+        else
+        {
+            ArrayView<double> const &values = extendedBatch.GetColumn(cut.column);
+            
+            for (uint32_t const event: input)
+            {
+                if (cut.valueCut(values[event]))
+                    output.push_back(event);
+            }
+        }
+        
+        numCutEvaluations += input.size();
+    }
+    
+    
+    // Fill the plots with the selected events
+    for (auto &plot: plots)
+    {
+        vector<uint32_t> const &events = (plot.node < 0) ? allEvents : selected[plot.node];
+        ArrayView<double> const &values = extendedBatch.GetColumn(plot.variable);
+        ArrayView<double> const weights = (plot.weight.empty()) ? ArrayView<double>() :
+         extendedBatch.GetColumn(plot.weight);
+        
+        unsigned const numBins = plot.edges.size() - 1;
+        
+        if (plot.hists.size() <= sampleIndex)
+            plot.hists.resize(sampleIndex + 1);
+        
+        auto &hist = plot.hists[sampleIndex];
+        
+        if (hist.first.empty())
+        {
+            hist.first.assign(numBins + 2, 0.);
+            hist.second.assign(numBins + 2, 0.);
+        }
+        
+        for (uint32_t const event: events)
+        {
+            // The bin index follows ROOT conventions, with 0 for the underflow bin
+            unsigned const bin = upper_bound(plot.edges.begin(), plot.edges.end(),
+             values[event]) - plot.edges.begin();
+            double const w = (weights.IsEmpty()) ? 1. : weights[event];
+            hist.first[bin] += w;
+            hist.second[bin] += w * w;
+        }
+    }
+    
+    
+    // Fill bootstrap replicas of data. Poisson weights are generated once per event and shared by
+    //all plots that select it. Since lists of selected events are sorted, each plot keeps a
+    //position in its list that advances together with the loop over events
+    if (sample != "data" or numBootstrapReplicas == 0)
+        return;
+    
+    ArrayView<double> const &eventIds = extendedBatch.GetColumn(eventIdColumn);
+    vector<size_t> positions(plots.size(), 0);
+    vector<ArrayView<double>> plotValues, plotWeights;
+    
+    for (auto const &plot: plots)
+    {
+        plotValues.emplace_back(extendedBatch.GetColumn(plot.variable));
+        plotWeights.emplace_back((plot.weight.empty()) ? ArrayView<double>() :
+         extendedBatch.GetColumn(plot.weight));
+    }
+    
+    for (size_t event = 0; event < numEvents; ++event)
+    {
+        bool weightsReady = false;
+        
+        for (unsigned p = 0; p < plots.size(); ++p)
+        {
+            Plot &plot = plots[p];
+            vector<uint32_t> const &events = (plot.node < 0) ? allEvents : selected[plot.node];
+            
+            if (positions[p] == events.size() or events[positions[p]] != event)
+                continue;
+            
+            ++positions[p];
+            
+            if (not weightsReady)
+            {
+                BootstrapHists::GetPoissonWeights(uint64_t(eventIds[event]), bootstrapSeed,
+                 numBootstrapReplicas, poissonWeights);
+                weightsReady = true;
+            }
+            
+            unsigned const bin = upper_bound(plot.edges.begin(), plot.edges.end(),
+             plotValues[p][event]) - plot.edges.begin();
+            double const w = (plotWeights[p].IsEmpty()) ? 1. : plotWeights[p][event];
+            plot.bootstrap->FillBin(bin, poissonWeights, w);
+        }
+    }
+}
+
+
+BootstrapHists const &SelectionDag::GetBootstrap(string const &plotName) const
+{
+    Plot const &plot = FindPlot(plotName);
+    
+    if (not plot.bootstrap)
+        throw runtime_error("Bootstrap has not been enabled.");
+    
+    return *plot.bootstrap;
+}
+
+
+PlotContent SelectionDag::GetContent(string const &plotName) const
+{
+    Plot const &plot = FindPlot(plotName);
+    PlotContent content;
+    content.title = plot.title;
+    content.edges = content.Adopt(vector<double>(plot.edges));
+    unsigned const numBins = plot.edges.size() - 1;
+    content.data.name = "data";
+    
+    for (unsigned s = 0; s < samples.size(); ++s)
+    {
+        bool const filled = (s < plot.hists.size() and not plot.hists[s].first.empty());
+        PlotContent::Hist *target;
+        
+        if (samples[s] == "data")
+            target = &content.data;
+        else
+        {
+            content.processes.emplace_back();
+            target = &content.processes.back();
+            target->name = target->title = samples[s];
+        }
+        
+        if (filled)
+        {
+            target->contents = content.Adopt(vector<double>(plot.hists[s].first));
+            target->sumw2 = content.Adopt(vector<double>(plot.hists[s].second));
+        }
+        else
+            target->contents = content.Adopt(vector<double>(numBins + 2, 0.));
+    }
+    
+    if (content.data.contents.IsEmpty())
+        content.data.contents = content.Adopt(vector<double>(numBins + 2, 0.));
+    
+    return content;
+}
+
+
+uint64_t SelectionDag::GetNumCutEvaluations() const
+{
+    return numCutEvaluations;
+}
+
+
+unsigned SelectionDag::GetNumNodes() const
+{
+    return nodes.size();
+}
+
+
+vector<string> SelectionDag::GetPlotNames() const
+{
+    vector<string> names;
+    
+    for (auto const &plot: plots)
+        names.emplace_back(plot.name);
+    
+    return names;
+}
+
+
+SelectionDag::Plot const &SelectionDag::FindPlot(string const &plotName) const
+{
+    auto const plotIt = find_if(plots.begin(), plots.end(), [&plotName](Plot const &p)
+    {
+        return (p.name == plotName);
+    });
+    
+    if (plotIt == plots.end())
+    {
+        ostringstream ost;
+        ost << "Plot \"" << plotName << "\" is not defined.";
+        throw runtime_error(ost.str());
+    }
+    
+    return *plotIt;
+}
+
+
+unsigned SelectionDag::GetSampleIndex(string const &sample)
+{
+    auto const res = find(samples.begin(), samples.end(), sample);
+    
+    if (res != samples.end())
+        return res - samples.begin();
+    
+    samples.emplace_back(sample);
+    return samples.size() - 1;
+}
@@ -0,0 +1,468 @@
+#include <SharedHistFeed.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Alignment of the sequence counter and the arrays in the segment, in bytes
+    size_t const arrayAlignment = 64;
+    
+    /// Magic string that identifies the format
+    char const feedMagic[8] = {'H', 'P', 'U', 'F', 'E', 'E', 'D', '1'};
+    
+    /// Value used to detect a mismatch in byte order
+    uint32_t const byteOrderMark = 0x01020304;
+    
+    
+    /// Header of the shared-memory segment
+    struct SegmentHeader
+    {
+        /// Magic string that identifies the format; written last when the segment is created
+        char magic[8];
+        
+        /// Value used to detect a mismatch in byte order
+        uint32_t byteOrderMark;
+        
+        /// Number of bins
+        uint32_t numBins;
+        
+        /// Number of histograms
+        uint32_t numHists;
+        
+        /// Offset and length of the title of the plot
+        uint32_t titleOffset, titleLength;
+        
+        /// Offset of the array of bin edges
+        uint64_t edgesOffset;
+        
+        /// Offset of the array of histogram descriptors
+        uint64_t histsOffset;
+        
+        /// Offset of the first buffer with bin contents; the second one follows immediately
+        uint64_t buffersOffset;
+        
+        /// Total size of the segment
+        uint64_t segmentSize;
+    };
+    
+    /// Descriptor of a histogram in the segment
+    struct HistDescriptor
+    {
+        /// Offset and length of the name of the histogram
+        uint32_t nameOffset, nameLength;
+        
+        /// Offset and length of the title of the histogram
+        uint32_t titleOffset, titleLength;
+        
+        /// Role of the histogram: 0 for data, 1 for MC, 2 and 3 for up and down variations
+        uint32_t role;
+        
+        /// Fill colour
+        int32_t colour;
+    };
+    
+    /// Sequence counter, which occupies its own cache line after the header
+    typedef atomic<uint64_t> SequenceCounter;
+    
+    static_assert(sizeof(SegmentHeader) <= arrayAlignment, "Segment header is too large");
+    static_assert(sizeof(SequenceCounter) == sizeof(uint64_t),
+     "Unexpected size of the sequence counter");
+    
+    
+    /// Adds a leading slash to the name of the segment as required by shm_open
+    string NormalizeName(string const &segmentName)
+    {
+        return (segmentName.empty() or segmentName[0] != '/') ? "/" + segmentName : segmentName;
+    }
+    
+    
+    /// Appends zero bytes to the buffer until its size is a multiple of the given alignment
+    void Pad(vector<char> &buffer, size_t alignment)
+    {
+        buffer.resize((buffer.size() + alignment - 1) / alignment * alignment, 0);
+    }
+    
+    
+    /// Appends a string to the buffer and sets its offset and length
+    void AppendString(vector<char> &buffer, string const &str, uint32_t &offset, uint32_t &length)
+    {
+        offset = buffer.size();
+        length = str.length();
+        buffer.insert(buffer.end(), str.begin(), str.end());
+    }
+    
+    
+    /// Returns the sequence counter of the segment
+    SequenceCounter &GetCounter(char *segment)
+    {
+        return *reinterpret_cast<SequenceCounter *>(segment + arrayAlignment);
+    }
+    
+    
+    /// Returns the sequence counter of the segment
+    SequenceCounter const &GetCounter(char const *segment)
+    {
+        return *reinterpret_cast<SequenceCounter const *>(segment + arrayAlignment);
+    }
+}
+
+
+SharedHistFeedWriter::SharedHistFeedWriter(string const &segmentName_,
+ PlotContent const &layout):
+    segmentName(NormalizeName(segmentName_)),
+    segment(nullptr), segmentSize(0)
+{
+    layout.Validate("layout of shared histogram feed \"" + segmentName + "\"");
+    unsigned const numBins = layout.GetNumBins();
+    edges.assign(layout.edges.begin(), layout.edges.end());
+    
+    
+    // Collect all histograms with their roles and copy their initial contents
+    vector<pair<PlotContent::Hist const *, uint32_t>> hists{{&layout.data, 0}};
+    
+    for (auto const &p: layout.processes)
+        hists.emplace_back(&p, 1);
+    
+    if (layout.HasSystematics())
+    {
+        hists.emplace_back(&layout.systUp, 2);
+        hists.emplace_back(&layout.systDown, 3);
+    }
+    
+    for (auto const &h: hists)
+    {
+        names.emplace_back(h.first->name);
+        contents.insert(contents.end(), h.first->contents.begin(), h.first->contents.end());
+    }
+    
+    
+    // Assemble the immutable part of the segment: header, sequence counter, edges, descriptors,
+    //and strings
+    vector<char> image(2 * arrayAlignment);
+    SegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    header.byteOrderMark = byteOrderMark;
+    header.numBins = numBins;
+    header.numHists = hists.size();
+    
+    header.edgesOffset = image.size();
+    image.insert(image.end(), reinterpret_cast<char const *>(edges.data()),
+     reinterpret_cast<char const *>(edges.data() + edges.size()));
+    
+    Pad(image, alignof(HistDescriptor));
+    header.histsOffset = image.size();
+    image.resize(image.size() + hists.size() * sizeof(HistDescriptor));
+    vector<HistDescriptor> descriptors(hists.size());
+    
+    AppendString(image, layout.title, header.titleOffset, header.titleLength);
+    
+    for (unsigned i = 0; i < hists.size(); ++i)
+    {
+        HistDescriptor &d = descriptors[i];
+        d.role = hists[i].second;
+        d.colour = hists[i].first->colour;
+        AppendString(image, hists[i].first->name, d.nameOffset, d.nameLength);
+        AppendString(image, hists[i].first->title, d.titleOffset, d.titleLength);
+    }
+    
+    if (not descriptors.empty())
+        memcpy(image.data() + header.histsOffset, descriptors.data(),
+         descriptors.size() * sizeof(HistDescriptor));
+    
+    Pad(image, arrayAlignment);
+    header.buffersOffset = image.size();
+    segmentSize = header.buffersOffset + 2 * contents.size() * sizeof(double);
+    header.segmentSize = segmentSize;
+    memcpy(image.data(), &header, sizeof(header));
+    
+    
+    // A segment left over by a producer that has crashed is replaced
+    shm_unlink(segmentName.c_str());
+    int const fd = shm_open(segmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    
+    if (fd < 0)
+    {
+        ostringstream ost;
+        ost << "Failed to create shared-memory segment \"" << segmentName << "\": " <<
+         strerror(errno) << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    if (ftruncate(fd, segmentSize) != 0)
+    {
+        close(fd);
+        shm_unlink(segmentName.c_str());
+        ostringstream ost;
+        ost << "Failed to allocate " << segmentSize << " bytes for shared-memory segment \"" <<
+         segmentName << "\": " << strerror(errno) << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    void *const mapping = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    
+    if (mapping == MAP_FAILED)
+    {
+        shm_unlink(segmentName.c_str());
+        ostringstream ost;
+        ost << "Failed to map shared-memory segment \"" << segmentName << "\": " <<
+         strerror(errno) << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    segment = static_cast<char *>(mapping);
+    
+    
+    // Readers check the magic string, so it is only set after everything else has been written
+    memcpy(segment + sizeof(feedMagic), image.data() + sizeof(feedMagic),
+     image.size() - sizeof(feedMagic));
+    new (segment + arrayAlignment) SequenceCounter(0);
+    
+    if (not GetCounter(segment).is_lock_free())
+    {
+        munmap(segment, segmentSize);
+        shm_unlink(segmentName.c_str());
+        ostringstream ost;
+        ost << "Shared histogram feeds require lock-free 64-bit atomic operations.";
+        throw runtime_error(ost.str());
+    }
+    
+    if (not contents.empty())
+        memcpy(segment + header.buffersOffset, contents.data(), contents.size() * sizeof(double));
+    
+    atomic_thread_fence(memory_order_release);
+    memcpy(segment, feedMagic, sizeof(feedMagic));
+}
+
+
+SharedHistFeedWriter::~SharedHistFeedWriter()
+{
+    munmap(segment, segmentSize);
+    shm_unlink(segmentName.c_str());
+}
+
+
+unsigned SharedHistFeedWriter::FindHist(string const &name) const
+{
+    auto const res = find(names.begin(), names.end(), name);
+    
+    if (res == names.end())
+    {
+        ostringstream ost;
+        ost << "Shared histogram feed \"" << segmentName << "\" does not contain histogram \"" <<
+         name << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    return res - names.begin();
+}
+
+
+void SharedHistFeedWriter::Fill(unsigned histIndex, double x, double weight /*= 1.*/)
+{
+    // Index 0 corresponds to the underflow and edges.size() to the overflow, as in ROOT
+    unsigned const bin = upper_bound(edges.begin(), edges.end(), x) - edges.begin();
+    contents[histIndex * (edges.size() + 1) + bin] += weight;
+}
+
+
+double *SharedHistFeedWriter::GetContents(unsigned histIndex)
+{
+    if (histIndex >= names.size())
+    {
+        ostringstream ost;
+        ost << "Shared histogram feed \"" << segmentName << "\" contains only " << names.size() <<
+         " histograms while index " << histIndex << " is requested.";
+        throw runtime_error(ost.str());
+    }
+    
+    return contents.data() + histIndex * (edges.size() + 1);
+}
+
+
+void SharedHistFeedWriter::Publish()
+{
+    // Seqlock protocol with two buffers. When the counter equals 2 n, buffer n % 2 is published.
+    //An odd value of the counter indicates that the other buffer is being overwritten
+    SequenceCounter &counter = GetCounter(segment);
+    uint64_t const sequence = counter.load(memory_order_relaxed);
+    counter.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    
+    SegmentHeader const *header = reinterpret_cast<SegmentHeader const *>(segment);
+    size_t const bufferSize = contents.size() * sizeof(double);
+    char *const target = segment + header->buffersOffset + (sequence / 2 + 1) % 2 * bufferSize;
+    
+    if (bufferSize > 0)
+        memcpy(target, contents.data(), bufferSize);
+    
+    counter.store(sequence + 2, memory_order_release);
+}
+
+
+void SharedHistFeedWriter::Reset()
+{
+    fill(contents.begin(), contents.end(), 0.);
+}
+
+
+SharedHistFeedReader::SharedHistFeedReader(string const &segmentName_):
+    segment(nullptr)
+{
+    string const segmentName(NormalizeName(segmentName_));
+    int const fd = shm_open(segmentName.c_str(), O_RDONLY, 0);
+    
+    if (fd < 0)
+    {
+        ostringstream ost;
+        ost << "Failed to open shared-memory segment \"" << segmentName << "\": " <<
+         strerror(errno) << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    struct stat segmentStat;
+    
+    if (fstat(fd, &segmentStat) != 0 or size_t(segmentStat.st_size) < 2 * arrayAlignment)
+    {
+        close(fd);
+        ostringstream ost;
+        ost << "Shared-memory segment \"" << segmentName << "\" is not a histogram feed.";
+        throw runtime_error(ost.str());
+    }
+    
+    size_t const size = segmentStat.st_size;
+    void *const mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    
+    if (mapping == MAP_FAILED)
+    {
+        ostringstream ost;
+        ost << "Failed to map shared-memory segment \"" << segmentName << "\": " <<
+         strerror(errno) << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    segment = static_cast<char const *>(mapping);
+    this->mapping.reset(mapping, [size](void const *p){munmap(const_cast<void *>(p), size);});
+    
+    
+    // Everything except for the buffers with bin contents is immutable once the magic string has
+    //been written
+    SegmentHeader const *header = reinterpret_cast<SegmentHeader const *>(segment);
+    bool const ready = (memcmp(header->magic, feedMagic, sizeof(feedMagic)) == 0);
+    atomic_thread_fence(memory_order_acquire);
+    
+    if (not ready or header->byteOrderMark != byteOrderMark or header->segmentSize > size or
+     header->buffersOffset + 2 * header->numHists * (header->numBins + 2) * sizeof(double) >
+     header->segmentSize)
+    {
+        ostringstream ost;
+        ost << "Shared-memory segment \"" << segmentName << "\" is not a histogram feed or has " <<
+         "not been initialised yet.";
+        throw runtime_error(ost.str());
+    }
+}
+
+
+uint64_t SharedHistFeedReader::GetGeneration() const
+{
+    return GetCounter(segment).load(memory_order_acquire) / 2;
+}
+
+
+PlotContent SharedHistFeedReader::Read(string const & /*= ""*/) const
+{
+    while (true)
+    {
+        uint64_t sequence;
+        PlotContent content(View(sequence));
+        
+        vector<PlotContent::Hist *> hists{&content.data};
+        
+        for (auto &p: content.processes)
+            hists.push_back(&p);
+        
+        if (content.HasSystematics())
+        {
+            hists.push_back(&content.systUp);
+            hists.push_back(&content.systDown);
+        }
+        
+        for (auto &h: hists)
+            h->contents = content.Adopt(vector<double>(h->contents.begin(), h->contents.end()));
+        
+        if (IsValid(sequence))
+            return content;
+    }
+}
+
+
+PlotContent SharedHistFeedReader::View(uint64_t &sequence) const
+{
+    SegmentHeader const *header = reinterpret_cast<SegmentHeader const *>(segment);
+    unsigned const numBins = header->numBins;
+    
+    sequence = GetCounter(segment).load(memory_order_acquire);
+    double const *const buffer = reinterpret_cast<double const *>(segment +
+     header->buffersOffset) + (sequence / 2) % 2 * header->numHists * (numBins + 2);
+    
+    
+    PlotContent content;
+    content.KeepAlive(mapping);
+    content.title = string(segment + header->titleOffset, header->titleLength);
+    content.edges = ArrayView<double>(
+     reinterpret_cast<double const *>(segment + header->edgesOffset), numBins + 1);
+    
+    HistDescriptor const *const descriptors =
+     reinterpret_cast<HistDescriptor const *>(segment + header->histsOffset);
+    
+    for (unsigned i = 0; i < header->numHists; ++i)
+    {
+        HistDescriptor const &d = descriptors[i];
+        PlotContent::Hist *target;
+        
+        if (d.role == 0)
+            target = &content.data;
+        else if (d.role == 2)
+            target = &content.systUp;
+        else if (d.role == 3)
+            target = &content.systDown;
+        else
+        {
+            content.processes.emplace_back();
+            target = &content.processes.back();
+        }
+        
+        target->name = string(segment + d.nameOffset, d.nameLength);
+        target->title = string(segment + d.titleOffset, d.titleLength);
+        target->colour = d.colour;
+        target->contents = ArrayView<double>(buffer + i * (numBins + 2), numBins + 2);
+    }
+    
+    return content;
+}
+
+
+bool SharedHistFeedReader::IsValid(uint64_t sequence) const
+{
+    // The buffer published at the given sequence number starts to be overwritten when the counter
+    //reaches the next odd value after sequence - sequence % 2 + 2
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t const current = GetCounter(segment).load(memory_order_relaxed);
+    return (current <= sequence - sequence % 2 + 2);
+}
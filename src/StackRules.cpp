@@ -0,0 +1,77 @@
+#include <StackRules.hpp>
+
+#include <fnmatch.h>
+
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+double StackRules::ComputeNormFactor(ArrayView<double> const &data, ArrayView<double> const &total,
+ BinMask const &mask, ArrayView<double> const &widths /*= ArrayView<double>()*/)
+{
+    if (data.GetSize() < 2 or total.GetSize() != data.GetSize())
+    {
+        ostringstream ost;
+        ost << "Cannot normalize a total expectation with " << total.GetSize() <<
+         " bins to data with " << data.GetSize() << " bins.";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // A mask that hides nothing can be default-constructed and thus not know the binning
+    BinMask const noMask(data.GetSize() - 2);
+    BinMask const &m = (mask.IsActive()) ? mask : noMask;
+    
+    return m.SumUnmasked(data, widths) / m.SumUnmasked(total, widths);
+}
+
+
+vector<double> StackRules::GetWidths(ArrayView<double> const &edges)
+{
+    if (edges.GetSize() < 2)
+        throw runtime_error("Cannot compute bin widths without at least two bin edges.");
+    
+    unsigned const numBins = edges.GetSize() - 1;
+    vector<double> widths(numBins + 2);
+    
+    for (unsigned bin = 1; bin <= numBins; ++bin)
+        widths[bin] = edges[bin] - edges[bin - 1];
+    
+    widths[0] = widths[1];
+    widths[numBins + 1] = widths[numBins];
+    
+    return widths;
+}
+
+
+vector<unsigned> StackRules::MatchOverlay(vector<string> const &stackNames, string const &pattern,
+ bool requireMatch /*= true*/)
+{
+    vector<unsigned> matches;
+    
+    for (unsigned i = 0; i < stackNames.size(); ++i)
+    {
+        if (fnmatch(pattern.c_str(), stackNames[i].c_str(), 0) == 0)
+            matches.push_back(i);
+    }
+    
+    if (matches.empty() and requireMatch)
+    {
+        ostringstream ost;
+        ost << "No MC process matches overlay pattern \"" << pattern << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    if (not matches.empty() and matches.size() == stackNames.size())
+    {
+        ostringstream ost;
+        ost << "Overlay pattern \"" << pattern << "\" matches all MC processes, and no " <<
+         "processes would remain in the stack.";
+        throw runtime_error(ost.str());
+    }
+    
+    return matches;
+}
@@ -0,0 +1,162 @@
+#include <Summation.hpp>
+
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Number of independent partial sums in reductions
+    unsigned const numLanes = 8;
+    
+    /// Blocks of this size or smaller are summed directly in the pairwise mode
+    size_t const pairwiseBlock = 128;
+}
+
+
+double Summation::Sum(ArrayView<double> const &values, Mode mode /*= Mode::Compensated*/)
+{
+    double const *x = values.GetData();
+    size_t const size = values.GetSize();
+    
+    if (mode == Mode::Naive)
+    {
+        double sum = 0.;
+        
+        for (size_t i = 0; i < size; ++i)
+            sum += x[i];
+        
+        return sum;
+    }
+    
+    if (mode == Mode::Pairwise)
+        return SumPairwise(x, size);
+    
+    
+    // Compensated summation with independent lanes, which are combined at the end
+    double sums[numLanes] = {}, comps[numLanes] = {};
+    size_t const numFull = size - size % numLanes;
+    
+    for (size_t i = 0; i < numFull; i += numLanes)
+        for (unsigned k = 0; k < numLanes; ++k)
+            AddCompensated(sums[k], comps[k], x[i + k]);
+    
+    for (size_t i = numFull; i < size; ++i)
+        AddCompensated(sums[i - numFull], comps[i - numFull], x[i]);
+    
+    double sum = 0., comp = 0.;
+    
+    for (unsigned k = 0; k < numLanes; ++k)
+    {
+        AddCompensated(sum, comp, sums[k]);
+        comp += comps[k];
+    }
+    
+    return sum + comp;
+}
+
+
+void Summation::SumArrays(vector<ArrayView<double>> const &arrays, vector<double> &result,
+ Mode mode /*= Mode::Compensated*/)
+{
+    unsigned const size = (arrays.empty()) ? 0 : arrays.front().GetSize();
+    
+    for (auto const &a: arrays)
+    {
+        if (a.GetSize() != size)
+        {
+            ostringstream ost;
+            ost << "Cannot sum arrays of different sizes (" << size << " and " << a.GetSize() <<
+             ").";
+            throw runtime_error(ost.str());
+        }
+    }
+    
+    result.assign(size, 0.);
+    double *out = result.data();
+    
+    if (mode == Mode::Naive)
+    {
+        for (auto const &a: arrays)
+        {
+            double const *in = a.GetData();
+            
+            for (unsigned i = 0; i < size; ++i)
+                out[i] += in[i];
+        }
+    }
+    else if (mode == Mode::Pairwise)
+    {
+        if (not arrays.empty())
+            SumArraysPairwise(arrays.data(), arrays.size(), size, out);
+    }
+    else
+    {
+        vector<double> comps(size, 0.);
+        double *comp = comps.data();
+        
+        for (auto const &a: arrays)
+        {
+            double const *in = a.GetData();
+            
+            for (unsigned i = 0; i < size; ++i)
+                AddCompensated(out[i], comp[i], in[i]);
+        }
+        
+        for (unsigned i = 0; i < size; ++i)
+            out[i] += comp[i];
+    }
+}
+
+
+void Summation::SumArraysPairwise(ArrayView<double> const *arrays, unsigned numArrays,
+ unsigned size, double *result)
+{
+    if (numArrays == 1)
+    {
+        double const *in = arrays[0].GetData();
+        
+        for (unsigned i = 0; i < size; ++i)
+            result[i] = in[i];
+        
+        return;
+    }
+    
+    unsigned const half = numArrays / 2;
+    vector<double> right(size);
+    SumArraysPairwise(arrays, half, size, result);
+    SumArraysPairwise(arrays + half, numArrays - half, size, right.data());
+    
+    for (unsigned i = 0; i < size; ++i)
+        result[i] += right[i];
+}
+
+
+double Summation::SumPairwise(double const *values, size_t size)
+{
+    if (size > pairwiseBlock)
+    {
+        // Split at a multiple of the number of lanes to keep the leaves aligned
+        size_t const half = (size / 2) - (size / 2) % numLanes;
+        return SumPairwise(values, half) + SumPairwise(values + half, size - half);
+    }
+    
+    double sums[numLanes] = {};
+    size_t const numFull = size - size % numLanes;
+    
+    for (size_t i = 0; i < numFull; i += numLanes)
+        for (unsigned k = 0; k < numLanes; ++k)
+            sums[k] += values[i + k];
+    
+    for (size_t i = numFull; i < size; ++i)
+        sums[i - numFull] += values[i];
+    
+    for (unsigned width = numLanes / 2; width > 0; width /= 2)
+        for (unsigned k = 0; k < width; ++k)
+            sums[k] += sums[k + width];
+    
+    return sums[0];
+}
@@ -0,0 +1,313 @@
+#include <TemplateMorph.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+TemplateMorph::TemplateMorph(vector<ArrayView<double>> const &nominals_)
+{
+    if (nominals_.empty())
+        throw runtime_error("TemplateMorph requires at least one process.");
+    
+    numBins = nominals_.front().GetSize();
+    
+    for (auto const &n: nominals_)
+    {
+        if (n.GetSize() != numBins)
+            throw runtime_error("Nominal templates of all processes must have the same size.");
+        
+        nominals.emplace_back(n.begin(), n.end());
+    }
+    
+    
+    // Until Evaluate is called, the morphed templates are the nominal ones
+    morphed = nominals;
+    total.assign(numBins, 0.);
+    
+    for (auto const &m: morphed)
+    {
+        for (unsigned bin = 0; bin < numBins; ++bin)
+            total[bin] += m[bin];
+    }
+}
+
+
+void TemplateMorph::AddTemplates(unsigned process, string const &source,
+ ArrayView<double> const &up, ArrayView<double> const &down,
+ Interpolation interpolation /*= Interpolation::Additive*/)
+{
+    if (process >= nominals.size() or up.GetSize() != numBins or down.GetSize() != numBins)
+    {
+        ostringstream ost;
+        ost << "Templates for source \"" << source << "\" and process " << process <<
+         " do not match the nominal templates.";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Find the source or register a new one
+    auto sourceIt = find_if(sources.begin(), sources.end(),
+     [&source](Source const &s){return s.name == source;});
+    
+    if (sourceIt == sources.end())
+    {
+        Source s;
+        s.name = source;
+        s.interpolation = interpolation;
+        sources.emplace_back(s);
+        sourceIt = sources.end() - 1;
+    }
+    else if (sourceIt->interpolation != interpolation)
+    {
+        ostringstream ost;
+        ost << "Templates for source \"" << source << "\" use different interpolation schemes.";
+        throw runtime_error(ost.str());
+    }
+    
+    for (auto const &e: sourceIt->effects)
+    {
+        if (e.process == process)
+        {
+            ostringstream ost;
+            ost << "Templates for source \"" << source << "\" and process " << process <<
+             " are given more than once.";
+            throw runtime_error(ost.str());
+        }
+    }
+    
+    
+    // Precompute coefficients of the interpolation in every bin
+    Effect effect;
+    effect.process = process;
+    vector<double> const &nominal = nominals[process];
+    
+    if (interpolation == Interpolation::Additive)
+    {
+        // Polynomial x * (S + A x (15 - 10 x^2 + 3 x^4)) with S and A chosen to match the linear
+        //extrapolation and its derivative at x = +-1 [HistFactory, interpolation code 4]
+        effect.coeffs.resize(4 * numBins);
+        double *const epsUp = effect.coeffs.data(), *const epsDown = epsUp + numBins;
+        double *const s = epsDown + numBins, *const a = s + numBins;
+        
+        for (unsigned bin = 0; bin < numBins; ++bin)
+        {
+            epsUp[bin] = up[bin] - nominal[bin];
+            epsDown[bin] = nominal[bin] - down[bin];
+            s[bin] = 0.5 * (epsUp[bin] + epsDown[bin]);
+            a[bin] = 0.0625 * (epsUp[bin] - epsDown[bin]);
+        }
+    }
+    else
+    {
+        // Polynomial of the sixth order that matches the value and the first two derivatives of
+        //the exponential extrapolation at x = +-1 [HistFactory, interpolation code 4]
+        effect.coeffs.assign(8 * numBins, 0.);
+        double *const c = effect.coeffs.data();
+        
+        for (unsigned bin = 0; bin < numBins; ++bin)
+        {
+            if (nominal[bin] <= 0. or up[bin] <= 0. or down[bin] <= 0.)
+                continue;
+            
+            double const logUp = log(up[bin] / nominal[bin]);
+            double const logDown = log(down[bin] / nominal[bin]);
+            double const powUp = up[bin] / nominal[bin], powDown = down[bin] / nominal[bin];
+            double const powUpLog = powUp * logUp, powDownLog = -powDown * logDown;
+            double const powUpLog2 = powUpLog * logUp, powDownLog2 = -powDownLog * logDown;
+            
+            double const s0 = 0.5 * (powUp + powDown), a0 = 0.5 * (powUp - powDown);
+            double const s1 = 0.5 * (powUpLog + powDownLog), a1 = 0.5 * (powUpLog - powDownLog);
+            double const s2 = 0.5 * (powUpLog2 + powDownLog2);
+            double const a2 = 0.5 * (powUpLog2 - powDownLog2);
+            
+            c[bin] = logUp;
+            c[numBins + bin] = logDown;
+            c[2 * numBins + bin] = (15. * a0 - 7. * s1 + a2) / 8.;
+            c[3 * numBins + bin] = (-24. + 24. * s0 - 9. * a1 + s2) / 8.;
+            c[4 * numBins + bin] = (-5. * a0 + 5. * s1 - a2) / 4.;
+            c[5 * numBins + bin] = (12. - 12. * s0 + 7. * a1 - s2) / 4.;
+            c[6 * numBins + bin] = (3. * a0 - 3. * s1 + a2) / 8.;
+            c[7 * numBins + bin] = (-8. + 8. * s0 - 5. * a1 + s2) / 8.;
+        }
+    }
+    
+    sourceIt->effects.emplace_back(move(effect));
+}
+
+
+void TemplateMorph::Evaluate(vector<double> const &params)
+{
+    if (params.size() != sources.size())
+    {
+        ostringstream ost;
+        ost << "Got " << params.size() << " nuisance parameters while " << sources.size() <<
+         " sources of uncertainty are defined.";
+        throw runtime_error(ost.str());
+    }
+    
+    shifts.assign(nominals.size() * numBins, 0.);
+    factors.assign(nominals.size() * numBins, 1.);
+    
+    
+    // Accumulate variations from all sources. The value of the nuisance parameter is the same for
+    //all bins, so the choice of the branch of the interpolation is made outside of loops over bins
+    for (unsigned s = 0; s < sources.size(); ++s)
+    {
+        double const theta = params[s];
+        
+        if (theta == 0.)
+            continue;
+        
+        for (auto const &effect: sources[s].effects)
+        {
+            size_t const offset = size_t(effect.process) * numBins;
+            
+            if (sources[s].interpolation == Interpolation::Additive)
+                AddShifts(effect, theta, shifts.data() + offset);
+            else
+                ApplyFactors(effect, theta, factors.data() + offset);
+        }
+    }
+    
+    
+    // Combine the variations with the nominal templates and sum up the processes
+    total.assign(numBins, 0.);
+    
+    for (unsigned p = 0; p < nominals.size(); ++p)
+    {
+        double const *const nominal = nominals[p].data();
+        double const *const shift = shifts.data() + size_t(p) * numBins;
+        double const *const factor = factors.data() + size_t(p) * numBins;
+        double *const result = morphed[p].data();
+        
+        for (unsigned bin = 0; bin < numBins; ++bin)
+        {
+            result[bin] = max((nominal[bin] + shift[bin]) * factor[bin], 0.);
+            total[bin] += result[bin];
+        }
+    }
+}
+
+
+void TemplateMorph::Evaluate(map<string, double> const &params)
+{
+    vector<double> values(sources.size(), 0.);
+    
+    for (auto const &p: params)
+        values[GetSourceIndex(p.first)] = p.second;
+    
+    Evaluate(values);
+}
+
+
+vector<double> const &TemplateMorph::GetMorphed(unsigned process) const
+{
+    return morphed.at(process);
+}
+
+
+unsigned TemplateMorph::GetNumBins() const
+{
+    return numBins;
+}
+
+
+unsigned TemplateMorph::GetNumProcesses() const
+{
+    return nominals.size();
+}
+
+
+unsigned TemplateMorph::GetNumSources() const
+{
+    return sources.size();
+}
+
+
+unsigned TemplateMorph::GetSourceIndex(string const &name) const
+{
+    for (unsigned s = 0; s < sources.size(); ++s)
+    {
+        if (sources[s].name == name)
+            return s;
+    }
+    
+    ostringstream ost;
+    ost << "Unknown source of uncertainty \"" << name << "\".";
+    throw runtime_error(ost.str());
+}
+
+
+vector<string> TemplateMorph::GetSourceNames() const
+{
+    vector<string> names;
+    
+    for (auto const &s: sources)
+        names.emplace_back(s.name);
+    
+    return names;
+}
+
+
+vector<double> const &TemplateMorph::GetTotal() const
+{
+    return total;
+}
+
+
+void TemplateMorph::AddShifts(Effect const &effect, double theta, double *shifts_) const
+{
+    double const *const epsUp = effect.coeffs.data(), *const epsDown = epsUp + numBins;
+    double const *const s = epsDown + numBins, *const a = s + numBins;
+    
+    if (theta >= 1.)
+    {
+        for (unsigned bin = 0; bin < numBins; ++bin)
+            shifts_[bin] += theta * epsUp[bin];
+    }
+    else if (theta <= -1.)
+    {
+        for (unsigned bin = 0; bin < numBins; ++bin)
+            shifts_[bin] += theta * epsDown[bin];
+    }
+    else
+    {
+        double const theta2 = theta * theta;
+        double const poly = theta * (15. + theta2 * (-10. + 3. * theta2));
+        
+        for (unsigned bin = 0; bin < numBins; ++bin)
+            shifts_[bin] += theta * s[bin] + theta * a[bin] * poly;
+    }
+}
+
+
+void TemplateMorph::ApplyFactors(Effect const &effect, double theta, double *factors_) const
+{
+    double const *const c = effect.coeffs.data();
+    
+    if (theta >= 1.)
+    {
+        for (unsigned bin = 0; bin < numBins; ++bin)
+            factors_[bin] *= exp(theta * c[bin]);
+    }
+    else if (theta <= -1.)
+    {
+        for (unsigned bin = 0; bin < numBins; ++bin)
+            factors_[bin] *= exp(-theta * c[numBins + bin]);
+    }
+    else
+    {
+        double const *const c1 = c + 2 * numBins, *const c2 = c1 + numBins;
+        double const *const c3 = c2 + numBins, *const c4 = c3 + numBins;
+        double const *const c5 = c4 + numBins, *const c6 = c5 + numBins;
+        
+        for (unsigned bin = 0; bin < numBins; ++bin)
+            factors_[bin] *= 1. + theta * (c1[bin] + theta * (c2[bin] + theta * (c3[bin] +
+             theta * (c4[bin] + theta * (c5[bin] + theta * c6[bin])))));
+    }
+}
@@ -0,0 +1,106 @@
+#include <TextLayoutCache.hpp>
+
+#include <TLatex.h>
+#include <TVirtualPad.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Widths of labels in units of the text size, indexed by the font and the text
+    map<pair<short, string>, double> labelWidths;
+    
+    /// Maximal widths of labels in units of the text size for sets of legend entries
+    map<pair<short, vector<string>>, double> legendWidths;
+    
+    /// Mutex that guards both caches
+    mutex cacheMutex;
+}
+
+
+double TextLayoutCache::GetWidth(string const &text, short font, double textSize,
+ TVirtualPad &pad)
+{
+    return GetRelativeWidth(text, font, pad) * textSize * GetScale(pad);
+}
+
+
+double TextLayoutCache::GetLegendWidth(vector<string> const &labels, short font,
+ double textSize, TVirtualPad &pad, double symbolFraction /*= 0.25*/)
+{
+    auto const key = make_pair(font, labels);
+    double maxWidth = -1.;
+    
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        auto const res = legendWidths.find(key);
+        
+        if (res != legendWidths.end())
+            maxWidth = res->second;
+    }
+    
+    if (maxWidth < 0.)
+    {
+        maxWidth = 0.;
+        
+        for (auto const &label: labels)
+            maxWidth = max(maxWidth, GetRelativeWidth(label, font, pad));
+        
+        lock_guard<mutex> lock(cacheMutex);
+        legendWidths[key] = maxWidth;
+    }
+    
+    
+    // Add a small padding equal to a half of the text size
+    return (maxWidth + 0.5) * textSize * GetScale(pad) / (1. - symbolFraction);
+}
+
+
+double TextLayoutCache::GetRelativeWidth(string const &text, short font, TVirtualPad &pad)
+{
+    auto const key = make_pair(font, text);
+    
+    {
+        lock_guard<mutex> lock(cacheMutex);
+        auto const res = labelWidths.find(key);
+        
+        if (res != labelWidths.end())
+            return res->second;
+    }
+    
+    
+    // Measure the label in the given pad. TLatex::GetXsize gives the width in user coordinates of
+    //the current pad, which coincide with NDC for a pad without a frame
+    TVirtualPad *const prevPad = gPad;
+    pad.cd();
+    
+    double const textSize = 0.1;
+    TLatex latex(0., 0., text.c_str());
+    latex.SetTextFont(font);
+    latex.SetTextSize(textSize);
+    double const width = latex.GetXsize() / (textSize * GetScale(pad));
+    
+    if (prevPad)
+        prevPad->cd();
+    
+    lock_guard<mutex> lock(cacheMutex);
+    labelWidths[key] = width;
+    
+    return width;
+}
+
+
+double TextLayoutCache::GetScale(TVirtualPad const &pad)
+{
+    double const width = pad.GetWw() * pad.GetAbsWNDC();
+    double const height = pad.GetWh() * pad.GetAbsHNDC();
+    
+    return min(width, height) / width;
+}
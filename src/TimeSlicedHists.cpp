@@ -0,0 +1,203 @@
+#include <TimeSlicedHists.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <sstream>
+
+
+using namespace std;
+
+
+TimeSlicedHists::TimeSlicedHists(PlotContent const &layout_, double sliceDuration_,
+ unsigned numSlices_, double startTime_ /*= 0.*/):
+    sliceDuration(sliceDuration_), numSlices(numSlices_), startTime(startTime_),
+    curSlice(0), numExpired(0)
+{
+    layout_.Validate("layout of time-sliced histograms");
+    
+    if (sliceDuration <= 0. or numSlices == 0)
+    {
+        ostringstream ost;
+        ost << "Time-sliced histograms require a positive slice duration and at least one slice " <<
+         "while got " << sliceDuration << " and " << numSlices << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Copy the layout. The edges are copied as well since the layout might refer to memory that
+    //does not outlive it
+    layout.title = layout_.title;
+    layout.edges = layout.Adopt(vector<double>(layout_.edges.begin(), layout_.edges.end()));
+    layout.data.name = layout_.data.name;
+    layout.data.title = layout_.data.title;
+    layout.data.colour = layout_.data.colour;
+    
+    for (auto const &p: layout_.processes)
+    {
+        layout.processes.emplace_back();
+        layout.processes.back().name = p.name;
+        layout.processes.back().title = p.title;
+        layout.processes.back().colour = p.colour;
+    }
+    
+    stride = (1 + layout.processes.size()) * (layout.GetNumBins() + 2);
+    slices.assign(numSlices * stride, 0.);
+    slicesw2.assign(numSlices * stride, 0.);
+    windowSums.assign(stride, 0.);
+    windowSumsw2.assign(stride, 0.);
+    runSums.assign(stride, 0.);
+    runSumsw2.assign(stride, 0.);
+}
+
+
+void TimeSlicedHists::Advance(double time)
+{
+    int64_t const target = GetSliceIndex(time);
+    
+    if (target <= curSlice)
+        return;
+    
+    
+    // If the whole window has expired, there is no need to subtract slices one by one
+    if (target - curSlice >= numSlices)
+    {
+        fill(slices.begin(), slices.end(), 0.);
+        fill(slicesw2.begin(), slicesw2.end(), 0.);
+        fill(windowSums.begin(), windowSums.end(), 0.);
+        fill(windowSumsw2.begin(), windowSumsw2.end(), 0.);
+        curSlice = target;
+        numExpired = 0;
+        return;
+    }
+    
+    
+    // Otherwise each new slice reuses the memory of the oldest one, whose contents are removed
+    //from the window sums
+    while (curSlice < target)
+    {
+        ++curSlice;
+        unsigned const offset = (curSlice % numSlices) * stride;
+        
+        for (unsigned i = 0; i < stride; ++i)
+        {
+            windowSums[i] -= slices[offset + i];
+            windowSumsw2[i] -= slicesw2[offset + i];
+        }
+        
+        fill(slices.begin() + offset, slices.begin() + offset + stride, 0.);
+        fill(slicesw2.begin() + offset, slicesw2.begin() + offset + stride, 0.);
+        ++numExpired;
+    }
+    
+    if (numExpired >= numSlices)
+        Resum();
+}
+
+
+unsigned TimeSlicedHists::FindHist(string const &name) const
+{
+    if (name == layout.data.name)
+        return 0;
+    
+    for (unsigned i = 0; i < layout.processes.size(); ++i)
+    {
+        if (layout.processes[i].name == name)
+            return i + 1;
+    }
+    
+    
+    // If this point is reached, the requested histogram has not been found
+    ostringstream ost;
+    ost << "Time-sliced histograms do not include histogram \"" << name << "\".";
+    throw runtime_error(ost.str());
+}
+
+
+void TimeSlicedHists::Fill(unsigned histIndex, double time, double x, double weight /*= 1.*/)
+{
+    int64_t const slice = GetSliceIndex(time);
+    
+    if (slice > curSlice)
+        Advance(time);
+    
+    
+    // Index 0 corresponds to the underflow bin, as in ROOT
+    ArrayView<double> const &edges = layout.edges;
+    unsigned const index = histIndex * (edges.GetSize() + 1) +
+     (upper_bound(edges.begin(), edges.end(), x) - edges.begin());
+    
+    runSums[index] += weight;
+    runSumsw2[index] += weight * weight;
+    
+    if (slice <= curSlice - numSlices)
+        return;
+    
+    unsigned const offset = ((slice % numSlices + numSlices) % numSlices) * stride;
+    slices[offset + index] += weight;
+    slicesw2[offset + index] += weight * weight;
+    windowSums[index] += weight;
+    windowSumsw2[index] += weight * weight;
+}
+
+
+PlotContent TimeSlicedHists::GetRun() const
+{
+    return MakeContent(runSums, runSumsw2);
+}
+
+
+PlotContent TimeSlicedHists::GetWindow() const
+{
+    return MakeContent(windowSums, windowSumsw2);
+}
+
+
+void TimeSlicedHists::ResetRun()
+{
+    fill(runSums.begin(), runSums.end(), 0.);
+    fill(runSumsw2.begin(), runSumsw2.end(), 0.);
+}
+
+
+int64_t TimeSlicedHists::GetSliceIndex(double time) const
+{
+    return int64_t(floor((time - startTime) / sliceDuration));
+}
+
+
+PlotContent TimeSlicedHists::MakeContent(vector<double> const &sums,
+ vector<double> const &sumsw2) const
+{
+    PlotContent content(layout);
+    unsigned const size = layout.GetNumBins() + 2;
+    
+    content.data.contents = ArrayView<double>(sums.data(), size);
+    content.data.sumw2 = ArrayView<double>(sumsw2.data(), size);
+    
+    for (unsigned i = 0; i < content.processes.size(); ++i)
+    {
+        content.processes[i].contents = ArrayView<double>(sums.data() + (i + 1) * size, size);
+        content.processes[i].sumw2 = ArrayView<double>(sumsw2.data() + (i + 1) * size, size);
+    }
+    
+    return content;
+}
+
+
+void TimeSlicedHists::Resum()
+{
+    fill(windowSums.begin(), windowSums.end(), 0.);
+    fill(windowSumsw2.begin(), windowSumsw2.end(), 0.);
+    
+    for (unsigned s = 0; s < numSlices; ++s)
+    {
+        for (unsigned i = 0; i < stride; ++i)
+        {
+            windowSums[i] += slices[s * stride + i];
+            windowSumsw2[i] += slicesw2[s * stride + i];
+        }
+    }
+    
+    numExpired = 0;
+}
@@ -0,0 +1,285 @@
+#include <ToyBand.hpp>
+
+#include <Parallel.hpp>
+#include <Philox.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <sstream>
+#include <thread>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Splits the range [0, num) into the given number of nearly equal chunks
+    inline pair<unsigned, unsigned> GetChunk(unsigned num, unsigned numChunks, unsigned chunk)
+    {
+        return {unsigned(uint64_t(num) * chunk / numChunks),
+         unsigned(uint64_t(num) * (chunk + 1) / numChunks)};
+    }
+}
+
+
+unsigned const ToyBand::numCells = 1024;
+
+
+ToyBand::ToyBand(vector<ArrayView<double>> const &processes_):
+    processes(processes_)
+{
+    if (processes.empty())
+        throw runtime_error("ToyBand requires at least one process.");
+    
+    numBins = processes.front().GetSize();
+    
+    for (auto const &p: processes)
+    {
+        if (p.GetSize() != numBins)
+        {
+            ostringstream ost;
+            ost << "Processes given to ToyBand have different numbers of bins (" << numBins <<
+             " and " << p.GetSize() << ").";
+            throw runtime_error(ost.str());
+        }
+    }
+    
+    nominal.assign(numBins, 0.);
+    
+    for (auto const &p: processes)
+        for (unsigned b = 0; b < numBins; ++b)
+            nominal[b] += p[b];
+}
+
+
+void ToyBand::AddNuisance(vector<double> const &kappas)
+{
+    if (kappas.size() != processes.size())
+    {
+        ostringstream ost;
+        ost << "Nuisance parameter specifies " << kappas.size() << " values of kappa while " <<
+         processes.size() << " are expected.";
+        throw runtime_error(ost.str());
+    }
+    
+    logKappas.emplace_back(kappas.size());
+    
+    for (unsigned p = 0; p < kappas.size(); ++p)
+    {
+        if (kappas[p] <= 0.)
+        {
+            ostringstream ost;
+            ost << "Nuisance parameter has a non-positive kappa " << kappas[p] << ".";
+            throw runtime_error(ost.str());
+        }
+        
+        logKappas.back()[p] = log(kappas[p]);
+    }
+}
+
+
+void ToyBand::Compute(unsigned numToys, uint64_t seed /*= 0*/,
+ double confLevel /*= 0.682689492137086*/, unsigned numThreads /*= 0*/)
+{
+    if (numToys == 0 or confLevel <= 0. or confLevel >= 1.)
+    {
+        ostringstream ost;
+        ost << "Cannot build a band from " << numToys << " pseudo-experiments with confidence " <<
+         "level " << confLevel << ".";
+        throw runtime_error(ost.str());
+    }
+    
+    if (numThreads == 0)
+        numThreads = max(thread::hardware_concurrency(), 1u);
+    
+    numThreads = min(numThreads, numToys);
+    
+    
+    // First pass: find the range of totals in each bin. Pseudo-experiments are split into one
+    //contiguous chunk per thread, and each chunk keeps its own extrema
+    vector<vector<double>> threadMin(numThreads), threadMax(numThreads);
+    
+    auto findRange = [&](unsigned t)
+    {
+        vector<double> thetas, factors, totals;
+        vector<double> &lo = threadMin[t], &hi = threadMax[t];
+        lo.assign(numBins, numeric_limits<double>::infinity());
+        hi.assign(numBins, -numeric_limits<double>::infinity());
+        auto const chunk = GetChunk(numToys, numThreads, t);
+        
+        for (unsigned toy = chunk.first; toy < chunk.second; ++toy)
+        {
+            ComputeToy(toy, seed, thetas, factors, totals);
+            
+            for (unsigned b = 0; b < numBins; ++b)
+            {
+                lo[b] = min(lo[b], totals[b]);
+                hi[b] = max(hi[b], totals[b]);
+            }
+        }
+    };
+    
+    Parallel::Run(numThreads, numThreads, findRange);
+    
+    vector<double> rangeMin(threadMin.front()), rangeMax(threadMax.front());
+    
+    for (unsigned t = 1; t < numThreads; ++t)
+    {
+        for (unsigned b = 0; b < numBins; ++b)
+        {
+            rangeMin[b] = min(rangeMin[b], threadMin[t][b]);
+            rangeMax[b] = max(rangeMax[b], threadMax[t][b]);
+        }
+    }
+    
+    vector<double> invCellWidth(numBins);
+    
+    for (unsigned b = 0; b < numBins; ++b)
+    {
+        double const width = rangeMax[b] - rangeMin[b];
+        invCellWidth[b] = (width > 0.) ? numCells / width : 0.;
+    }
+    
+    
+    // Second pass: regenerate the same pseudo-experiments and fill the sketches
+    vector<vector<uint32_t>> threadCounts(numThreads);
+    
+    auto fillSketches = [&](unsigned t)
+    {
+        vector<double> thetas, factors, totals;
+        vector<uint32_t> &counts = threadCounts[t];
+        counts.assign(size_t(numBins) * numCells, 0);
+        auto const chunk = GetChunk(numToys, numThreads, t);
+        
+        for (unsigned toy = chunk.first; toy < chunk.second; ++toy)
+        {
+            ComputeToy(toy, seed, thetas, factors, totals);
+            
+            for (unsigned b = 0; b < numBins; ++b)
+            {
+                unsigned const cell = min(unsigned((totals[b] - rangeMin[b]) * invCellWidth[b]),
+                 numCells - 1);
+                ++counts[size_t(b) * numCells + cell];
+            }
+        }
+    };
+    
+    Parallel::Run(numThreads, numThreads, fillSketches);
+    
+    vector<uint32_t> &counts = threadCounts.front();
+    
+    for (unsigned t = 1; t < numThreads; ++t)
+        for (size_t i = 0; i < counts.size(); ++i)
+            counts[i] += threadCounts[t][i];
+    
+    
+    // Find quantiles, interpolating linearly within cells of the sketches
+    double const probs[3] = {0.5 * (1. - confLevel), 0.5, 0.5 * (1. + confLevel)};
+    vector<double> *outputs[3] = {&lower, &median, &upper};
+    
+    for (auto &output: outputs)
+        output->resize(numBins);
+    
+    for (unsigned b = 0; b < numBins; ++b)
+    {
+        uint32_t const *binCounts = counts.data() + size_t(b) * numCells;
+        double const cellWidth = (invCellWidth[b] > 0.) ? 1. / invCellWidth[b] : 0.;
+        unsigned cell = 0;
+        double cumSum = 0.;
+        
+        for (unsigned q = 0; q < 3; ++q)
+        {
+            double const target = probs[q] * numToys;
+            
+            while (cell < numCells - 1 and cumSum + binCounts[cell] < target)
+            {
+                cumSum += binCounts[cell];
+                ++cell;
+            }
+            
+            double const frac = (binCounts[cell] > 0) ?
+             min(max((target - cumSum) / binCounts[cell], 0.), 1.) : 0.;
+            (*outputs[q])[b] = rangeMin[b] + (cell + frac) * cellWidth;
+        }
+    }
+}
+
+
+vector<double> const &ToyBand::GetLower() const
+{
+    return lower;
+}
+
+
+vector<double> const &ToyBand::GetMedian() const
+{
+    return median;
+}
+
+
+vector<double> const &ToyBand::GetNominal() const
+{
+    return nominal;
+}
+
+
+vector<double> const &ToyBand::GetUpper() const
+{
+    return upper;
+}
+
+
+void ToyBand::ComputeToy(uint64_t toy, uint64_t seed, vector<double> &thetas,
+ vector<double> &factors, vector<double> &totals) const
+{
+    // Sample the nuisance parameters. Each call to the generator provides four normal variates
+    //via the Box-Muller transform, and the counter is built from the indices of the
+    //pseudo-experiment and of the call. Its last word separates these numbers from other users of
+    //the generator
+    unsigned const numNuisances = logKappas.size();
+    thetas.resize(numNuisances + 3);
+    
+    for (unsigned block = 0; block < numNuisances; block += 4)
+    {
+        uint32_t ctr[4] = {uint32_t(toy), uint32_t(toy >> 32), block / 4, Philox::ToyNuisance};
+        Philox::Transform(ctr, seed);
+        
+        for (unsigned k = 0; k < 4; k += 2)
+        {
+            double const r = sqrt(-2. * log(Philox::ToUniform(ctr[k])));
+            double const phi = 2. * M_PI * Philox::ToUniform(ctr[k + 1]);
+            thetas[block + k] = r * cos(phi);
+            thetas[block + k + 1] = r * sin(phi);
+        }
+    }
+    
+    
+    // Scale factors for all processes
+    unsigned const numProcesses = processes.size();
+    factors.assign(numProcesses, 0.);
+    
+    for (unsigned j = 0; j < numNuisances; ++j)
+        for (unsigned p = 0; p < numProcesses; ++p)
+            factors[p] += thetas[j] * logKappas[j][p];
+    
+    for (auto &f: factors)
+        f = exp(f);
+    
+    
+    // Accumulate the totals process by process so that the inner loop runs over contiguous
+    //arrays and can be vectorized
+    totals.assign(numBins, 0.);
+    double *out = totals.data();
+    
+    for (unsigned p = 0; p < numProcesses; ++p)
+    {
+        double const f = factors[p];
+        double const *in = processes[p].begin();
+        
+        for (unsigned b = 0; b < numBins; ++b)
+            out[b] += f * in[b];
+    }
+}
@@ -0,0 +1,543 @@
+#include <UhiReader.hpp>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <sstream>
+#include <utility>
+
+
+using namespace std;
+
+
+/**
+ * \struct UhiReader::JsonValue
+ * \brief Minimal DOM for a JSON document
+ * 
+ * Arrays that consist of numbers only, which is the case for bin contents and edges, are parsed
+ * directly into a flat buffer of doubles.
+ */
+struct UhiReader::JsonValue
+{
+    /// Supported types of values
+    enum class Type
+    {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object
+    };
+    
+    /// Constructor
+    JsonValue():
+        type(Type::Null), number(0.), boolean(false)
+    {}
+    
+    /// Returns member of an object with the given key, or null pointer if there is no such member
+    JsonValue const *Find(string const &key) const
+    {
+        for (auto const &m: members)
+        {
+            if (m.first == key)
+                return m.second.get();
+        }
+        
+        return nullptr;
+    }
+    
+    /**
+     * \brief Parses a value starting at the given position
+     * 
+     * The position is advanced past the value. The buffer must be null-terminated.
+     */
+    static void Parse(char const *&p, JsonValue &value);
+    
+    /// Parses a string literal starting at the given position
+    static string ParseString(char const *&p);
+    
+    /// Skips whitespaces
+    static void SkipSpaces(char const *&p)
+    {
+        while (*p == ' ' or *p == '\n' or *p == '\r' or *p == '\t')
+            ++p;
+    }
+    
+    /// Throws an exception with the description of a syntax error
+    static void ThrowSyntaxError(char const *p)
+    {
+        ostringstream ost;
+        ost << "Syntax error in JSON document near \"" << string(p).substr(0, 20) << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    /// Type of this value
+    Type type;
+    
+    /// Value of a number
+    double number;
+    
+    /// Value of a boolean
+    bool boolean;
+    
+    /// Value of a string
+    string text;
+    
+    /// Elements of an array that contains not only numbers
+    vector<unique_ptr<JsonValue>> elements;
+    
+    /// Elements of an array that contains only numbers
+    vector<double> numbers;
+    
+    /// Members of an object, in the order of appearance
+    vector<pair<string, unique_ptr<JsonValue>>> members;
+};
+
+
+void UhiReader::JsonValue::Parse(char const *&p, JsonValue &value)
+{
+    SkipSpaces(p);
+    
+    if (*p == '{')
+    {
+        value.type = Type::Object;
+        ++p;
+        SkipSpaces(p);
+        
+        if (*p == '}')
+        {
+            ++p;
+            return;
+        }
+        
+        while (true)
+        {
+            SkipSpaces(p);
+            string key(ParseString(p));
+            SkipSpaces(p);
+            
+            if (*p != ':')
+                ThrowSyntaxError(p);
+            
+            ++p;
+            unique_ptr<JsonValue> member(new JsonValue);
+            Parse(p, *member);
+            value.members.emplace_back(move(key), move(member));
+            SkipSpaces(p);
+            
+            if (*p == ',')
+                ++p;
+            else if (*p == '}')
+            {
+                ++p;
+                return;
+            }
+            else
+                ThrowSyntaxError(p);
+        }
+    }
+    else if (*p == '[')
+    {
+        value.type = Type::Array;
+        ++p;
+        SkipSpaces(p);
+        
+        if (*p == ']')
+        {
+            ++p;
+            return;
+        }
+        
+        while (true)
+        {
+            SkipSpaces(p);
+            
+            
+            // Numbers are parsed into the flat buffer as long as no other types are encountered
+            bool const isNumber = ((*p >= '0' and *p <= '9') or *p == '-' or *p == 'N' or
+             *p == 'I');
+            
+            if (isNumber and value.elements.empty())
+            {
+                char *end;
+                value.numbers.push_back(strtod(p, &end));
+                
+                if (end == p)
+                    ThrowSyntaxError(p);
+                
+                p = end;
+            }
+            else
+            {
+                // Move numbers read so far into the generic container
+                for (auto const &n: value.numbers)
+                {
+                    unique_ptr<JsonValue> element(new JsonValue);
+                    element->type = Type::Number;
+                    element->number = n;
+                    value.elements.emplace_back(move(element));
+                }
+                
+                value.numbers.clear();
+                
+                unique_ptr<JsonValue> element(new JsonValue);
+                Parse(p, *element);
+                value.elements.emplace_back(move(element));
+            }
+            
+            SkipSpaces(p);
+            
+            if (*p == ',')
+                ++p;
+            else if (*p == ']')
+            {
+                ++p;
+                return;
+            }
+            else
+                ThrowSyntaxError(p);
+        }
+    }
+    else if (*p == '"')
+    {
+        value.type = Type::String;
+        value.text = ParseString(p);
+    }
+    else if (boost::starts_with(p, "true"))
+    {
+        value.type = Type::Bool;
+        value.boolean = true;
+        p += 4;
+    }
+    else if (boost::starts_with(p, "false"))
+    {
+        value.type = Type::Bool;
+        value.boolean = false;
+        p += 5;
+    }
+    else if (boost::starts_with(p, "null"))
+    {
+        value.type = Type::Null;
+        p += 4;
+    }
+    else
+    {
+        // NaN and infinities, which are written by Python's json module, are accepted as well
+        char *end;
+        value.number = strtod(p, &end);
+        
+        if (end == p)
+            ThrowSyntaxError(p);
+        
+        value.type = Type::Number;
+        p = end;
+    }
+}
+
+
+string UhiReader::JsonValue::ParseString(char const *&p)
+{
+    if (*p != '"')
+        ThrowSyntaxError(p);
+    
+    ++p;
+    string result;
+    
+    while (*p != '"')
+    {
+        if (*p == '\0')
+            ThrowSyntaxError(p);
+        
+        if (*p != '\\')
+        {
+            result += *p;
+            ++p;
+            continue;
+        }
+        
+        
+        // Process an escape sequence
+        ++p;
+        
+        switch (*p)
+        {
+            case 'b':
+                result += '\b';
+                break;
+            
+            case 'f':
+                result += '\f';
+                break;
+            
+            case 'n':
+                result += '\n';
+                break;
+            
+            case 'r':
+                result += '\r';
+                break;
+            
+            case 't':
+                result += '\t';
+                break;
+            
+            case 'u':
+            {
+                // Decode a UTF-16 code unit, possibly followed by a low surrogate, and encode it
+                //in UTF-8
+                unsigned long code = strtoul(string(p + 1, 4).c_str(), nullptr, 16);
+                p += 4;
+                
+                if (code >= 0xD800 and code < 0xDC00 and p[1] == '\\' and p[2] == 'u')
+                {
+                    unsigned long const low = strtoul(string(p + 3, 4).c_str(), nullptr, 16);
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                
+                if (code < 0x80)
+                    result += char(code);
+                else if (code < 0x800)
+                {
+                    result += char(0xC0 | (code >> 6));
+                    result += char(0x80 | (code & 0x3F));
+                }
+                else if (code < 0x10000)
+                {
+                    result += char(0xE0 | (code >> 12));
+                    result += char(0x80 | ((code >> 6) & 0x3F));
+                    result += char(0x80 | (code & 0x3F));
+                }
+                else
+                {
+                    result += char(0xF0 | (code >> 18));
+                    result += char(0x80 | ((code >> 12) & 0x3F));
+                    result += char(0x80 | ((code >> 6) & 0x3F));
+                    result += char(0x80 | (code & 0x3F));
+                }
+                
+                break;
+            }
+            
+            case '\0':
+                ThrowSyntaxError(p);
+                break;
+            
+            default:  // covers quotes, backslashes, and slashes
+                result += *p;
+        }
+        
+        ++p;
+    }
+    
+    ++p;
+    return result;
+}
+
+
+UhiReader::UhiReader(string const &fileName_):
+    fileName(fileName_),
+    document(new JsonValue)
+{
+    ifstream srcFile(fileName, ios::binary);
+    
+    if (not srcFile)
+    {
+        ostringstream ost;
+        ost << "Failed to open file \"" << fileName << "\".";
+        throw runtime_error(ost.str());
+    }
+    
+    string const buffer((istreambuf_iterator<char>(srcFile)), istreambuf_iterator<char>());
+    
+    
+    char const *p = buffer.c_str();
+    JsonValue::Parse(p, *document);
+    
+    if (document->type != JsonValue::Type::Object)
+    {
+        ostringstream ost;
+        ost << "File \"" << fileName << "\" does not contain a JSON object with histograms.";
+        throw runtime_error(ost.str());
+    }
+}
+
+
+UhiReader::~UhiReader()
+{}
+
+
+PlotContent UhiReader::Read(string const &dirName /*= ""*/) const
+{
+    PlotContent content;
+    string const prefix((dirName.empty()) ? "" : dirName + "/");
+    
+    ostringstream source;
+    source << "file \"" << fileName << "\", directory \"" << dirName << "\"";
+    
+    vector<double> edges;
+    string axisLabel;
+    
+    
+    for (auto const &m: document->members)
+    {
+        // Skip histograms from other directories, including nested ones
+        if (not boost::starts_with(m.first, prefix) or
+         m.first.find('/', prefix.length()) != string::npos)
+            continue;
+        
+        string const name(m.first.substr(prefix.length()));
+        JsonValue const &hist = *m.second;
+        
+        auto throwError = [&](string const &what)
+        {
+            ostringstream ost;
+            ost << "Histogram \"" << name << "\" in " << source.str() << " " << what << ".";
+            throw runtime_error(ost.str());
+        };
+        
+        
+        // Parse the axis
+        JsonValue const *axes = hist.Find("axes");
+        
+        if (not axes or axes->elements.size() != 1)
+            throwError("is not one-dimensional");
+        
+        JsonValue const &axis = *axes->elements.front();
+        JsonValue const *axisType = axis.Find("type");
+        vector<double> histEdges;
+        
+        if (axisType and axisType->text == "regular")
+        {
+            JsonValue const *lower = axis.Find("lower");
+            JsonValue const *upper = axis.Find("upper");
+            JsonValue const *bins = axis.Find("bins");
+            
+            if (not lower or not upper or not bins or bins->number < 1)
+                throwError("has a malformed regular axis");
+            
+            unsigned const numBins = bins->number;
+            
+            for (unsigned i = 0; i <= numBins; ++i)
+                histEdges.push_back(lower->number + (upper->number - lower->number) * i / numBins);
+        }
+        else if (axisType and axisType->text == "variable")
+        {
+            JsonValue const *axisEdges = axis.Find("edges");
+            
+            if (not axisEdges or axisEdges->numbers.size() < 2)
+                throwError("has a malformed variable axis");
+            
+            histEdges = axisEdges->numbers;
+        }
+        else
+            throwError("has an axis of unsupported type");
+        
+        if (edges.empty())
+            edges = histEdges;
+        else if (edges != histEdges)
+            throwError("has a binning different from other histograms");
+        
+        JsonValue const *underflow = axis.Find("underflow");
+        JsonValue const *overflow = axis.Find("overflow");
+        bool const hasUnderflow = (underflow and underflow->boolean);
+        bool const hasOverflow = (overflow and overflow->boolean);
+        
+        JsonValue const *axisMetadata = axis.Find("metadata");
+        JsonValue const *label = (axisMetadata) ? axisMetadata->Find("label") : nullptr;
+        
+        if (label and axisLabel.empty())
+            axisLabel = label->text;
+        
+        
+        // Parse the storage. Bin contents are copied into arrays with under- and overflow bins
+        JsonValue const *storage = hist.Find("storage");
+        JsonValue const *storageType = (storage) ? storage->Find("type") : nullptr;
+        
+        if (not storageType or (storageType->text != "int" and storageType->text != "double" and
+         storageType->text != "weighted"))
+            throwError("has a storage of unsupported type");
+        
+        unsigned const numBins = histEdges.size() - 1;
+        unsigned const expectedLength = numBins + ((hasUnderflow) ? 1 : 0) +
+         ((hasOverflow) ? 1 : 0);
+        unsigned const offset = (hasUnderflow) ? 0 : 1;
+        
+        auto readArray = [&](string const &key)
+        {
+            JsonValue const *values = storage->Find(key);
+            
+            if (not values or values->numbers.size() != expectedLength)
+                throwError("has a malformed storage");
+            
+            vector<double> buffer(numBins + 2, 0.);
+            copy(values->numbers.begin(), values->numbers.end(), buffer.begin() + offset);
+            return content.Adopt(move(buffer));
+        };
+        
+        
+        PlotContent::Hist *target;
+        
+        if (name == "data")
+            target = &content.data;
+        else if (name == "syst_up")
+            target = &content.systUp;
+        else if (name == "syst_down")
+            target = &content.systDown;
+        else
+        {
+            content.processes.emplace_back();
+            target = &content.processes.back();
+        }
+        
+        target->name = name;
+        target->title = (name == "data") ? "Data" : name;
+        target->contents = readArray("values");
+        
+        if (storageType->text == "weighted")
+            target->sumw2 = readArray("variances");
+        
+        
+        // Read optional metadata
+        JsonValue const *metadata = hist.Find("metadata");
+        
+        if (metadata)
+        {
+            JsonValue const *histLabel = metadata->Find("label");
+            JsonValue const *colour = metadata->Find("color");
+            JsonValue const *plotTitle = metadata->Find("plot_title");
+            
+            if (histLabel and histLabel->type == JsonValue::Type::String)
+                target->title = histLabel->text;
+            
+            if (colour and colour->type == JsonValue::Type::Number)
+                target->colour = colour->number;
+            
+            if (plotTitle and name == "data")
+                content.title = plotTitle->text;
+        }
+    }
+    
+    
+    if (content.title.empty())
+        content.title = ";" + axisLabel + ";Events";
+    
+    content.edges = content.Adopt(move(edges));
+    content.Validate(source.str());
+    return content;
+}
+
+
+vector<string> UhiReader::GetHistNames() const
+{
+    vector<string> names;
+    
+    for (auto const &m: document->members)
+        names.push_back(m.first);
+    
+    return names;
+}
@@ -0,0 +1,554 @@
+#include <YieldTable.hpp>
+
+#include <Parallel.hpp>
+#include <StackRules.hpp>
+#include <Summation.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <sstream>
+
+
+using namespace std;
+
+
+namespace
+{
+    /**
+     * \brief Computes the sum of bin contents and its uncertainty
+     * 
+     * If the vector of widths is not empty, contents are weighted with the widths. Bins hidden by
+     * the mask are skipped.
+     */
+    void ComputeYield(PlotContent::Hist const &hist, vector<double> const &widths,
+     YieldTable::Yield &yield, BinMask const &mask = BinMask())
+    {
+        ArrayView<double> const &variances = (hist.sumw2.IsEmpty()) ? hist.contents : hist.sumw2;
+        double value = 0., valueComp = 0., square = 0., squareComp = 0.;
+        
+        for (unsigned bin = 0; bin < hist.contents.GetSize(); ++bin)
+        {
+            if (mask.IsMasked(bin))
+                continue;
+            
+            double const w = (widths.empty()) ? 1. : widths[bin];
+            Summation::AddCompensated(value, valueComp, hist.contents[bin] * w);
+            Summation::AddCompensated(square, squareComp, variances[bin] * w * w);
+        }
+        
+        yield.name = hist.name;
+        yield.title = (hist.title.empty()) ? hist.name : hist.title;
+        yield.value = value + valueComp;
+        yield.error = sqrt(square + squareComp);
+    }
+    
+    
+    /// Quotes a field for CSV if it contains special characters
+    string QuoteCsv(string const &text)
+    {
+        if (text.find_first_of(",\"\n") == string::npos)
+            return text;
+        
+        string result("\"");
+        
+        for (char const c: text)
+        {
+            if (c == '"')
+                result += '"';
+            
+            result += c;
+        }
+        
+        return result + '"';
+    }
+    
+    
+    /// Escapes a string for JSON and encloses it in quotes
+    string QuoteJson(string const &text)
+    {
+        ostringstream ost;
+        ost << '"';
+        
+        for (char const c: text)
+        {
+            if (c == '"' or c == '\\')
+                ost << '\\' << c;
+            else if (c == '\n')
+                ost << "\\n";
+            else if (static_cast<unsigned char>(c) < 0x20)
+                ost << "\\u" << hex << setw(4) << setfill('0') << int(c) << dec;
+            else
+                ost << c;
+        }
+        
+        ost << '"';
+        return ost.str();
+    }
+    
+    
+    /// Formats a number for JSON, which does not support non-finite values
+    string FormatJson(double value)
+    {
+        if (not isfinite(value))
+            return "null";
+        
+        ostringstream ost;
+        ost << setprecision(numeric_limits<double>::max_digits10) << value;
+        return ost.str();
+    }
+    
+    
+    /**
+     * \brief Escapes characters that have a special meaning in LaTeX
+     * 
+     * Text enclosed in dollar signs, e.g. "$t\bar{t}$", is kept as it is. ROOT-style commands
+     * starting with '#' are not translated.
+     */
+    string EscapeLatex(string const &text)
+    {
+        string result;
+        bool mathMode = false;
+        
+        for (char const c: text)
+        {
+            if (c == '$')
+                mathMode = not mathMode;
+            
+            if (not mathMode and (c == '_' or c == '&' or c == '%' or c == '#'))
+                result += '\\';
+            
+            result += c;
+        }
+        
+        return result;
+    }
+    
+    
+    /**
+     * \brief Writes a single yield as a cell of a LaTeX table
+     * 
+     * If the pointer is null, a dash is written. The optional suffix is added in the math mode
+     * after the value.
+     */
+    void WriteLatexCell(ostream &out, YieldTable::Yield const *yield, int precision,
+     bool withError = true, string const &suffix = "")
+    {
+        out << " & ";
+        
+        if (not yield)
+        {
+            out << "--";
+            return;
+        }
+        
+        ostringstream ost;
+        ost << fixed << setprecision(precision) << "$" << yield->value;
+        
+        if (withError)
+            ost << " \\pm " << yield->error;
+        
+        ost << suffix << "$";
+        out << ost.str();
+    }
+}
+
+
+YieldTable::Yield::Yield():
+    value(0.), error(0.)
+{}
+
+
+YieldTable::YieldTable(PlotReader const &reader_):
+    reader(reader_),
+    normalize(false), isDensity(false),
+    derived(nullptr)
+{}
+
+
+void YieldTable::DeclareOverlay(string const &pattern)
+{
+    overlayPatterns.emplace_back(pattern);
+}
+
+
+void YieldTable::Fill(vector<string> const &dirNames, unsigned numThreads /*= 0*/)
+{
+    // Directories are processed in parallel. Contents of a directory are released as soon as its
+    //yields are computed
+    vector<Region> newRegions(dirNames.size());
+    mutex callbackMutex;
+    
+    Parallel::Run(dirNames.size(), numThreads, [&](unsigned i)
+    {
+        PlotContent content(reader.Read(dirNames[i]));
+        BinMask blinding;
+        
+        if (derived or blinder)
+        {
+            lock_guard<mutex> lock(callbackMutex);
+            
+            if (derived)
+                derived->Apply(content, dirNames[i]);
+            
+            if (blinder)
+                blinding = blinder(content, dirNames[i]);
+        }
+        
+        newRegions[i] = ComputeRegion(content, dirNames[i], blinding);
+    });
+    
+    move(newRegions.begin(), newRegions.end(), back_inserter(regions));
+}
+
+
+vector<YieldTable::Region> const &YieldTable::GetRegions() const
+{
+    return regions;
+}
+
+
+void YieldTable::SetBlinding(Blinder const &blinder_)
+{
+    blinder = blinder_;
+}
+
+
+void YieldTable::SetDerivedProcesses(DerivedProcesses &derived_)
+{
+    derived = &derived_;
+}
+
+
+void YieldTable::SetNormalization(bool normalize_, bool isDensity_ /*= false*/)
+{
+    normalize = normalize_;
+    isDensity = isDensity_;
+}
+
+
+void YieldTable::WriteCsv(ostream &out) const
+{
+    out << "region,process,kind,yield,error,syst_up,syst_down\n";
+    streamsize const oldPrecision = out.precision(numeric_limits<double>::max_digits10);
+    
+    for (auto const &r: regions)
+    {
+        string const region(QuoteCsv(r.dirName));
+        
+        for (auto const &p: r.processes)
+            out << region << ',' << QuoteCsv(p.name) << ",mc," << p.value << ',' << p.error <<
+             ",,\n";
+        
+        for (auto const &p: r.overlays)
+            out << region << ',' << QuoteCsv(p.name) << ",overlay," << p.value << ',' <<
+             p.error << ",,\n";
+        
+        out << region << ",total,total," << r.total.value << ',' << r.total.error << ',';
+        
+        if (r.hasSystematics)
+            out << r.systUp << ',' << r.systDown;
+        else
+            out << ',';
+        
+        out << '\n';
+        
+        if (r.isBlinded)
+            out << region << ",data,data,blinded,,,\n";
+        else
+            out << region << ",data,data," << r.data.value << ',' << r.data.error << ",,\n";
+    }
+    
+    out.precision(oldPrecision);
+}
+
+
+void YieldTable::WriteJson(ostream &out) const
+{
+    auto writeYields = [&out](vector<Yield> const &yields)
+    {
+        out << '[';
+        
+        for (unsigned i = 0; i < yields.size(); ++i)
+        {
+            Yield const &y = yields[i];
+            out << ((i > 0) ? ", " : "") << "{\"name\": " << QuoteJson(y.name) <<
+             ", \"title\": " << QuoteJson(y.title) << ", \"yield\": " << FormatJson(y.value) <<
+             ", \"error\": " << FormatJson(y.error) << '}';
+        }
+        
+        out << ']';
+    };
+    
+    out << "[\n";
+    
+    for (unsigned i = 0; i < regions.size(); ++i)
+    {
+        Region const &r = regions[i];
+        out << "  {\"region\": " << QuoteJson(r.dirName) << ", \"title\": " <<
+         QuoteJson(r.title) << ", \"norm_factor\": " << FormatJson(r.normFactor) <<
+         ", \"blinded\": " << ((r.isBlinded) ? "true" : "false") << ",\n";
+        out << "   \"processes\": ";
+        writeYields(r.processes);
+        out << ",\n   \"overlays\": ";
+        writeYields(r.overlays);
+        out << ",\n   \"total\": {\"yield\": " << FormatJson(r.total.value) << ", \"error\": " <<
+         FormatJson(r.total.error);
+        
+        if (r.hasSystematics)
+            out << ", \"syst_up\": " << FormatJson(r.systUp) << ", \"syst_down\": " <<
+             FormatJson(r.systDown);
+        
+        out << "},\n   \"data\": ";
+        
+        if (r.isBlinded)
+            out << "null";
+        else
+            out << "{\"yield\": " << FormatJson(r.data.value) << ", \"error\": " <<
+             FormatJson(r.data.error) << '}';
+        
+        out << '}' << ((i + 1 < regions.size()) ? "," : "") << '\n';
+    }
+    
+    out << "]\n";
+}
+
+
+void YieldTable::WriteLatex(ostream &out, unsigned regionsPerTable /*= 5*/,
+ int precision /*= 1*/) const
+{
+    if (regionsPerTable == 0)
+        regionsPerTable = 1;
+    
+    
+    // Collect names of processes in the order of their first appearance, keeping processes in the
+    //stack and overlays separately
+    vector<pair<string, string>> processNames, overlayNames;
+    
+    for (auto const &r: regions)
+    {
+        for (auto const &list: {make_pair(&r.processes, &processNames),
+         make_pair(&r.overlays, &overlayNames)})
+        {
+            for (auto const &y: *list.first)
+            {
+                auto const res = find_if(list.second->begin(), list.second->end(),
+                 [&y](pair<string, string> const &p){return p.first == y.name;});
+                
+                if (res == list.second->end())
+                    list.second->emplace_back(y.name, y.title);
+            }
+        }
+    }
+    
+    auto findYield = [](vector<Yield> const &yields, string const &name) -> Yield const *
+    {
+        for (auto const &y: yields)
+        {
+            if (y.name == name)
+                return &y;
+        }
+        
+        return nullptr;
+    };
+    
+    
+    // Write a separate table for every group of regions
+    for (unsigned start = 0; start < regions.size(); start += regionsPerTable)
+    {
+        unsigned const end = min<unsigned>(start + regionsPerTable, regions.size());
+        out << "\\begin{tabular}{l" << string(end - start, 'r') << "}\n\\toprule\n";
+        
+        for (unsigned i = start; i < end; ++i)
+            out << " & " << EscapeLatex((regions[i].title.empty()) ? regions[i].dirName :
+             regions[i].title);
+        
+        out << " \\\\\n\\midrule\n";
+        
+        for (auto const &p: processNames)
+        {
+            out << EscapeLatex(p.second);
+            
+            for (unsigned i = start; i < end; ++i)
+                WriteLatexCell(out, findYield(regions[i].processes, p.first), precision);
+            
+            out << " \\\\\n";
+        }
+        
+        out << "\\midrule\nTotal";
+        
+        for (unsigned i = start; i < end; ++i)
+        {
+            // Systematic variations are written as asymmetric uncertainties
+            Region const &r = regions[i];
+            ostringstream syst;
+            
+            if (r.hasSystematics)
+                syst << fixed << setprecision(precision) << "^{+" << fabs(r.systUp) << "}_{-" <<
+                 fabs(r.systDown) << "}";
+            
+            WriteLatexCell(out, &r.total, precision, true, syst.str());
+        }
+        
+        out << " \\\\\nData";
+        
+        for (unsigned i = start; i < end; ++i)
+        {
+            if (regions[i].isBlinded)
+                out << " & blinded";
+            else
+                WriteLatexCell(out, &regions[i].data, 0, false);
+        }
+        
+        out << " \\\\\n";
+        
+        if (not overlayNames.empty())
+        {
+            out << "\\midrule\n";
+            
+            for (auto const &p: overlayNames)
+            {
+                out << EscapeLatex(p.second);
+                
+                for (unsigned i = start; i < end; ++i)
+                    WriteLatexCell(out, findYield(regions[i].overlays, p.first), precision);
+                
+                out << " \\\\\n";
+            }
+        }
+        
+        out << "\\bottomrule\n\\end{tabular}\n\n";
+    }
+}
+
+
+YieldTable::Region YieldTable::ComputeRegion(PlotContent const &content, string const &dirName,
+ BinMask const &blinding) const
+{
+    Region region;
+    region.dirName = dirName;
+    region.title = content.title.substr(0, content.title.find(';'));
+    region.isBlinded = blinding.IsActive();
+    
+    if (region.isBlinded and blinding.GetNumBins() != content.GetNumBins())
+    {
+        ostringstream ost;
+        ost << "Mask for " << blinding.GetNumBins() << " bins cannot be applied to directory \"" <<
+         dirName << "\" with " << content.GetNumBins() << " bins.";
+        throw runtime_error(ost.str());
+    }
+    
+    
+    // Bin widths are only needed for densities
+    vector<double> const widths = (isDensity) ? StackRules::GetWidths(content.edges) :
+     vector<double>();
+    
+    
+    // Split MC processes into the stack and overlays, applying the patterns in turn to processes
+    //that remain in the stack, as in DataMCPlot::DeclareOverlay
+    vector<PlotContent::Hist const *> stack, overlays;
+    
+    for (auto const &p: content.processes)
+        stack.push_back(&p);
+    
+    for (auto const &pattern: overlayPatterns)
+    {
+        vector<string> stackNames;
+        
+        for (auto const &p: stack)
+            stackNames.emplace_back(p->name);
+        
+        vector<unsigned> const matches = StackRules::MatchOverlay(stackNames, pattern, false);
+        
+        for (auto matchIt = matches.rbegin(); matchIt != matches.rend(); ++matchIt)
+        {
+            overlays.push_back(stack[*matchIt]);
+            stack.erase(stack.begin() + *matchIt);
+        }
+    }
+    
+    
+    // Compute yields of individual histograms. Overlays are reported in the order of the input
+    ComputeYield(content.data, widths, region.data, blinding);
+    
+    for (auto const &p: stack)
+    {
+        region.processes.emplace_back();
+        ComputeYield(*p, widths, region.processes.back());
+    }
+    
+    for (auto const &p: content.processes)
+    {
+        if (find(overlays.begin(), overlays.end(), &p) != overlays.end())
+        {
+            region.overlays.emplace_back();
+            ComputeYield(p, widths, region.overlays.back());
+        }
+    }
+    
+    
+    // The total is computed from the yields of the processes. Their uncertainties are independent
+    vector<double> values, squares;
+    
+    for (auto const &p: region.processes)
+    {
+        values.push_back(p.value);
+        squares.push_back(p.error * p.error);
+    }
+    
+    region.total.name = "total";
+    region.total.title = "Total";
+    region.total.value = Summation::Sum(ArrayView<double>(values.data(), values.size()));
+    region.total.error = sqrt(Summation::Sum(ArrayView<double>(squares.data(), squares.size())));
+    
+    
+    // Systematic variations of the total
+    region.hasSystematics = content.HasSystematics();
+    region.systUp = region.systDown = 0.;
+    
+    if (region.hasSystematics)
+    {
+        Yield up, down;
+        ComputeYield(content.systUp, widths, up);
+        ComputeYield(content.systDown, widths, down);
+        region.systUp = up.value;
+        region.systDown = down.value;
+    }
+    
+    
+    // Rescale processes in the stack to data. The factor is computed from the bin-wise total, in
+    //the same way as in DataMCPlot::NormalizeMCToData, so that blinded bins are excluded
+    region.normFactor = 1.;
+    
+    if (normalize)
+    {
+        vector<ArrayView<double>> stackContents;
+        
+        for (auto const &p: stack)
+            stackContents.push_back(p->contents);
+        
+        vector<double> total;
+        Summation::SumArrays(stackContents, total);
+        region.normFactor = StackRules::ComputeNormFactor(content.data.contents,
+         ArrayView<double>(total.data(), total.size()), blinding,
+         ArrayView<double>(widths.data(), widths.size()));
+    }
+    
+    if (region.normFactor != 1.)
+    {
+        for (auto &p: region.processes)
+        {
+            p.value *= region.normFactor;
+            p.error *= region.normFactor;
+        }
+        
+        region.total.value *= region.normFactor;
+        region.total.error *= region.normFactor;
+        region.systUp *= region.normFactor;
+        region.systDown *= region.normFactor;
+    }
+    
+    return region;
+}
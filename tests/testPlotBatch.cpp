@@ -0,0 +1,229 @@
+/**
+ * Checks of PlotBatch against DataMCPlot
+ * 
+ * The same plots are processed with PlotBatch and, one by one, with DataMCPlot. Normalized MC
+ * contents and totals are compared directly, and residuals and chi2 are compared with scalar loops
+ * over the histograms of DataMCPlot. Some of the plots are blinded.
+ */
+
+#include <DataMCPlot.hpp>
+#include <PlotBatch.hpp>
+
+#include <TROOT.h>
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Number of failed checks
+    unsigned numFailures = 0;
+    
+    
+    /// Reports a failure if the values differ by more than the relative tolerance
+    void CheckClose(double value, double reference, string const &what)
+    {
+        if (fabs(value - reference) <= 1e-10 * max(fabs(reference), 1.))
+            return;
+        
+        cerr << "FAILED: " << what << ": got " << value << ", expected " << reference << ".\n";
+        ++numFailures;
+    }
+    
+    
+    /// Creates a plot with random contents and variable binning
+    PlotContent CreatePlot(unsigned index, mt19937_64 &generator)
+    {
+        unsigned const numBins = 20;
+        uniform_real_distribution<double> uniform(0.5, 1.5);
+        
+        PlotContent content;
+        ostringstream title;
+        title << "plot" << index << ";x;Events";
+        content.title = title.str();
+        
+        vector<double> edges(numBins + 1);
+        
+        for (unsigned i = 0; i <= numBins; ++i)
+            edges[i] = i + 0.01 * i * i;
+        
+        content.edges = content.Adopt(move(edges));
+        
+        
+        // MC processes with falling spectra. The last one has no sums of squared weights
+        vector<string> const names{"ttbar", "wjets", "qcd"};
+        
+        for (unsigned p = 0; p < names.size(); ++p)
+        {
+            vector<double> contents(numBins + 2), sumw2(numBins + 2);
+            
+            for (unsigned bin = 0; bin < numBins + 2; ++bin)
+            {
+                contents[bin] = 100. * exp(-0.15 * bin) * uniform(generator) / (p + 1.);
+                sumw2[bin] = 0.1 * contents[bin];
+            }
+            
+            PlotContent::Hist h;
+            h.name = h.title = names[p];
+            h.contents = content.Adopt(move(contents));
+            
+            if (p + 1 < names.size())
+                h.sumw2 = content.Adopt(move(sumw2));
+            
+            content.processes.emplace_back(h);
+        }
+        
+        
+        // Data fluctuate around a scaled sum of processes
+        vector<double> data(numBins + 2);
+        
+        for (unsigned bin = 0; bin < numBins + 2; ++bin)
+        {
+            double sum = 0.;
+            
+            for (auto const &p: content.processes)
+                sum += p.contents[bin];
+            
+            data[bin] = round(1.2 * sum * uniform(generator));
+        }
+        
+        content.data.name = "data";
+        content.data.contents = content.Adopt(move(data));
+        
+        return content;
+    }
+    
+    
+    /// Compares results of the batch for one plot with the given DataMCPlot
+    void ComparePlot(PlotBatch const &batch, unsigned index, DataMCPlot const &plot,
+     PlotContent const &input, bool normalize)
+    {
+        ostringstream prefix;
+        prefix << "plot " << index << ", normalize = " << normalize << ", ";
+        
+        unsigned const numBins = batch.GetNumBins();
+        PlotContent const content(batch.GetContent(index));
+        shared_ptr<TH1> const dataHist = plot.GetHist("data");
+        BinMask const &blinding = plot.GetBlinding();
+        double chi2 = 0.;
+        unsigned ndf = 0;
+        
+        for (unsigned bin = 0; bin <= numBins + 1; ++bin)
+        {
+            // Scalar sums over the histograms of DataMCPlot
+            double total = 0., totalVar = 0.;
+            
+            for (unsigned p = 0; p < input.processes.size(); ++p)
+            {
+                shared_ptr<TH1> const h = plot.GetHist(input.processes[p].name);
+                total += h->GetBinContent(bin);
+                totalVar += pow(h->GetBinError(bin), 2);
+                
+                ostringstream what;
+                what << prefix.str() << "process " << p << ", bin " << bin;
+                CheckClose(content.processes[p].contents[bin], h->GetBinContent(bin), what.str());
+            }
+            
+            ostringstream what;
+            what << prefix.str() << "bin " << bin;
+            CheckClose(batch.GetTotal(index)[bin], total, "total, " + what.str());
+            
+            // Blinded data must not affect any of the results
+            if (blinding.IsMasked(bin))
+            {
+                CheckClose(batch.GetResiduals(index)[bin], 0., "blinded residual, " + what.str());
+                CheckClose(batch.GetResidualErrors(index)[bin], 0.,
+                 "blinded residual error, " + what.str());
+                continue;
+            }
+            
+            double const d = dataHist->GetBinContent(bin), dataErr = dataHist->GetBinError(bin);
+            CheckClose(batch.GetResiduals(index)[bin], (d - total) / total,
+             "residual, " + what.str());
+            CheckClose(batch.GetResidualErrors(index)[bin], dataErr / total,
+             "residual error, " + what.str());
+            
+            if (bin > 0 and bin <= numBins)
+            {
+                chi2 += pow(d - total, 2) / (dataErr * dataErr + totalVar);
+                ++ndf;
+            }
+        }
+        
+        if (normalize)
+            --ndf;
+        
+        CheckClose(batch.GetChi2(index), chi2, prefix.str() + "chi2");
+        
+        if (batch.GetNdf(index) != ndf)
+        {
+            cerr << "FAILED: " << prefix.str() << "ndf: got " << batch.GetNdf(index) <<
+             ", expected " << ndf << ".\n";
+            ++numFailures;
+        }
+    }
+}
+
+
+int main()
+{
+    gROOT->SetBatch(true);
+    mt19937_64 generator(1234);
+    vector<PlotContent> contents;
+    
+    for (unsigned i = 0; i < 5; ++i)
+        contents.emplace_back(CreatePlot(i, generator));
+    
+    
+    // Compare results with and without normalization, treating histograms as event densities in
+    //the former case. One plot is blinded in a range of the variable, and another one in the
+    //under- and overflow bins and in a bin with the largest content
+    for (bool const normalize: {false, true})
+    {
+        vector<unique_ptr<DataMCPlot>> plots;
+        PlotBatch batch(contents);
+        
+        for (unsigned i = 0; i < contents.size(); ++i)
+        {
+            plots.emplace_back(new DataMCPlot(contents[i]));
+            
+            if (i == 1)
+                plots.back()->BlindRange(5., 9.);
+            else if (i == 3)
+                plots.back()->BlindBins([](unsigned bin){return (bin <= 1 or bin == 21);});
+            
+            batch.SetBlinding(i, plots.back()->GetBlinding());
+        }
+        
+        // Run the computation twice with different settings to check that inputs are not altered
+        batch.Compute(not normalize, false);
+        batch.Compute(normalize, normalize);
+        
+        for (unsigned i = 0; i < contents.size(); ++i)
+        {
+            if (normalize)
+                plots[i]->NormalizeMCToData(true);
+            
+            ComparePlot(batch, i, *plots[i], contents[i], normalize);
+        }
+    }
+    
+    
+    if (numFailures > 0)
+    {
+        cerr << numFailures << " checks failed.\n";
+        return 1;
+    }
+    
+    cout << "All checks of PlotBatch passed.\n";
+    return 0;
+}
@@ -0,0 +1,177 @@
+/**
+ * Checks of summation kernels against sequential scalar sums
+ * 
+ * Results of all modes are compared with a sequential sum computed in extended precision. The
+ * naive mode must reproduce a plain loop in double precision exactly.
+ */
+
+#include <Summation.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+using namespace std;
+
+
+namespace
+{
+    /// Number of failed checks
+    unsigned numFailures = 0;
+    
+    
+    /// Reports a failure if the values differ by more than the tolerance
+    void CheckClose(double value, double reference, double tolerance, string const &what)
+    {
+        if (fabs(value - reference) <= tolerance)
+            return;
+        
+        cerr << "FAILED: " << what << ": got " << value << ", expected " << reference <<
+         " within " << tolerance << ".\n";
+        ++numFailures;
+    }
+    
+    
+    /// Sequential sum in double precision, as it would be computed without the kernels
+    double SumScalar(vector<double> const &values)
+    {
+        double sum = 0.;
+        
+        for (auto const &x: values)
+            sum += x;
+        
+        return sum;
+    }
+    
+    
+    /// Sequential sum in extended precision, which serves as the reference
+    long double SumExtended(vector<double> const &values)
+    {
+        long double sum = 0.;
+        
+        for (auto const &x: values)
+            sum += x;
+        
+        return sum;
+    }
+    
+    
+    /// Returns the sum of absolute values, which sets the scale of rounding errors
+    double SumAbs(vector<double> const &values)
+    {
+        double sum = 0.;
+        
+        for (auto const &x: values)
+            sum += fabs(x);
+        
+        return sum;
+    }
+}
+
+
+int main()
+{
+    double const eps = numeric_limits<double>::epsilon();
+    mt19937_64 generator(1234);
+    uniform_real_distribution<double> uniform(-1., 1.);
+    
+    
+    // Single arrays of various sizes, including sizes that are not multiples of the number of
+    //lanes and of the pairwise block
+    for (unsigned const size: {0u, 1u, 7u, 8u, 9u, 127u, 128u, 129u, 1000u, 100003u})
+    {
+        vector<double> values(size);
+        
+        for (auto &x: values)
+            x = uniform(generator) * pow(10., 8. * uniform(generator));
+        
+        ArrayView<double> const view(values.data(), values.size());
+        double const reference = SumExtended(values);
+        double const scale = SumAbs(values);
+        ostringstream what;
+        what << "sum of " << size << " values";
+        
+        CheckClose(Summation::Sum(view, Summation::Mode::Naive), SumScalar(values), 0.,
+         what.str() + " (naive)");
+        CheckClose(Summation::Sum(view, Summation::Mode::Pairwise), reference,
+         eps * scale * (log2(size + 1.) + 1.), what.str() + " (pairwise)");
+        CheckClose(Summation::Sum(view, Summation::Mode::Compensated), reference,
+         2. * eps * (fabs(reference) + eps * scale), what.str() + " (compensated)");
+        
+        
+        // The compensated sum must be nearly independent of the order of terms
+        vector<double> shuffled(values);
+        shuffle(shuffled.begin(), shuffled.end(), generator);
+        CheckClose(Summation::Sum(ArrayView<double>(shuffled.data(), shuffled.size())),
+         Summation::Sum(view), 2. * eps * (fabs(reference) + eps * scale),
+         what.str() + " (compensated, shuffled)");
+    }
+    
+    
+    // Cancellation that is lost completely by the naive sum
+    vector<double> const cancelling{1e16, 1., -1e16, 1.};
+    ArrayView<double> const cancellingView(cancelling.data(), cancelling.size());
+    CheckClose(Summation::Sum(cancellingView), 2., 0., "cancelling terms (compensated)");
+    CheckClose(Summation::Sum(cancellingView, Summation::Mode::Naive), SumScalar(cancelling), 0.,
+     "cancelling terms (naive)");
+    
+    
+    // Element-wise sums of arrays are compared with sums of the same elements computed one by one
+    unsigned const numArrays = 37, size = 203;
+    vector<vector<double>> arrays(numArrays, vector<double>(size));
+    vector<ArrayView<double>> views;
+    
+    for (auto &a: arrays)
+    {
+        for (auto &x: a)
+            x = uniform(generator) * pow(10., 6. * uniform(generator));
+        
+        views.emplace_back(a.data(), a.size());
+    }
+    
+    for (auto const mode: {Summation::Mode::Naive, Summation::Mode::Pairwise,
+     Summation::Mode::Compensated})
+    {
+        vector<double> result;
+        Summation::SumArrays(views, result, mode);
+        
+        if (result.size() != size)
+        {
+            cerr << "FAILED: element-wise sum has " << result.size() << " elements while " <<
+             size << " are expected.\n";
+            ++numFailures;
+            continue;
+        }
+        
+        for (unsigned i = 0; i < size; ++i)
+        {
+            vector<double> column;
+            
+            for (auto const &a: arrays)
+                column.push_back(a[i]);
+            
+            ostringstream what;
+            what << "element " << i << " of element-wise sum in mode " << int(mode);
+            double const tolerance = (mode == Summation::Mode::Naive) ? 0. :
+             eps * SumAbs(column) * log2(numArrays + 1.);
+            CheckClose(result[i], (mode == Summation::Mode::Naive) ? SumScalar(column) :
+             double(SumExtended(column)), tolerance, what.str());
+        }
+    }
+    
+    
+    if (numFailures > 0)
+    {
+        cerr << numFailures << " checks failed.\n";
+        return 1;
+    }
+    
+    cout << "All checks of Summation passed.\n";
+    return 0;
+}